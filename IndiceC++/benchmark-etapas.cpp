@@ -0,0 +1,447 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <ctime>
+#include <cstdio>
+#include <filesystem>
+#include "../ii-servidor/IndiceInvertido.h"
+#include "../ii-servidor/ArchivoIndice.h"
+using namespace std;
+
+// Benchmarks reproducibles de cada etapa del indice y de la construccion y las consultas completas
+// A diferencia de benchmark-indice.cpp (que compara cada estructura con la que reemplazo), aqui se mide el codigo
+// actual sobre un corpus cualquiera, por ejemplo uno de generar-corpus, y el resultado queda en JSON para comparar
+// corridas. Cada medicion se repite y se informa la mediana, el minimo y el maximo.
+//
+// uso: benchmark-etapas [carpeta] [resultados.json]
+//   sin carpeta usa los textos de la carpeta actual; con carpeta indexa todos sus .txt (tambien en subcarpetas)
+//   las palabras vacias se leen de stop_words_spanish.txt en la carpeta actual
+
+const int REPETICIONES = 5;
+const uint64_t BYTES_MUESTRA = 32 * 1024 * 1024;  // las etapas por separado se miden sobre los primeros archivos
+const uint64_t CORPUS_GRANDE = 1024ull * 1024 * 1024;  // desde aqui la construccion completa se mide una sola vez
+const size_t CONSULTAS_MEZCLA = 200;
+
+struct Resultado {
+    string etapa;
+    string metrica;
+    string unidad;
+    vector<double> valores;  // uno por repeticion
+};
+
+vector<Resultado> resultados;
+size_t control = 0;  // se imprime al final para que el compilador no descarte el trabajo medido
+
+// Segundos de cada repeticion de 'funcion'
+template <typename Funcion>
+vector<double> cronometrar(int repeticiones, Funcion&& funcion) {
+    vector<double> segundos;
+    for (int r = 0; r < repeticiones; ++r) {
+        auto inicio = chrono::steady_clock::now();
+        funcion();
+        segundos.push_back(chrono::duration<double>(chrono::steady_clock::now() - inicio).count());
+    }
+    return segundos;
+}
+
+// Convierte los segundos de cada repeticion con 'conversion' y registra el resultado
+template <typename Conversion>
+void registrar(const string& etapa, const string& metrica, const string& unidad, const vector<double>& segundos, Conversion&& conversion) {
+    Resultado resultado{etapa, metrica, unidad, {}};
+    for (double s : segundos) {
+        resultado.valores.push_back(conversion(max(s, 1e-12)));
+    }
+    vector<double> orden = resultado.valores;
+    sort(orden.begin(), orden.end());
+    cout << etapa << " / " << metrica << ": " << orden[orden.size() / 2] << " " << unidad << " (min " << orden.front()
+         << ", max " << orden.back() << ", " << orden.size() << " repeticiones)" << endl;
+    resultados.push_back(move(resultado));
+}
+
+void registrarPorSegundo(const string& etapa, const string& metrica, const string& unidad, const vector<double>& segundos, double cantidad) {
+    registrar(etapa, metrica, unidad, segundos, [&](double s) { return cantidad / s; });
+}
+
+void registrarPorOperacion(const string& etapa, const string& metrica, const string& unidad, const vector<double>& segundos,
+                           double operaciones, double escala) {
+    registrar(etapa, metrica, unidad, segundos, [&](double s) { return s * escala / max(operaciones, 1.0); });
+}
+
+string escaparJson(const string& texto) {
+    string salida;
+    for (unsigned char c : texto) {
+        if (c == '"' || c == '\\') {
+            salida += '\\';
+            salida += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char codigo[8];
+            snprintf(codigo, sizeof(codigo), "\\u%04x", c);
+            salida += codigo;
+        } else {
+            salida += static_cast<char>(c);
+        }
+    }
+    return salida;
+}
+
+bool escribirJson(const string& ruta, const vector<pair<string, string>>& datos) {
+    ofstream salida(ruta);
+    if (!salida) {
+        cerr << "No se pudo escribir " << ruta << endl;
+        return false;
+    }
+    salida.precision(10);
+    salida << "{\n";
+    for (const auto& [clave, valor] : datos) {
+        salida << "  \"" << clave << "\": " << valor << ",\n";
+    }
+    salida << "  \"resultados\": [";
+    for (size_t i = 0; i < resultados.size(); ++i) {
+        const Resultado& r = resultados[i];
+        vector<double> orden = r.valores;
+        sort(orden.begin(), orden.end());
+        salida << (i ? ",\n" : "\n") << "    {\"etapa\": \"" << escaparJson(r.etapa) << "\", \"metrica\": \"" << escaparJson(r.metrica)
+               << "\", \"unidad\": \"" << escaparJson(r.unidad) << "\", \"mediana\": " << orden[orden.size() / 2]
+               << ", \"minimo\": " << orden.front() << ", \"maximo\": " << orden.back() << ", \"valores\": [";
+        for (size_t v = 0; v < r.valores.size(); ++v) {
+            salida << (v ? ", " : "") << r.valores[v];
+        }
+        salida << "]}";
+    }
+    salida << "\n  ]\n}\n";
+    return static_cast<bool>(salida);
+}
+
+// Archivos .txt de la carpeta (y sus subcarpetas) en orden, para que dos corridas usen los mismos
+vector<string> listarArchivos(const string& carpeta) {
+    vector<string> archivos;
+    error_code error;
+    for (filesystem::recursive_directory_iterator it(carpeta, error), fin; !error && it != fin; it.increment(error)) {
+        if (it->is_regular_file() && it->path().extension() == ".txt" && it->path().filename() != "stop_words_spanish.txt") {
+            archivos.push_back(it->path().string());
+        }
+    }
+    if (error) {
+        cerr << "Error al recorrer " << carpeta << ": " << error.message() << endl;
+    }
+    sort(archivos.begin(), archivos.end());
+    return archivos;
+}
+
+// Tokenizar, quitar las palabras vacias y agrupar, cada una por separado y juntas como en la construccion
+void benchmarkTokenizado(const vector<string>& textos, uint64_t bytes, const unordered_set<string>& stopWords,
+                         vector<Invertidor>& parciales) {
+    Tokenizador tokenizador;
+    size_t palabrasTexto = 0;
+    vector<double> segundos = cronometrar(REPETICIONES, [&] {
+        palabrasTexto = 0;
+        for (const string& texto : textos) {
+            tokenizador.tokenizar(texto, [&](string_view) { ++palabrasTexto; });
+        }
+    });
+    registrarPorSegundo("tokenizar", "rendimiento", "MB/s", segundos, bytes / 1e6);
+    registrarPorSegundo("tokenizar", "palabras", "palabras/s", segundos, static_cast<double>(palabrasTexto));
+
+    // Las palabras quedan en un arreglo para medir el filtro y el agrupado sin tokenizar; las que arma el buffer
+    // del tokenizador se copian aparte
+    vector<string_view> palabras;
+    vector<size_t> inicioDocumento;
+    deque<string> copias;
+    palabras.reserve(palabrasTexto);
+    for (const string& texto : textos) {
+        inicioDocumento.push_back(palabras.size());
+        const char* inicio = texto.data();
+        const char* fin = texto.data() + texto.size();
+        tokenizador.tokenizar(texto, [&](string_view palabra) {
+            if (palabra.data() >= inicio && palabra.data() < fin) {
+                palabras.push_back(palabra);
+            } else {
+                copias.emplace_back(palabra);
+                palabras.push_back(copias.back());
+            }
+        });
+    }
+    inicioDocumento.push_back(palabras.size());
+
+    unordered_set<string_view> vistaStop = vistaStopWords(stopWords);
+    vector<uint8_t> esVacia(palabras.size());
+    segundos = cronometrar(REPETICIONES, [&] {
+        for (size_t i = 0; i < palabras.size(); ++i) {
+            esVacia[i] = vistaStop.count(palabras[i]) > 0;
+        }
+    });
+    control += count(esVacia.begin(), esVacia.end(), 1);
+    registrarPorOperacion("palabras vacias", "tiempo por palabra", "ns", segundos, static_cast<double>(palabras.size()), 1e9);
+
+    // Agrupar cada palabra con sus documentos y frecuencias (la etapa de 'shuffle' del mapeo y reduccion)
+    size_t agregadas = 0;
+    segundos = cronometrar(REPETICIONES, [&] {
+        Invertidor invertidor;
+        agregadas = 0;
+        for (uint32_t documento = 0; documento + 1 < inicioDocumento.size(); ++documento) {
+            for (size_t i = inicioDocumento[documento]; i < inicioDocumento[documento + 1]; ++i) {
+                if (!esVacia[i]) {
+                    invertidor.agregar(palabras[i], documento);
+                    ++agregadas;
+                }
+            }
+        }
+        parciales.clear();
+        parciales.push_back(move(invertidor));
+    });
+    registrarPorOperacion("agrupar", "tiempo por palabra", "ns", segundos, static_cast<double>(agregadas), 1e9);
+
+    // Las tres etapas en una pasada, como las ejecuta cada hilo al construir
+    segundos = cronometrar(REPETICIONES, [&] {
+        Invertidor invertidor;
+        for (uint32_t documento = 0; documento < textos.size(); ++documento) {
+            control += procesarDocumento(textos[documento], documento, vistaStop, tokenizador, invertidor);
+        }
+    });
+    registrarPorSegundo("procesarDocumento", "rendimiento", "MB/s", segundos, bytes / 1e6);
+}
+
+// Construir el trie desde los invertidores, insertar en el delta y buscar
+void benchmarkTrie(vector<Invertidor>& parciales) {
+    const Invertidor& agrupado = parciales[0];
+    PoolHilos pool(1);
+    vector<double> segundos = cronometrar(REPETICIONES, [&] {
+        Trie trie;
+        reducirDatos(parciales, trie, pool);
+        control += trie.bytesPostings();
+    });
+    registrarPorOperacion("reducirDatos", "tiempo", "ms", segundos, 1, 1e3);
+    registrarPorSegundo("reducirDatos", "palabras", "palabras/s", segundos, static_cast<double>(agrupado.size()));
+
+    Trie trie;
+    segundos = cronometrar(REPETICIONES, [&] {
+        Trie delta;
+        agrupado.recorrer([&](const string& palabra, const ListaFrecuencias& lista) { delta.insertarLista(palabra, lista); });
+        control += delta.palabrasAgregadas();
+        trie = move(delta);
+    });
+    registrarPorOperacion("Trie::insertarLista", "tiempo por palabra", "ns", segundos, static_cast<double>(agrupado.size()), 1e9);
+
+    segundos = cronometrar(1, [&] { trie.construir(); });
+    registrarPorOperacion("Trie::construir", "tiempo", "ms", segundos, 1, 1e3);
+
+    // Todas las palabras en orden aleatorio y otras tantas ausentes
+    vector<string> presentes, ausentes;
+    agrupado.recorrer([&](const string& palabra, const ListaFrecuencias&) {
+        presentes.push_back(palabra);
+        ausentes.push_back(palabra + "zq");
+    });
+    shuffle(presentes.begin(), presentes.end(), mt19937(42));
+    shuffle(ausentes.begin(), ausentes.end(), mt19937(43));
+    for (auto [nombre, consultas] : {make_pair("presentes", &presentes), make_pair("ausentes", &ausentes)}) {
+        segundos = cronometrar(REPETICIONES, [&] {
+            for (const string& palabra : *consultas) {
+                control += trie.buscar(palabra).size();
+            }
+        });
+        registrarPorOperacion("Trie::buscar", string("tiempo por palabra, ") + nombre, "ns", segundos, static_cast<double>(consultas->size()), 1e9);
+    }
+}
+
+// Mezcla fija de consultas: palabras comunes y raras, AND, OR, NOT, prefijos y busquedas difusas. Las palabras
+// salen del vocabulario de la muestra ordenado por el numero de documentos donde aparece en el indice.
+vector<string> crearConsultas(const Invertidor& agrupado, const Trie& trie) {
+    vector<pair<size_t, string>> porDocumentos;
+    agrupado.recorrer([&](const string& palabra, const ListaFrecuencias&) {
+        if (palabra != "and" && palabra != "or" && palabra != "not") {
+            porDocumentos.push_back({trie.buscar(palabra).size(), palabra});
+        }
+    });
+    sort(porDocumentos.begin(), porDocumentos.end(), greater<>());
+    vector<string> consultas;
+    if (porDocumentos.empty()) {
+        return consultas;
+    }
+    size_t n = porDocumentos.size();
+    mt19937 generador(42);
+    auto banda = [&](double desde, double hasta) {
+        size_t inicio = static_cast<size_t>(desde * n);
+        size_t fin = max(inicio + 1, static_cast<size_t>(hasta * n));
+        return porDocumentos[min(n - 1, inicio + generador() % (fin - inicio))].second;
+    };
+    auto comun = [&] { return banda(0, 0.01); };
+    auto media = [&] { return banda(0.01, 0.2); };
+    auto rara = [&] { return banda(0.5, 1); };
+    while (consultas.size() < CONSULTAS_MEZCLA) {
+        switch (consultas.size() % 8) {
+        case 0:
+            consultas.push_back(comun());
+            break;
+        case 1:
+            consultas.push_back(rara());
+            break;
+        case 2:
+            consultas.push_back(comun() + " AND " + media());
+            break;
+        case 3:
+            consultas.push_back(media() + " AND " + media() + " AND " + rara());
+            break;
+        case 4:
+            consultas.push_back(media() + " OR " + rara());
+            break;
+        case 5:
+            consultas.push_back(comun() + " AND NOT " + media());
+            break;
+        case 6: {
+            string palabra = media();
+            consultas.push_back(palabra.substr(0, min<size_t>(palabra.size(), 3)) + "*");
+            break;
+        }
+        default: {
+            string palabra = media();
+            palabra[palabra.size() / 2] = palabra[palabra.size() / 2] == 'x' ? 'y' : 'x';
+            consultas.push_back(palabra + "~");
+            break;
+        }
+        }
+    }
+    return consultas;
+}
+
+// Consultas sobre el indice completo: todos los documentos (procesarEntrada) y los mejores por BM25, con un hilo
+// y con todos los del pool
+void benchmarkConsultas(const vector<string>& consultas, const Trie& trie, const TablaDocumentos& documentos) {
+    vector<double> segundos = cronometrar(REPETICIONES, [&] {
+        for (const string& consulta : consultas) {
+            control += procesarEntrada(trie, documentos, consulta).size();
+        }
+    });
+    registrarPorOperacion("procesarEntrada", "tiempo por consulta", "us", segundos, static_cast<double>(consultas.size()), 1e6);
+
+    segundos = cronometrar(REPETICIONES, [&] {
+        for (const string& consulta : consultas) {
+            control += buscarRanking(trie, documentos, consulta).size();
+        }
+    });
+    registrarPorOperacion("buscarRanking", "tiempo por consulta", "us", segundos, static_cast<double>(consultas.size()), 1e6);
+
+    PoolHilos pool;
+    const size_t vueltas = 4;
+    atomic<size_t> encontrados{0};
+    segundos = cronometrar(REPETICIONES, [&] {
+        for (size_t hilo = 0; hilo < pool.size(); ++hilo) {
+            pool.agregar([&, hilo] {
+                size_t propios = 0;
+                for (size_t i = 0; i < consultas.size() * vueltas; ++i) {
+                    propios += buscarRanking(trie, documentos, consultas[(i + hilo * 37) % consultas.size()]).size();
+                }
+                encontrados += propios;
+            });
+        }
+        pool.esperar();
+    });
+    control += encontrados;
+    registrarPorSegundo("buscarRanking en paralelo", to_string(pool.size()) + " hilos", "consultas/s", segundos,
+                        static_cast<double>(consultas.size() * vueltas * pool.size()));
+}
+
+int main(int argc, char* argv[]) {
+    string carpeta = argc > 1 ? argv[1] : ".";
+    string rutaResultados = argc > 2 ? argv[2] : "benchmark-etapas.json";
+
+    ifstream archivoEntrada("stop_words_spanish.txt");
+    unordered_set<string> stopWords;
+    if (archivoEntrada) {
+        string palabra;
+        while (getline(archivoEntrada, palabra)) {
+            stopWords.insert(palabra);
+        }
+    } else {
+        cerr << "Error al abrir el archivo de palabras vacias." << endl;
+        return 1;
+    }
+    stopWords = normalizarPalabras(stopWords);  // como las palabras del texto: en minusculas y sin tildes
+
+    vector<string> nombresArchivos = listarArchivos(carpeta);
+    if (nombresArchivos.empty()) {
+        cerr << "No hay archivos .txt en " << carpeta << endl;
+        return 1;
+    }
+    uint64_t bytesCorpus = 0;
+    error_code error;
+    for (const string& nombre : nombresArchivos) {
+        bytesCorpus += filesystem::file_size(nombre, error);
+    }
+
+    // Muestra para las etapas: los primeros archivos hasta BYTES_MUESTRA
+    vector<string> textos;
+    uint64_t bytesMuestra = 0;
+    for (size_t i = 0; i < nombresArchivos.size() && bytesMuestra < BYTES_MUESTRA; ++i) {
+        ifstream archivo(nombresArchivos[i], ios::binary);
+        stringstream contenido;
+        contenido << archivo.rdbuf();
+        textos.push_back(contenido.str());
+        bytesMuestra += textos.back().size();
+    }
+    cout << nombresArchivos.size() << " archivos, " << bytesCorpus / (1024 * 1024) << " MiB; muestra de " << textos.size()
+         << " archivos, " << bytesMuestra / (1024 * 1024) << " MiB" << endl;
+
+    vector<Invertidor> parciales;  // la muestra agrupada, como la deja un hilo del mapeo
+    benchmarkTokenizado(textos, bytesMuestra, stopWords, parciales);
+    textos.clear();
+    textos.shrink_to_fit();
+    benchmarkTrie(parciales);
+
+    // Construccion completa con todos los hilos
+    Trie trie;
+    TablaDocumentos documentos;
+    vector<double> segundos = cronometrar(bytesCorpus >= CORPUS_GRANDE ? 1 : 3, [&] {
+        trie = Trie();
+        documentos = TablaDocumentos();
+        crearIndiceInvertido(nombresArchivos, trie, documentos, stopWords);
+    });
+    registrarPorOperacion("crearIndiceInvertido", "tiempo", "s", segundos, 1, 1);
+    registrarPorSegundo("crearIndiceInvertido", "rendimiento", "MB/s", segundos, bytesCorpus / 1e6);
+
+    const string rutaIndice = "benchmark-etapas.iidx";
+    segundos = cronometrar(1, [&] { guardarIndice(rutaIndice, trie, documentos, stopWords); });
+    registrarPorOperacion("guardarIndice", "tiempo", "ms", segundos, 1, 1e3);
+    segundos = cronometrar(REPETICIONES, [&] {
+        Trie cargado;
+        TablaDocumentos documentosCargados;
+        if (!cargarIndice(rutaIndice, nombresArchivos, stopWords, cargado, documentosCargados)) {
+            cerr << "No se pudo cargar el indice guardado" << endl;
+        }
+    });
+    registrarPorOperacion("cargarIndice", "tiempo", "ms", segundos, 1, 1e3);
+    filesystem::remove(rutaIndice, error);
+
+    benchmarkConsultas(crearConsultas(parciales[0], trie), trie, documentos);
+
+    char fecha[32];
+    time_t ahora = time(nullptr);
+    strftime(fecha, sizeof(fecha), "%Y-%m-%dT%H:%M:%SZ", gmtime(&ahora));
+    string compilador = "desconocido";
+#ifdef __VERSION__
+    compilador = __VERSION__;
+#endif
+    vector<pair<string, string>> datos = {
+        {"corpus", "\"" + escaparJson(carpeta) + "\""},
+        {"archivos", to_string(nombresArchivos.size())},
+        {"bytes_corpus", to_string(bytesCorpus)},
+        {"bytes_muestra", to_string(bytesMuestra)},
+        {"nucleos", to_string(thread::hardware_concurrency())},
+        {"compilador", "\"" + escaparJson(compilador) + "\""},
+        {"fecha", "\"" + string(fecha) + "\""},
+    };
+    cout << "(control: " << control << ")" << endl;
+    if (!escribirJson(rutaResultados, datos)) {
+        return 1;
+    }
+    cout << "resultados en " << rutaResultados << endl;
+    return 0;
+}
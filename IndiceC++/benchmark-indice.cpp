@@ -0,0 +1,794 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <filesystem>
+#include "../ii-servidor/IndiceInvertido.h"
+#include "../ii-servidor/ArchivoIndice.h"
+#include "../ii-servidor/ListasOrdenadas.h"
+#include "../ii-servidor/CacheConsultas.h"
+using namespace std;
+
+// Contamos los bytes reservados en el heap para medir la memoria de cada estructura
+static atomic<size_t> bytesReservados{0};
+
+// Cada bloque guarda su tamaño en una cabecera para descontarlo al liberarlo
+void* operator new(size_t tamano) {
+    size_t* bloque = static_cast<size_t*>(malloc(tamano + 16));
+    if (!bloque) {
+        throw bad_alloc();
+    }
+    bloque[0] = tamano;
+    bytesReservados += tamano;
+    return reinterpret_cast<char*>(bloque) + 16;
+}
+
+void operator delete(void* puntero) noexcept {
+    if (puntero) {
+        size_t* bloque = reinterpret_cast<size_t*>(static_cast<char*>(puntero) - 16);
+        bytesReservados -= bloque[0];
+        free(bloque);
+    }
+}
+
+void operator delete(void* puntero, size_t) noexcept {
+    operator delete(puntero);
+}
+
+// Trie de nodos enlazados (implementacion anterior), se mantiene solo como referencia de comparacion
+struct NodoTrie {
+    unordered_map<char, NodoTrie*> children;
+    unordered_set<string> nombresArchivos;
+};
+
+class TrieNodos {
+private:
+    NodoTrie* root;
+
+public:
+    TrieNodos() {
+        root = new NodoTrie();
+    }
+
+    void insertar(const string& palabra, const string& nombreArchivo) {
+        NodoTrie* node = root;
+        for (char letra : palabra) {
+            if (!node->children.count(letra)) {
+                node->children[letra] = new NodoTrie();
+            }
+            node = node->children[letra];
+        }
+        node->nombresArchivos.insert(nombreArchivo);
+    }
+
+    // Solo recorre el trie, sin copiar el conjunto de archivos
+    const NodoTrie* recorrer(const string& palabra) const {
+        NodoTrie* node = root;
+        for (char letra : palabra) {
+            auto it = node->children.find(letra);
+            if (it == node->children.end()) {
+                return nullptr;
+            }
+            node = it->second;
+        }
+        return node;
+    }
+};
+
+// Lee los archivos y agrupa sus palabras igual que crearIndiceInvertido (con un solo hilo)
+vector<Invertidor> cargarDatos(const vector<string>& nombresArchivos, TablaDocumentos& documentos, const unordered_set<string>& stopWords) {
+    vector<uint32_t> ids;
+    for (const string& nombre : nombresArchivos) {
+        ids.push_back(documentos.agregar(nombre));
+    }
+    unordered_set<string_view> vistaStop = vistaStopWords(stopWords);
+    PoolHilos pool(1);
+    return mapearDocumentos(ids, documentos, vistaStop, OpcionesIndexado(), pool);
+}
+
+template <typename Funcion>
+double nanosegundosPorOperacion(size_t operaciones, Funcion&& funcion) {
+    auto inicio = chrono::steady_clock::now();
+    funcion();
+    auto fin = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(fin - inicio).count() / operaciones;
+}
+
+// Mejor tiempo (ms) de construir el indice completo con las opciones dadas
+double tiempoConstruccion(const vector<string>& nombresArchivos, unordered_set<string>& stopWords, const OpcionesIndexado& opciones) {
+    const int repeticiones = 5;
+    double mejor = 1e18;
+    for (int r = 0; r < repeticiones; ++r) {
+        Trie trie;
+        TablaDocumentos documentos;
+        mejor = min(mejor, nanosegundosPorOperacion(1, [&] {
+            crearIndiceInvertido(nombresArchivos, trie, documentos, stopWords, opciones);
+        }));
+    }
+    return mejor / 1e6;
+}
+
+// Construccion completa del indice leyendo los archivos con ifstream o con mmap
+void benchmarkLectura(const vector<string>& nombresArchivos, unordered_set<string>& stopWords) {
+    for (ModoLectura modo : {LECTURA_FLUJO, LECTURA_MAPEADA}) {
+        OpcionesIndexado opciones;
+        opciones.modo = modo;
+        opciones.hilos = 1;
+        cout << "crearIndiceInvertido con " << (modo == LECTURA_MAPEADA ? "mmap" : "ifstream") << ": "
+             << tiempoConstruccion(nombresArchivos, stopWords, opciones) << " ms" << endl;
+    }
+}
+
+// Escalado de la construccion con el numero de hilos del pool (1, 2, 4, ... hasta los nucleos disponibles)
+void benchmarkHilos(const vector<string>& nombresArchivos, unordered_set<string>& stopWords) {
+    size_t nucleos = max(1u, thread::hardware_concurrency());
+    double base = 0;
+    for (size_t hilos = 1; ; hilos = min(hilos * 2, nucleos)) {
+        OpcionesIndexado opciones;
+        opciones.hilos = hilos;
+        double ms = tiempoConstruccion(nombresArchivos, stopWords, opciones);
+        if (hilos == 1) {
+            base = ms;
+        }
+        cout << "construccion con " << hilos << " hilo(s): " << ms << " ms (aceleracion " << base / ms << "x)" << endl;
+        if (hilos == nucleos) {
+            break;
+        }
+    }
+}
+
+// Etapas de texto anteriores (una copia del texto por etapa), solo como referencia de comparacion
+string eliminarSignosAnterior(const string& texto) {
+    string nuevoTexto;
+    for (char caracter : texto) {
+        if (isalnum(caracter) || caracter == ' ') {
+            nuevoTexto += caracter;
+        } else if (caracter == '\n') {
+            nuevoTexto += ' ';
+        }
+    }
+    return nuevoTexto;
+}
+
+vector<string> tokenizarTextoAnterior(const string& texto) {
+    vector<string> listaPalabras;
+    istringstream stream(texto);
+    string palabra;
+    while (stream >> palabra) {
+        listaPalabras.push_back(palabra);
+    }
+    return listaPalabras;
+}
+
+vector<string> eliminarStopWordsAnterior(const vector<string>& listaPalabras, const unordered_set<string>& stopWords) {
+    vector<string> palabrasFiltradas;
+    for (const string& palabra : listaPalabras) {
+        if (stopWords.find(palabra) == stopWords.end()) {
+            palabrasFiltradas.push_back(palabra);
+        }
+    }
+    return palabrasFiltradas;
+}
+
+void benchmarkTokenizador(const vector<string>& textos, const unordered_set<string>& stopWords) {
+    size_t bytes = 0;
+    for (const string& texto : textos) {
+        bytes += texto.size();
+    }
+
+    size_t palabrasAnterior = 0;
+    size_t bytesAntes = bytesReservados;
+    size_t maximoAnterior = 0;
+    double nsAnterior = nanosegundosPorOperacion(bytes, [&] {
+        for (const string& texto : textos) {
+            vector<string> palabras = eliminarStopWordsAnterior(tokenizarTextoAnterior(eliminarSignosAnterior(texto)), stopWords);
+            palabrasAnterior += palabras.size();
+            maximoAnterior = max(maximoAnterior, bytesReservados - bytesAntes);
+        }
+    });
+
+    size_t palabrasFusionado = 0;
+    unordered_set<string_view> vistaStop = vistaStopWords(stopWords);
+    Tokenizador tokenizador;
+    bytesAntes = bytesReservados;
+    double nsFusionado = nanosegundosPorOperacion(bytes, [&] {
+        for (const string& texto : textos) {
+            tokenizador.tokenizar(texto, [&](string_view palabra) {
+                palabrasFusionado += vistaStop.find(palabra) == vistaStop.end();
+            });
+        }
+    });
+    size_t bytesFusionado = bytesReservados - bytesAntes;
+
+    cout << "tokenizar + palabras vacias: etapas anteriores = " << 1000.0 / nsAnterior << " MB/s ("
+         << maximoAnterior / 1024 << " KB extra por documento), tokenizador de una pasada = " << 1000.0 / nsFusionado
+         << " MB/s (" << bytesFusionado << " bytes reservados)" << endl;
+    cout << "palabras: etapas anteriores = " << palabrasAnterior << ", tokenizador de una pasada = " << palabrasFusionado << endl;
+}
+
+void benchmarkTrie(const vector<Invertidor>& parciales, const TablaDocumentos& documentos) {
+    const Invertidor& datosAgrupados = parciales[0];
+    vector<string> palabras;
+    datosAgrupados.recorrer([&](const string& palabra, const ListaFrecuencias&) {
+        palabras.push_back(palabra);
+    });
+    // Consultas: todas las palabras en orden aleatorio, mas el mismo numero de palabras ausentes
+    vector<string> consultas = palabras;
+    for (const string& palabra : palabras) {
+        consultas.push_back(palabra + "#");
+    }
+    shuffle(consultas.begin(), consultas.end(), mt19937(42));
+    const int repeticiones = 10;
+
+    size_t antes = bytesReservados;
+    TrieNodos trieNodos;
+    // El trie de nodos guarda la ruta completa de cada archivo, como antes de usar IDs
+    datosAgrupados.recorrer([&](const string& palabra, const ListaFrecuencias& ids) {
+        for (uint32_t id : ids.documentos) {
+            trieNodos.insertar(palabra, documentos.obtener(id).ruta);
+        }
+    });
+    size_t bytesNodos = bytesReservados - antes;
+
+    PoolHilos pool(1);
+    antes = bytesReservados;
+    Trie trie;
+    reducirDatos(parciales, trie, pool);
+    size_t bytesDobleArreglo = bytesReservados - antes;
+
+    size_t encontrados = 0;
+    double nsNodos = nanosegundosPorOperacion(consultas.size() * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (const string& consulta : consultas) {
+                encontrados += trieNodos.recorrer(consulta) != nullptr;
+            }
+        }
+    });
+    double nsBuscarNodos = nanosegundosPorOperacion(palabras.size(), [&] {
+        for (const string& palabra : palabras) {
+            unordered_set<string> copia = trieNodos.recorrer(palabra)->nombresArchivos;  // como el buscar anterior
+            encontrados += copia.size();
+        }
+    });
+    double nsBuscar = nanosegundosPorOperacion(palabras.size(), [&] {
+        for (const string& palabra : palabras) {
+            encontrados += trie.buscar(palabra).size();
+        }
+    });
+
+    // El doble arreglo por si solo (sin los conjuntos de archivos)
+    DobleArreglo diccionario;
+    vector<string> claves = palabras;
+    sort(claves.begin(), claves.end());
+    vector<uint32_t> valores(claves.size());
+    for (size_t i = 0; i < valores.size(); ++i) {
+        valores[i] = static_cast<uint32_t>(i);
+    }
+    auto inicioConstruccion = chrono::steady_clock::now();
+    diccionario.construir(claves, valores);
+    auto finConstruccion = chrono::steady_clock::now();
+    double nsDobleArreglo = nanosegundosPorOperacion(consultas.size() * repeticiones, [&] {
+        uint32_t valor;
+        for (int r = 0; r < repeticiones; ++r) {
+            for (const string& consulta : consultas) {
+                encontrados += diccionario.buscar(consulta, valor);
+            }
+        }
+    });
+
+    cout << "palabras: " << palabras.size() << ", estados del doble arreglo: " << diccionario.estados() << endl;
+    cout << "construccion del doble arreglo: "
+         << chrono::duration_cast<chrono::milliseconds>(finConstruccion - inicioConstruccion).count() << " ms" << endl;
+    cout << "bytes por palabra (con listas de documentos): trie de nodos = " << bytesNodos / palabras.size()
+         << ", trie de doble arreglo = " << bytesDobleArreglo / palabras.size() << endl;
+    cout << "bytes por palabra (solo diccionario): doble arreglo = " << diccionario.bytesUsados() / palabras.size() << endl;
+    cout << "recorrido por consulta: trie de nodos = " << nsNodos << " ns, doble arreglo = " << nsDobleArreglo << " ns" << endl;
+    cout << "buscar: trie de nodos (copia del conjunto) = " << nsBuscarNodos << " ns, Trie::buscar = " << nsBuscar << " ns" << endl;
+    cout << "(control: " << encontrados << ")" << endl;
+}
+
+// Arranque: construir el indice completo frente a cargar el indice guardado (mapeado, sin copiar)
+void benchmarkCarga(const vector<string>& nombresArchivos, unordered_set<string>& stopWords) {
+    const string ruta = "benchmark-indice.iidx";
+    Trie construido;
+    TablaDocumentos documentosConstruidos;
+    crearIndiceInvertido(nombresArchivos, construido, documentosConstruidos, stopWords);
+    double msGuardar = nanosegundosPorOperacion(1, [&] {
+        guardarIndice(ruta, construido, documentosConstruidos, stopWords);
+    }) / 1e6;
+
+    double msCargar = 1e18;
+    Trie cargado;
+    TablaDocumentos documentosCargados;
+    for (int r = 0; r < 5; ++r) {
+        msCargar = min(msCargar, nanosegundosPorOperacion(1, [&] {
+            if (!cargarIndice(ruta, nombresArchivos, stopWords, cargado, documentosCargados)) {
+                cerr << "No se pudo cargar el indice guardado" << endl;
+            }
+        }) / 1e6);
+    }
+
+    // Las dos versiones del indice deben responder lo mismo
+    TablaDocumentos tabla;
+    vector<Invertidor> parciales = cargarDatos(nombresArchivos, tabla, stopWords);
+    size_t distintas = 0;
+    parciales[0].recorrer([&](const string& palabra, const ListaFrecuencias&) {
+        ListaFrecuencias apoyoA, apoyoB;
+        VistaPostings a = descomprimirPostings(construido.buscar(palabra).compactada, apoyoA);
+        VistaPostings b = descomprimirPostings(cargado.buscar(palabra).compactada, apoyoB);
+        distintas += !equal(a.begin(), a.end(), b.begin(), b.end()) || apoyoA.frecuencias != apoyoB.frecuencias;
+    });
+    error_code error;
+    cout << "indice guardado: " << filesystem::file_size(ruta, error) / 1024 << " KiB, guardar = " << msGuardar
+         << " ms, cargar = " << msCargar << " ms, construir = " << tiempoConstruccion(nombresArchivos, stopWords, OpcionesIndexado())
+         << " ms (palabras con resultados distintos: " << distintas << ")" << endl;
+    filesystem::remove(ruta, error);
+}
+
+// Agregar un documento al indice vivo frente a reconstruir todo el indice con ese documento
+void benchmarkActualizacion(const vector<string>& nombresArchivos, unordered_set<string>& stopWords) {
+    vector<string> anteriores(nombresArchivos.begin(), nombresArchivos.end() - 1);
+    const string& nuevo = nombresArchivos.back();
+    Trie trie;
+    TablaDocumentos documentos;
+    crearIndiceInvertido(anteriores, trie, documentos, stopWords);
+
+    double msAgregar = nanosegundosPorOperacion(1, [&] {
+        agregarDocumento(nuevo, trie, documentos, stopWords);
+    }) / 1e6;
+    double msBorrar = nanosegundosPorOperacion(1, [&] {
+        borrarDocumento(nuevo, documentos);
+    }) / 1e6;
+    size_t palabrasDelta = trie.palabrasAgregadas();
+    double msCompactar = nanosegundosPorOperacion(1, [&] {
+        compactarIndice(trie, documentos);
+    }) / 1e6;
+    cout << "agregar " << nuevo << ": " << msAgregar << " ms (" << palabrasDelta << " palabras en el delta), borrar = " << msBorrar
+         << " ms, compactar = " << msCompactar << " ms, reconstruir todo = "
+         << tiempoConstruccion(nombresArchivos, stopWords, OpcionesIndexado()) << " ms" << endl;
+}
+
+// Consultas de frase frente a AND de las mismas palabras, sobre pares de palabras seguidas tomadas de los textos
+void benchmarkFrases(const vector<string>& nombresArchivos, unordered_set<string>& stopWords, const vector<string>& textos) {
+    OpcionesIndexado opciones;
+    opciones.posiciones = true;
+    Trie trie;
+    TablaDocumentos documentos;
+    crearIndiceInvertido(nombresArchivos, trie, documentos, stopWords, opciones);
+
+    vector<pair<string, string>> pares;
+    Tokenizador tokenizador;
+    for (const string& texto : textos) {
+        string anterior;
+        size_t palabra = 0;
+        tokenizador.tokenizar(texto, [&](string_view actual) {
+            string copia(actual);
+            if (stopWords.count(copia)) {
+                anterior.clear();
+                return;
+            }
+            if (!anterior.empty() && ++palabra % 997 == 0) {
+                pares.push_back({anterior, copia});
+            }
+            anterior = move(copia);
+        });
+    }
+
+    const int repeticiones = 20;
+    size_t encontrados = 0;
+    double nsAnd = nanosegundosPorOperacion(pares.size() * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (auto& [primera, segunda] : pares) {
+                encontrados += procesarEntrada(trie, documentos, primera + " AND " + segunda).size();
+            }
+        }
+    });
+    double nsFrase = nanosegundosPorOperacion(pares.size() * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (auto& [primera, segunda] : pares) {
+                encontrados += procesarEntrada(trie, documentos, "\"" + primera + " " + segunda + "\"").size();
+            }
+        }
+    });
+    cout << "posiciones: " << trie.bytesPosiciones() / 1024 << " KiB (postings en total " << trie.bytesPostings() / 1024
+         << " KiB), construir con posiciones = " << tiempoConstruccion(nombresArchivos, stopWords, opciones) << " ms" << endl;
+    cout << "consulta de " << pares.size() << " pares: AND = " << nsAnd << " ns, frase = " << nsFrase << " ns ("
+         << nsFrase / nsAnd << "x)" << endl;
+    cout << "(control: " << encontrados << ")" << endl;
+}
+
+// Consultas booleanas: analizar, planificar y ejecutar. El orden en que se escriben las palabras no deberia
+// cambiar el tiempo, porque el plan siempre empieza por la lista mas corta.
+void benchmarkConsultas(const vector<string>& nombresArchivos, unordered_set<string>& stopWords) {
+    Trie trie;
+    TablaDocumentos documentos;
+    crearIndiceInvertido(nombresArchivos, trie, documentos, stopWords);
+
+    vector<string> consultas = {
+        "amor",
+        "amor AND dios",
+        "monstruo AND amor AND dios AND vida",
+        "vida AND dios AND amor AND monstruo",
+        "xyzzy AND amor AND dios AND vida",
+        "(amor OR odio) AND NOT dios",
+        "liderazgo equipo OR (sirena AND NOT mar)",
+        "lider*",
+        "lider* AND equip*",
+        "a*",
+    };
+    const int repeticiones = 20000;
+    for (const string& consulta : consultas) {
+        size_t encontrados = 0;
+        double ns = nanosegundosPorOperacion(repeticiones, [&] {
+            for (int r = 0; r < repeticiones; ++r) {
+                encontrados += procesarEntrada(trie, documentos, consulta).size();
+            }
+        });
+        cout << "consulta '" << consulta << "': " << ns << " ns (" << encontrados / repeticiones << " documentos)" << endl;
+    }
+}
+
+// Cache de consultas: una mezcla donde pocas consultas se repiten mucho (la i-esima con probabilidad
+// proporcional a 1/i), con y sin cache. Cada 1000 consultas se borra y se vuelve a agregar un documento, lo
+// que invalida la cache.
+void benchmarkCache(const vector<string>& nombresArchivos, unordered_set<string>& stopWords) {
+    Trie trie;
+    TablaDocumentos documentos;
+    crearIndiceInvertido(nombresArchivos, trie, documentos, stopWords);
+
+    vector<string> consultas = {
+        "liderazgo", "actitud AND equipo", "amor", "equipo actitud", "lider*", "\"trabajo en equipo\"",
+        "amor AND dios", "(amor OR odio) AND NOT dios", "liderasgo~", "sirena", "monstruo AND vida", "influencia",
+        "gente AND exito", "sueño", "ceniza OR oro", "dios AND NOT amor", "equip* AND lider*", "vencedor", "mar", "vida",
+    };
+    mt19937 generador(7);
+    vector<double> pesos;
+    for (size_t i = 0; i < consultas.size(); ++i) {
+        pesos.push_back(1.0 / static_cast<double>(i + 1));
+    }
+    discrete_distribution<size_t> eleccion(pesos.begin(), pesos.end());
+    const size_t cantidad = 20000;
+    vector<size_t> mezcla(cantidad);
+    for (size_t& consulta : mezcla) {
+        consulta = eleccion(generador);
+    }
+
+    string ruta = documentos.obtener(0).ruta;
+    auto medir = [&](CacheConsultas* cache) {
+        size_t encontrados = 0;
+        double ns = nanosegundosPorOperacion(cantidad, [&] {
+            for (size_t i = 0; i < cantidad; ++i) {
+                if (i % 1000 == 999) {
+                    borrarDocumento(ruta, documentos);
+                    agregarDocumento(ruta, trie, documentos, stopWords);
+                }
+                const string& consulta = consultas[mezcla[i]];
+                encontrados += (cache ? buscarRankingConCache(*cache, trie, documentos, consulta)
+                                      : buscarRanking(trie, documentos, consulta)).size();
+            }
+        });
+        return make_pair(ns, encontrados);
+    };
+    auto [nsSin, encontradosSin] = medir(nullptr);
+    CacheConsultas cache;
+    auto [nsCon, encontradosCon] = medir(&cache);
+    cout << "consultas sin cache: " << nsSin << " ns, con cache: " << nsCon << " ns (" << nsSin / nsCon << "x)" << endl;
+    cout << describirEstadisticas(cache.estadisticas()) << endl;
+    cout << "(control: " << encontradosSin << " = " << encontradosCon << ")" << endl;
+}
+
+// Lista ordenada de 'cantidad' IDs distintos elegidos al azar entre 0 y 'universo'
+static ListaPostings listaAleatoria(size_t cantidad, uint32_t universo, mt19937& generador) {
+    uniform_int_distribution<uint32_t> distribucion(0, universo - 1);
+    ListaPostings lista;
+    lista.reserve(cantidad + cantidad / 4);
+    while (lista.size() < cantidad) {
+        size_t faltan = cantidad - lista.size();
+        for (size_t i = 0; i < faltan + faltan / 4; ++i) {
+            lista.push_back(distribucion(generador));
+        }
+        sort(lista.begin(), lista.end());
+        lista.erase(unique(lista.begin(), lista.end()), lista.end());
+    }
+    lista.resize(cantidad);
+    return lista;
+}
+
+// Nucleos de interseccion con listas sinteticas: parejas del mismo tamaño y una corta contra una larga.
+// Se informan postings leidos por segundo (la suma de las dos listas) y se comprueba cada nucleo contra el escalar.
+void benchmarkInterseccion() {
+    mt19937 generador(12345);
+    struct Caso {
+        const char* nombre;
+        size_t na;
+        size_t nb;
+        uint32_t universo;
+    };
+    vector<Caso> casos = {
+        {"balanceado 1M x 1M (denso)", 1000000, 1000000, 4000000},
+        {"balanceado 1M x 1M (disperso)", 1000000, 1000000, 64000000},
+        {"sesgado 1k x 1M", 1000, 1000000, 4000000},
+        {"sesgado 10k x 1M", 10000, 1000000, 4000000},
+    };
+    vector<NucleoInterseccion> nucleos = {NUCLEO_ESCALAR, NUCLEO_GALOPE, NUCLEO_SSE41, NUCLEO_AVX2, NUCLEO_AUTOMATICO};
+    const int repeticiones = 10;
+    for (const Caso& caso : casos) {
+        ListaPostings a = listaAleatoria(caso.na, caso.universo, generador);
+        ListaPostings b = listaAleatoria(caso.nb, caso.universo, generador);
+        ListaPostings esperado;
+        intersectarOrdenadas(a.data(), a.size(), b.data(), b.size(), esperado, NUCLEO_ESCALAR);
+        cout << "interseccion " << caso.nombre << " (" << esperado.size() << " comunes):";
+        ListaPostings salida(min(a.size(), b.size()) + 8);
+        for (NucleoInterseccion nucleo : nucleos) {
+            if (!nucleoDisponible(nucleo)) {
+                continue;
+            }
+            size_t n = 0;
+            double mejor = 1e18;
+            for (int r = 0; r < repeticiones; ++r) {
+                mejor = min(mejor, nanosegundosPorOperacion(1, [&] {
+                    n = intersectarOrdenadas(a.data(), a.size(), b.data(), b.size(), salida.data(), nucleo);
+                }));
+            }
+            if (n != esperado.size() || !equal(esperado.begin(), esperado.end(), salida.begin())) {
+                cerr << "El nucleo " << nombreNucleo(nucleo) << " no coincide con el escalar." << endl;
+            }
+            cout << " " << nombreNucleo(nucleo) << " = " << (a.size() + b.size()) / mejor * 1e3 << " M postings/s";
+        }
+        cout << endl;
+    }
+
+    // Union de k listas: por rondas frente a acumular sobre un resultado de a una lista
+    for (size_t k : {4, 16, 64}) {
+        vector<ListaPostings> listas;
+        vector<ListaOrdenada> vistas;
+        size_t total = 0;
+        for (size_t l = 0; l < k; ++l) {
+            listas.push_back(listaAleatoria(1600000 / k, 8000000, generador));
+            total += listas.back().size();
+        }
+        for (const ListaPostings& lista : listas) {
+            vistas.push_back({lista.data(), lista.size()});
+        }
+        ListaPostings resultadoRondas;
+        ListaPostings resultadoAcumulado;
+        double mejorRondas = 1e18;
+        double mejorAcumulado = 1e18;
+        for (int r = 0; r < repeticiones / 2; ++r) {
+            mejorRondas = min(mejorRondas, nanosegundosPorOperacion(1, [&] { unirVarias(vistas, resultadoRondas); }));
+            mejorAcumulado = min(mejorAcumulado, nanosegundosPorOperacion(1, [&] {
+                resultadoAcumulado.clear();
+                for (const ListaPostings& lista : listas) {
+                    resultadoAcumulado = unir(resultadoAcumulado, lista);
+                }
+            }));
+        }
+        if (resultadoRondas != resultadoAcumulado) {
+            cerr << "La union de k listas no coincide con la acumulada." << endl;
+        }
+        cout << "union de " << k << " listas (" << total << " postings): por rondas = " << total / mejorRondas * 1e3
+             << " M postings/s, acumulando = " << total / mejorAcumulado * 1e3 << " M postings/s" << endl;
+    }
+}
+
+// Postings comprimidos sobre un corpus sintetico de 200k documentos: palabras densas (en el formato de mapa),
+// medianas y raras. Compara los bytes con las listas planas de antes (ID y frecuencia de 4 bytes por posting)
+// y el AND de una palabra rara con una comun frente a intersectar las listas planas.
+void benchmarkCompresion() {
+    const uint32_t numeroDocumentos = 200000;
+    mt19937 generador(777);
+    geometric_distribution<uint32_t> repeticionesPalabra(0.5);
+    TablaDocumentos documentos;
+    for (uint32_t id = 0; id < numeroDocumentos; ++id) {
+        Documento documento;
+        documento.ruta = "d" + to_string(id);
+        documento.nombre = documento.ruta;
+        documento.bytes = 0;
+        documento.modificado = 0;
+        documento.longitud = 100;
+        documentos.agregar(documento);
+    }
+
+    struct Grupo {
+        const char* prefijo;
+        size_t palabras;
+        uint32_t df;
+    };
+    vector<Grupo> grupos = {{"densa", 3, 120000}, {"comun", 30, 4000}, {"rara", 300, 40}};
+    Trie trie;
+    unordered_map<string, ListaFrecuencias> planas;
+    size_t postings = 0;
+    for (const Grupo& grupo : grupos) {
+        for (size_t p = 0; p < grupo.palabras; ++p) {
+            string palabra = grupo.prefijo + to_string(p);
+            ListaFrecuencias& lista = planas[palabra];
+            lista.documentos = listaAleatoria(grupo.df, numeroDocumentos, generador);
+            for (size_t i = 0; i < lista.documentos.size(); ++i) {
+                lista.frecuencias.push_back(1 + repeticionesPalabra(generador));
+            }
+            trie.insertarLista(palabra, lista);
+            postings += lista.size();
+        }
+    }
+    trie.construir();
+    size_t bytesPlanos = postings * 2 * sizeof(uint32_t);
+    cout << "postings: " << postings << ", listas planas = " << bytesPlanos / 1024 << " KiB, comprimidas = "
+         << trie.bytesPostings() / 1024 << " KiB (" << 100.0 * trie.bytesPostings() / bytesPlanos << "%)" << endl;
+
+    vector<pair<string, string>> consultas;
+    for (size_t c = 0; c < 300; ++c) {
+        string rara = "rara" + to_string(c);
+        consultas.push_back({rara, c % 2 == 0 ? "densa" + to_string(c % 3) : "comun" + to_string(c % 30)});
+    }
+    size_t encontrados = 0;
+    const int repeticiones = 5;
+    double nsPlanas = nanosegundosPorOperacion(consultas.size() * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (auto& [rara, comun] : consultas) {
+                encontrados += intersectar(planas[rara], planas[comun]).size();
+            }
+        }
+    });
+    double nsComprimidas = nanosegundosPorOperacion(consultas.size() * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (auto& [rara, comun] : consultas) {
+                encontrados += procesarEntrada(trie, documentos, rara + " AND " + comun).size();
+            }
+        }
+    });
+    double nsRanking = nanosegundosPorOperacion(consultas.size() * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (auto& [rara, comun] : consultas) {
+                encontrados += buscarRanking(trie, documentos, rara + " " + comun).size();
+            }
+        }
+    });
+    double nsDecodificar = nanosegundosPorOperacion(3 * repeticiones, [&] {
+        for (int r = 0; r < repeticiones; ++r) {
+            for (size_t p = 0; p < 3; ++p) {
+                ListaFrecuencias apoyo;
+                encontrados += juntarPostings(trie.buscar("densa" + to_string(p)), apoyo).size();
+            }
+        }
+    });
+    // Prefijos: 'comun*' une 30 listas de 4000 documentos y 'rara*' 300 listas cortas (se queda con 256)
+    const string prefijos[] = {"comun*", "rara*", "rara1* AND comun*"};  // fuera de la medicion: sin conversiones en el ciclo
+    for (const string& prefijo : prefijos) {
+        double ns = nanosegundosPorOperacion(repeticiones * 20, [&] {
+            for (int r = 0; r < repeticiones * 20; ++r) {
+                encontrados += procesarEntrada(trie, documentos, prefijo).size();
+            }
+        });
+        cout << "prefijo '" << prefijo << "': " << ns / 1e3 << " us" << endl;
+    }
+    cout << "rara AND comun: listas planas (interseccion con galope) = " << nsPlanas << " ns, comprimidas con saltos = "
+         << nsComprimidas << " ns (consulta completa), con ranking BM25 = " << nsRanking << " ns" << endl;
+    cout << "decodificar una lista densa de 120k postings: " << nsDecodificar / 1e3 << " us" << endl;
+    cout << "(control: " << encontrados << ")" << endl;
+}
+
+// Busqueda difusa sobre un vocabulario sintetico de 1M palabras armadas con silabas. Cada consulta es una
+// palabra del vocabulario con uno o dos errores (cambiar, quitar o agregar una letra).
+void benchmarkDifusa() {
+    const vector<string> silabas = {"a", "e", "i", "o", "u", "la", "le", "li", "lo", "ma", "me", "mi", "mo", "pa", "pe", "po", "ra",
+                                    "re", "ri", "ro", "sa", "se", "si", "so", "ta", "te", "ti", "to", "ca", "co", "cu", "da", "de",
+                                    "di", "do", "na", "ne", "ni", "no", "ga", "go", "ba", "be", "bi", "bo", "ve", "vi", "za", "zo",
+                                    "que", "qui", "gue", "cha", "che", "chi", "lla", "lle", "rra", "rre", "tra", "tre", "pla", "ble",
+                                    "cion", "dad", "mente", "ar", "er", "ir", "as", "es", "os", "an", "en", "on", "al", "el"};
+    mt19937 generador(4242);
+    uniform_int_distribution<size_t> silaba(0, silabas.size() - 1);
+    uniform_int_distribution<int> largo(2, 5);
+    unordered_set<string> vocabulario;
+    while (vocabulario.size() < 1000000) {
+        string palabra;
+        for (int s = largo(generador); s > 0; --s) {
+            palabra += silabas[silaba(generador)];
+        }
+        vocabulario.insert(palabra);
+    }
+    Trie trie;
+    ListaFrecuencias lista;
+    lista.agregar(0, 1);
+    for (const string& palabra : vocabulario) {
+        trie.insertarLista(palabra, lista);
+    }
+    trie.construir();
+
+    vector<string> palabras(vocabulario.begin(), vocabulario.end());
+    auto conErrores = [&](string palabra, int errores) {
+        for (int e = 0; e < errores; ++e) {
+            size_t i = generador() % palabra.size();
+            switch (generador() % 3) {
+            case 0:
+                palabra[i] = static_cast<char>('a' + generador() % 26);
+                break;
+            case 1:
+                if (palabra.size() > 1) {
+                    palabra.erase(i, 1);
+                }
+                break;
+            default:
+                palabra.insert(i, 1, static_cast<char>('a' + generador() % 26));
+                break;
+            }
+        }
+        return palabra;
+    };
+    for (uint32_t distancia = 1; distancia <= DISTANCIA_MAXIMA_DIFUSA; ++distancia) {
+        vector<string> consultas;
+        for (int c = 0; c < 200; ++c) {
+            consultas.push_back(conErrores(palabras[generador() % palabras.size()], static_cast<int>(distancia)));
+        }
+        size_t encontradas = 0;
+        double ns = nanosegundosPorOperacion(consultas.size(), [&] {
+            for (const string& consulta : consultas) {
+                encontradas += trie.buscarParecidas(consulta, distancia).palabras.size();
+            }
+        });
+        cout << "difusa distancia " << distancia << " en 1M palabras: " << ns / 1e3 << " us ("
+             << static_cast<double>(encontradas) / consultas.size() << " palabras por consulta)" << endl;
+    }
+}
+
+int main() {
+    ifstream archivoEntrada("stop_words_spanish.txt");
+    unordered_set<string> stopWords;
+    if (archivoEntrada) {
+        string palabra;
+        while (getline(archivoEntrada, palabra)) {
+            stopWords.insert(palabra);
+        }
+    } else {
+        cerr << "Error al abrir el archivo de palabras vacias." << endl;
+        return 1;
+    }
+    stopWords = normalizarPalabras(stopWords);  // como las palabras del texto: en minusculas y sin tildes
+
+    vector<string> nombresArchivos = {
+        "17 LEYES DEL TRABAJO EN EQUIPO - JOHN C. MAXWELL.txt",
+        "21 LEYES DEL LIDERAZGO - JOHN C. MAXWELL.txt",
+        "25 MANERAS DE GANARSE A LA GENTE - JOHN C. MAXWELL.txt",
+        "ACTITUD DE VENCEDOR - JOHN C. MAXWELL.txt",
+        "El Oro Y La Ceniza - Abecassis Eliette.txt",
+        "La ultima sirena - Abe ShanaLa.txt",
+        "SEAMOS PERSONAS DE INFLUENCIA - JOHN MAXWELL.txt",
+        "VIVE TU SUENO - JOHN MAXWELL.txt",
+        "Frankenstein-mary-shelley.txt",
+        "La Divina Comedia - Dante Alighieri.txt"
+    };
+
+    TablaDocumentos documentos;
+    vector<Invertidor> datosAgrupados = cargarDatos(nombresArchivos, documentos, stopWords);
+
+    vector<string> textos;
+    ArchivoMapeado archivo;
+    for (uint32_t documento = 0; documento < documentos.size(); ++documento) {
+        if (recolectarArchivo(documento, documentos, archivo, LECTURA_FLUJO)) {
+            textos.emplace_back(archivo.contenido());
+        }
+    }
+
+    benchmarkLectura(nombresArchivos, stopWords);
+    benchmarkHilos(nombresArchivos, stopWords);
+    benchmarkTokenizador(textos, stopWords);
+    benchmarkTrie(datosAgrupados, documentos);
+    benchmarkCarga(nombresArchivos, stopWords);
+    benchmarkActualizacion(nombresArchivos, stopWords);
+    benchmarkConsultas(nombresArchivos, stopWords);
+    benchmarkCache(nombresArchivos, stopWords);
+    benchmarkFrases(nombresArchivos, stopWords, textos);
+    benchmarkInterseccion();
+    benchmarkCompresion();
+    benchmarkDifusa();
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include "../ii-servidor/PoolHilos.h" // los documentos se generan en paralelo
+
+using namespace std;
+
+// Generador de un corpus sintetico parecido al español para medir el indice a cualquier escala
+// Las palabras siguen la ley de Zipf-Mandelbrot: la de rango r aparece con probabilidad proporcional a
+// 1 / (r + 2.7), como en un texto real. Los primeros rangos son las palabras mas comunes del español (casi todas
+// vacias) y el resto del vocabulario se arma con silabas, algunas con tildes o ñ. Los documentos tienen tamaños
+// de distribucion lognormal, oraciones con mayuscula inicial, comas, puntos y lineas de unos 72 caracteres.
+// El corpus depende solo de la semilla y del tamaño pedido: cada documento usa su propio generador (semilla y
+// numero de documento), asi que el resultado no cambia con el numero de hilos y un corpus mas grande empieza
+// con los mismos documentos que uno mas chico.
+//
+// uso: generar-corpus <carpeta> <tamaño> [semilla]
+//   el tamaño va en bytes o con sufijo K, M o G (por ejemplo 500M o 20G)
+//   los documentos quedan en <carpeta>/NNNN/documento-NNNNNNNN.txt (1000 por carpeta) y los parametros en
+//   <carpeta>/corpus.parametros
+
+const size_t PALABRAS_VOCABULARIO = 1000000;
+const double DESPLAZAMIENTO_ZIPF = 2.7;  // q de Zipf-Mandelbrot: aplana los primeros rangos
+const double EXPONENTE_ZIPF = 1.0;
+const double MEDIANA_DOCUMENTO = 96 * 1024;  // bytes
+const double DISPERSION_DOCUMENTO = 1.0;     // sigma del logaritmo del tamaño
+const size_t MINIMO_DOCUMENTO = 2 * 1024;
+const size_t MAXIMO_DOCUMENTO = 16 * 1024 * 1024;
+const size_t DOCUMENTOS_POR_CARPETA = 1000;
+const size_t ANCHO_LINEA = 72;
+const size_t DOCUMENTOS_POR_TANDA = 256;  // se informa el avance despues de cada tanda
+
+// Las palabras mas frecuentes del español, de mayor a menor: ocupan los primeros rangos
+const vector<string> palabrasComunes = {
+    "de", "la", "que", "el", "en", "y", "a", "los", "se", "del", "las", "un", "por", "con", "no", "una", "su", "para",
+    "es", "al", "lo", "como", "más", "o", "pero", "sus", "le", "ha", "me", "si", "sin", "sobre", "este", "ya", "entre",
+    "cuando", "todo", "esta", "ser", "son", "dos", "también", "fue", "había", "era", "muy", "años", "hasta", "desde",
+    "está", "mi", "porque", "qué", "sólo", "han", "yo", "hay", "vez", "puede", "todos", "así", "nos", "ni", "parte",
+    "tiene", "él", "uno", "donde", "bien", "tiempo", "mismo", "ese", "ahora", "cada", "vida", "otro", "después", "te",
+};
+
+const vector<string> silabas = {
+    "a", "e", "i", "o", "u", "la", "le", "li", "lo", "lu", "ma", "me", "mi", "mo", "mu", "pa", "pe", "pi", "po", "ra",
+    "re", "ri", "ro", "sa", "se", "si", "so", "su", "ta", "te", "ti", "to", "tu", "ca", "co", "cu", "da", "de", "di",
+    "do", "na", "ne", "ni", "no", "ga", "go", "ba", "be", "bi", "bo", "va", "ve", "vi", "za", "zo", "ja", "jo", "que",
+    "qui", "gue", "cha", "che", "chi", "lla", "lle", "llo", "rra", "rre", "tra", "tre", "tri", "pla", "ble", "bra",
+    "cre", "gra", "pro", "ción", "dad", "mente", "ar", "er", "ir", "as", "es", "os", "an", "en", "on", "al", "el",
+    "ña", "ño", "más", "tó", "rí", "dé", "sión", "ven", "cien", "tor", "mos", "ras", "cos", "bles", "dor", "ción",
+};
+
+// Tabla de alias (Walker): elige un rango con la distribucion de Zipf en tiempo constante
+struct TablaAlias {
+    vector<double> probabilidad;
+    vector<uint32_t> alias;
+
+    explicit TablaAlias(size_t n) : probabilidad(n), alias(n) {
+        vector<double> pesos(n);
+        double suma = 0;
+        for (size_t r = 0; r < n; ++r) {
+            pesos[r] = 1.0 / pow(static_cast<double>(r + 1) + DESPLAZAMIENTO_ZIPF, EXPONENTE_ZIPF);
+            suma += pesos[r];
+        }
+        vector<uint32_t> chicos, grandes;
+        for (size_t r = 0; r < n; ++r) {
+            pesos[r] *= static_cast<double>(n) / suma;
+            (pesos[r] < 1.0 ? chicos : grandes).push_back(static_cast<uint32_t>(r));
+        }
+        while (!chicos.empty() && !grandes.empty()) {
+            uint32_t chico = chicos.back();
+            chicos.pop_back();
+            uint32_t grande = grandes.back();
+            probabilidad[chico] = pesos[chico];
+            alias[chico] = grande;
+            pesos[grande] -= 1.0 - pesos[chico];
+            if (pesos[grande] < 1.0) {
+                grandes.pop_back();
+                chicos.push_back(grande);
+            }
+        }
+        for (uint32_t r : chicos) {
+            probabilidad[r] = 1.0;
+        }
+        for (uint32_t r : grandes) {
+            probabilidad[r] = 1.0;
+        }
+    }
+
+    uint32_t elegir(mt19937_64& generador) const {
+        uint64_t azar = generador();
+        uint32_t columna = static_cast<uint32_t>((azar >> 32) * probabilidad.size() >> 32);
+        double moneda = static_cast<double>(azar & 0xffffffffu) / 4294967296.0;
+        return moneda < probabilidad[columna] ? columna : alias[columna];
+    }
+};
+
+// Vocabulario: las palabras comunes y despues palabras de 1 a 4 silabas, distintas, en un orden que depende de la semilla
+vector<string> crearVocabulario(uint64_t semilla) {
+    vector<string> vocabulario = palabrasComunes;
+    unordered_set<string> usadas(palabrasComunes.begin(), palabrasComunes.end());
+    mt19937_64 generador(semilla);
+    uniform_int_distribution<size_t> silaba(0, silabas.size() - 1);
+    discrete_distribution<int> largo({0, 10, 35, 35, 20});  // silabas por palabra
+    while (vocabulario.size() < PALABRAS_VOCABULARIO) {
+        string palabra;
+        for (int s = largo(generador); s > 0; --s) {
+            palabra += silabas[silaba(generador)];
+        }
+        if (usadas.insert(palabra).second) {
+            vocabulario.push_back(move(palabra));
+        }
+    }
+    return vocabulario;
+}
+
+// Texto de un documento de aproximadamente 'bytes' bytes
+string generarDocumento(size_t bytes, uint64_t semilla, uint64_t documento, const vector<string>& vocabulario, const TablaAlias& zipf) {
+    seed_seq semillas{static_cast<uint32_t>(semilla), static_cast<uint32_t>(semilla >> 32), static_cast<uint32_t>(documento),
+                      static_cast<uint32_t>(documento >> 32)};
+    mt19937_64 generador(semillas);
+    uniform_int_distribution<int> largoOracion(4, 28);
+    uniform_int_distribution<int> porcentaje(0, 99);
+    string texto;
+    texto.reserve(bytes + 128);
+    size_t columna = 0;
+    int oracionesParrafo = 0;
+    while (texto.size() < bytes) {
+        int palabras = largoOracion(generador);
+        for (int p = 0; p < palabras; ++p) {
+            const string& palabra = vocabulario[zipf.elegir(generador)];
+            if (columna > 0) {
+                if (columna + 1 + palabra.size() > ANCHO_LINEA) {
+                    texto += '\n';
+                    columna = 0;
+                } else {
+                    texto += ' ';
+                    ++columna;
+                }
+            }
+            size_t inicio = texto.size();
+            texto += palabra;
+            if (p == 0 && texto[inicio] >= 'a' && texto[inicio] <= 'z') {
+                texto[inicio] = static_cast<char>(texto[inicio] - 'a' + 'A');
+            }
+            if (p + 1 == palabras) {
+                texto += '.';
+            } else if (porcentaje(generador) < 8) {
+                texto += ',';
+            }
+            columna += texto.size() - inicio;
+        }
+        if (++oracionesParrafo == 6 + porcentaje(generador) % 5) {
+            texto += "\n\n";
+            columna = 0;
+            oracionesParrafo = 0;
+        }
+    }
+    texto += '\n';
+    return texto;
+}
+
+// Tamaño con sufijo K, M o G; 0 si no se entiende
+uint64_t leerTamano(const string& texto) {
+    size_t usados = 0;
+    double valor = 0;
+    try {
+        valor = stod(texto, &usados);
+    } catch (...) {
+        return 0;
+    }
+    string sufijo = texto.substr(usados);
+    double multiplicador = 1;
+    if (sufijo == "K" || sufijo == "k") {
+        multiplicador = 1024.0;
+    } else if (sufijo == "M" || sufijo == "m") {
+        multiplicador = 1024.0 * 1024;
+    } else if (sufijo == "G" || sufijo == "g") {
+        multiplicador = 1024.0 * 1024 * 1024;
+    } else if (!sufijo.empty()) {
+        return 0;
+    }
+    return valor > 0 ? static_cast<uint64_t>(valor * multiplicador) : 0;
+}
+
+string rutaDocumento(const filesystem::path& carpeta, uint64_t documento) {
+    char subcarpeta[24], nombre[40];
+    snprintf(subcarpeta, sizeof(subcarpeta), "%04llu", static_cast<unsigned long long>(documento / DOCUMENTOS_POR_CARPETA));
+    snprintf(nombre, sizeof(nombre), "documento-%08llu.txt", static_cast<unsigned long long>(documento));
+    return (carpeta / subcarpeta / nombre).string();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "uso: " << argv[0] << " <carpeta> <tamaño: bytes o con sufijo K, M o G> [semilla]" << endl;
+        return 1;
+    }
+    filesystem::path carpeta = argv[1];
+    uint64_t bytesPedidos = leerTamano(argv[2]);
+    if (bytesPedidos == 0) {
+        cerr << "Tamaño no valido: " << argv[2] << endl;
+        return 1;
+    }
+    uint64_t semilla = argc > 3 ? stoull(argv[3]) : 2024;
+
+    // Los tamaños se eligen primero, en orden, con su propio generador: no dependen del reparto entre hilos
+    mt19937_64 generadorTamanos(semilla);
+    lognormal_distribution<double> tamano(log(MEDIANA_DOCUMENTO), DISPERSION_DOCUMENTO);
+    vector<size_t> tamanos;
+    uint64_t total = 0;
+    while (total < bytesPedidos) {
+        size_t bytes = static_cast<size_t>(min(max(tamano(generadorTamanos), double(MINIMO_DOCUMENTO)), double(MAXIMO_DOCUMENTO)));
+        bytes = static_cast<size_t>(min<uint64_t>(bytes, max<uint64_t>(bytesPedidos - total, MINIMO_DOCUMENTO)));
+        tamanos.push_back(bytes);
+        total += bytes;
+    }
+
+    auto inicio = chrono::steady_clock::now();
+    vector<string> vocabulario = crearVocabulario(semilla);
+    TablaAlias zipf(vocabulario.size());
+
+    error_code error;
+    for (uint64_t sub = 0; sub * DOCUMENTOS_POR_CARPETA < tamanos.size(); ++sub) {
+        filesystem::create_directories(filesystem::path(rutaDocumento(carpeta, sub * DOCUMENTOS_POR_CARPETA)).parent_path(), error);
+        if (error) {
+            cerr << "No se pudo crear la carpeta " << carpeta << ": " << error.message() << endl;
+            return 1;
+        }
+    }
+
+    PoolHilos pool;
+    atomic<uint64_t> bytesEscritos{0};
+    atomic<bool> fallo{false};
+    for (size_t primero = 0; primero < tamanos.size() && !fallo; primero += DOCUMENTOS_POR_TANDA) {
+        size_t ultimo = min(tamanos.size(), primero + DOCUMENTOS_POR_TANDA);
+        for (size_t documento = primero; documento < ultimo; ++documento) {
+            pool.agregar([&, documento] {
+                string texto = generarDocumento(tamanos[documento], semilla, documento, vocabulario, zipf);
+                string ruta = rutaDocumento(carpeta, documento);
+                ofstream archivo(ruta, ios::binary);
+                if (!archivo.write(texto.data(), static_cast<streamsize>(texto.size()))) {
+                    cerr << "Error al escribir el archivo: " << ruta << endl;
+                    fallo = true;
+                }
+                bytesEscritos += texto.size();
+            });
+        }
+        pool.esperar();
+        double segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+        cout << "\r" << ultimo << " de " << tamanos.size() << " documentos, " << bytesEscritos / (1024 * 1024) << " MiB ("
+             << bytesEscritos / (1024 * 1024) / max(segundos, 1e-9) << " MiB/s)" << flush;
+    }
+    cout << endl;
+    if (fallo) {
+        return 1;
+    }
+
+    ofstream parametros(carpeta / "corpus.parametros");
+    parametros << "semilla " << semilla << "\n"
+               << "bytes_pedidos " << bytesPedidos << "\n"
+               << "bytes_escritos " << bytesEscritos << "\n"
+               << "documentos " << tamanos.size() << "\n"
+               << "vocabulario " << vocabulario.size() << "\n"
+               << "zipf_exponente " << EXPONENTE_ZIPF << "\n"
+               << "zipf_desplazamiento " << DESPLAZAMIENTO_ZIPF << "\n"
+               << "mediana_documento " << MEDIANA_DOCUMENTO << "\n";
+    cout << "corpus generado en " << carpeta.string() << " ("
+         << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - inicio).count() << " ms)" << endl;
+    return 0;
+}
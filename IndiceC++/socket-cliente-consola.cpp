@@ -1,56 +1,502 @@
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <ctime>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <unistd.h>
-#include <cstring> // Para memset
+#include <cstdlib>
+#include "../ii-servidor/Protocolo.h" // tramas con las peticiones y las respuestas
+#include "../ii-servidor/HistogramaLatencias.h" // percentiles de latencia del modo de carga
 
 using namespace std;
 
-int main() {
-    int sock = 0;
-    struct sockaddr_in serv_addr;
-    char buffer[1024] = {0};
+// Cliente de consola del servidor de consultas
+// Varias consultas en una linea, separadas por ';', se envian juntas sin esperar respuesta: el servidor las
+// ejecuta en paralelo y cada respuesta se muestra a medida que llegan sus trozos, en el orden en que terminan.
+// "TODOS <consulta>" pide todos los documentos que la cumplen en vez de los mas relevantes.
+//
+// uso: socket-cliente-consola [direccion] [puerto]
+//      socket-cliente-consola <direccion> <puerto> --carga <consultas.txt> [conexiones] [consultas/s] [segundos]
+// El modo de carga abre varias conexiones y envia las consultas del archivo (una por linea, en orden y dando la
+// vuelta) a un ritmo fijo que no depende de las respuestas, y al final informa el rendimiento y los percentiles
+// de latencia.
 
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        cout << "Socket creation error" << endl;
-        return -1;
+// send puede enviar menos bytes de los pedidos
+bool enviarTodo(int sock, const string& datos) {
+    size_t enviados = 0;
+    while (enviados < datos.size()) {
+        ssize_t n = send(sock, datos.data() + enviados, datos.size() - enviados, 0);
+        if (n <= 0) {
+            return false;
+        }
+        enviados += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Quita los espacios del inicio y del final
+string recortar(const string& texto) {
+    size_t inicio = texto.find_first_not_of(" \t\r");
+    if (inicio == string::npos) {
+        return string();
+    }
+    size_t fin = texto.find_last_not_of(" \t\r");
+    return texto.substr(inicio, fin - inicio + 1);
+}
+
+// ---- Modo de carga ----
+// Lazo abierto: la consulta k tiene su instante previsto (inicio + k / tasa) y se envia entonces aunque las
+// anteriores no hayan vuelto; su latencia se mide desde ese instante y no desde que se envio. Asi un servidor
+// lento no frena al generador ni esconde su demora (omision coordinada): las consultas que esperan en cola
+// cuentan con todo lo que esperaron. Cada hilo atiende sus conexiones con epoll y un timerfd que lo despierta
+// en el siguiente instante previsto; las peticiones de una conexion van seguidas sin esperar respuesta.
+
+const double ESPERA_FINAL = 10;  // segundos que se esperan las respuestas pendientes despues del ultimo envio
+
+struct ConsultaCarga {
+    uint8_t operacion;
+    string texto;
+};
+
+struct ResultadoCarga {
+    HistogramaLatencias latencias;  // nanosegundos, solo de las respuestas correctas
+    uint64_t enviadas = 0;
+    uint64_t correctas = 0;
+    uint64_t errores = 0;        // respuestas con un estado de error
+    uint64_t sinRespuesta = 0;   // conexion cerrada o sin respuesta al terminar la espera
+    int64_t ultimaRespuesta = 0; // instante (ns) de la ultima respuesta
+    int64_t retrasoMaximo = 0;   // lo mas tarde que se envio una consulta respecto de su instante previsto
+};
+
+struct ConexionCarga {
+    int fd = -1;
+    string salida;
+    size_t enviados = 0;
+    string entrada;
+    uint32_t siguienteId = 1;
+    unordered_map<uint32_t, int64_t> enVuelo;  // id -> instante previsto de la peticion
+    bool esperandoEscritura = false;
+};
+
+int64_t ahoraNanosegundos() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return static_cast<int64_t>(t.tv_sec) * 1000000000 + t.tv_nsec;
+}
+
+// Envia lo que quepa sin bloquear; false si la conexion fallo
+bool vaciarSalida(ConexionCarga& conexion) {
+    while (conexion.enviados < conexion.salida.size()) {
+        ssize_t n = send(conexion.fd, conexion.salida.data() + conexion.enviados, conexion.salida.size() - conexion.enviados, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        conexion.enviados += static_cast<size_t>(n);
+    }
+    conexion.salida.clear();
+    conexion.enviados = 0;
+    return true;
+}
+
+// Un hilo de carga: envia las consultas k = hilo, hilo + hilos, ... por sus conexiones, turnandolas
+void generarCarga(vector<ConexionCarga>& conexiones, const vector<ConsultaCarga>& consultas, size_t hilo, size_t hilos,
+                  int64_t inicio, int64_t intervalo, int64_t fin, ResultadoCarga& resultado) {
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    int temporizador = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epoll < 0 || temporizador < 0) {
+        cerr << "No se pudo crear el epoll del hilo de carga: " << strerror(errno) << endl;
+        return;
+    }
+    epoll_event evento{};
+    evento.events = EPOLLIN;
+    evento.data.u64 = conexiones.size();  // el temporizador va despues de las conexiones
+    epoll_ctl(epoll, EPOLL_CTL_ADD, temporizador, &evento);
+    for (size_t i = 0; i < conexiones.size(); ++i) {
+        evento.events = EPOLLIN;
+        evento.data.u64 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, conexiones[i].fd, &evento);
+    }
+
+    auto perder = [&](ConexionCarga& conexion) {
+        resultado.sinRespuesta += conexion.enVuelo.size();
+        conexion.enVuelo.clear();
+        close(conexion.fd);
+        conexion.fd = -1;
+    };
+    auto escribir = [&](size_t i) {
+        ConexionCarga& conexion = conexiones[i];
+        if (!vaciarSalida(conexion)) {
+            perder(conexion);
+            return;
+        }
+        bool pendiente = !conexion.salida.empty();
+        if (pendiente != conexion.esperandoEscritura) {
+            epoll_event cambio{};
+            cambio.events = EPOLLIN | (pendiente ? static_cast<uint32_t>(EPOLLOUT) : 0);
+            cambio.data.u64 = i;
+            epoll_ctl(epoll, EPOLL_CTL_MOD, conexion.fd, &cambio);
+            conexion.esperandoEscritura = pendiente;
+        }
+    };
+
+    uint64_t k = hilo;
+    size_t turno = 0;
+    vector<char> bufer(64 * 1024);
+    vector<epoll_event> eventos(64);
+    while (true) {
+        int64_t ahora = ahoraNanosegundos();
+        // Las consultas cuyo instante ya paso; si el hilo se atraso, salen todas juntas con su instante original
+        int64_t previsto = inicio + static_cast<int64_t>(k) * intervalo;
+        while (previsto < fin && previsto <= ahora) {
+            size_t i = turno++ % conexiones.size();
+            for (size_t intento = 0; conexiones[i].fd < 0 && intento < conexiones.size(); ++intento) {
+                i = turno++ % conexiones.size();
+            }
+            ConexionCarga& conexion = conexiones[i];
+            if (conexion.fd < 0) {
+                ++resultado.sinRespuesta;  // no queda ninguna conexion abierta
+            } else {
+                const ConsultaCarga& consulta = consultas[k % consultas.size()];
+                uint32_t id = conexion.siguienteId++;
+                escribirTrama(conexion.salida, id, consulta.operacion, consulta.texto);
+                conexion.enVuelo[id] = previsto;
+                escribir(i);
+            }
+            ++resultado.enviadas;
+            resultado.retrasoMaximo = max(resultado.retrasoMaximo, ahora - previsto);
+            k += hilos;
+            previsto = inicio + static_cast<int64_t>(k) * intervalo;
+        }
+
+        bool pendientes = false;
+        for (const ConexionCarga& conexion : conexiones) {
+            pendientes = pendientes || !conexion.enVuelo.empty();
+        }
+        int64_t limite = fin + static_cast<int64_t>(ESPERA_FINAL * 1e9);
+        if (previsto >= fin && (!pendientes || ahora >= limite)) {
+            break;
+        }
+        itimerspec alarma{};
+        int64_t despertar = previsto < fin ? previsto : limite;
+        alarma.it_value.tv_sec = despertar / 1000000000;
+        alarma.it_value.tv_nsec = despertar % 1000000000;
+        timerfd_settime(temporizador, TFD_TIMER_ABSTIME, &alarma, nullptr);
+
+        int n = epoll_wait(epoll, eventos.data(), static_cast<int>(eventos.size()), -1);
+        if (n < 0 && errno != EINTR) {
+            cerr << "epoll_wait fallo: " << strerror(errno) << endl;
+            break;
+        }
+        for (int e = 0; e < n; ++e) {
+            size_t i = eventos[e].data.u64;
+            if (i == conexiones.size()) {
+                uint64_t vencimientos;
+                ssize_t leido = read(temporizador, &vencimientos, sizeof(vencimientos));
+                (void)leido;
+                continue;
+            }
+            ConexionCarga& conexion = conexiones[i];
+            if (conexion.fd < 0) {
+                continue;
+            }
+            if (eventos[e].events & EPOLLOUT) {
+                escribir(i);
+                if (conexion.fd < 0) {
+                    continue;
+                }
+            }
+            if (!(eventos[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                continue;
+            }
+            bool cerrada = false;
+            while (true) {
+                ssize_t leido = recv(conexion.fd, bufer.data(), bufer.size(), 0);
+                if (leido > 0) {
+                    conexion.entrada.append(bufer.data(), static_cast<size_t>(leido));
+                    continue;
+                }
+                cerrada = leido == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+                break;
+            }
+            int64_t llegada = ahoraNanosegundos();
+            size_t usados = 0;
+            while (true) {
+                Trama trama;
+                size_t bytes = leerTrama(conexion.entrada.data() + usados, conexion.entrada.size() - usados, trama, MAXIMO_CUERPO_RESPUESTA);
+                if (bytes == TRAMA_INCOMPLETA) {
+                    break;
+                }
+                if (bytes == TRAMA_INVALIDA) {
+                    cerrada = true;
+                    break;
+                }
+                usados += bytes;
+                auto it = conexion.enVuelo.find(trama.id);
+                if (trama.codigo == ESTADO_PARCIAL || it == conexion.enVuelo.end()) {
+                    continue;
+                }
+                if (trama.codigo == ESTADO_OK) {
+                    ++resultado.correctas;
+                    resultado.latencias.registrar(static_cast<uint64_t>(max<int64_t>(0, llegada - it->second)));
+                } else {
+                    ++resultado.errores;
+                }
+                resultado.ultimaRespuesta = llegada;
+                conexion.enVuelo.erase(it);
+            }
+            conexion.entrada.erase(0, usados);
+            if (cerrada) {
+                perder(conexion);
+            }
+        }
+    }
+    for (ConexionCarga& conexion : conexiones) {
+        if (conexion.fd >= 0) {
+            resultado.sinRespuesta += conexion.enVuelo.size();
+            close(conexion.fd);
+        }
+    }
+    close(temporizador);
+    close(epoll);
+}
+
+// Lee las consultas (una por linea; las lineas vacias y las que empiezan con '#' se saltan)
+bool leerConsultasCarga(const string& ruta, vector<ConsultaCarga>& consultas) {
+    ifstream archivo(ruta);
+    if (!archivo) {
+        cerr << "No se pudo abrir el archivo de consultas: " << ruta << endl;
+        return false;
+    }
+    string linea;
+    while (getline(archivo, linea)) {
+        string consulta = recortar(linea);
+        if (consulta.empty() || consulta[0] == '#') {
+            continue;
+        }
+        uint8_t operacion = OPERACION_CONSULTA;
+        if (consulta.rfind("TODOS ", 0) == 0) {
+            operacion = OPERACION_TODOS;
+            consulta = recortar(consulta.substr(6));
+        }
+        consultas.push_back({operacion, consulta});
+    }
+    if (consultas.empty()) {
+        cerr << "El archivo de consultas esta vacio: " << ruta << endl;
+        return false;
+    }
+    return true;
+}
+
+int ejecutarCarga(const sockaddr_in& servidor, const string& rutaConsultas, size_t numeroConexiones, double tasa, double segundos) {
+    vector<ConsultaCarga> consultas;
+    if (!leerConsultasCarga(rutaConsultas, consultas)) {
+        return 1;
+    }
+    if (numeroConexiones == 0 || tasa <= 0 || segundos <= 0) {
+        cerr << "Las conexiones, las consultas por segundo y los segundos deben ser mayores que cero" << endl;
+        return 1;
+    }
+    rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limite);
+    }
+
+    // Todas las conexiones se abren antes de empezar a medir
+    size_t hilos = min<size_t>(numeroConexiones, max(1u, thread::hardware_concurrency()));
+    vector<vector<ConexionCarga>> porHilo(hilos);
+    for (size_t c = 0; c < numeroConexiones; ++c) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&servidor), sizeof(servidor)) < 0) {
+            cerr << "No se pudo abrir la conexion " << c + 1 << ": " << strerror(errno) << endl;
+            if (fd >= 0) {
+                close(fd);
+            }
+            for (auto& conexiones : porHilo) {
+                for (ConexionCarga& conexion : conexiones) {
+                    close(conexion.fd);
+                }
+            }
+            return 1;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        ConexionCarga conexion;
+        conexion.fd = fd;
+        porHilo[c % hilos].push_back(move(conexion));
     }
 
+    int64_t intervalo = max<int64_t>(1, static_cast<int64_t>(1e9 / tasa));
+    int64_t inicio = ahoraNanosegundos() + 10000000;  // 10 ms para que arranquen los hilos
+    int64_t fin = inicio + static_cast<int64_t>(segundos * 1e9);
+    vector<ResultadoCarga> resultados(hilos);
+    vector<thread> trabajadores;
+    for (size_t h = 0; h < hilos; ++h) {
+        trabajadores.emplace_back(generarCarga, ref(porHilo[h]), cref(consultas), h, hilos, inicio, intervalo, fin, ref(resultados[h]));
+    }
+    for (thread& trabajador : trabajadores) {
+        trabajador.join();
+    }
+
+    ResultadoCarga total;
+    for (const ResultadoCarga& resultado : resultados) {
+        total.latencias.sumar(resultado.latencias);
+        total.enviadas += resultado.enviadas;
+        total.correctas += resultado.correctas;
+        total.errores += resultado.errores;
+        total.sinRespuesta += resultado.sinRespuesta;
+        total.ultimaRespuesta = max(total.ultimaRespuesta, resultado.ultimaRespuesta);
+        total.retrasoMaximo = max(total.retrasoMaximo, resultado.retrasoMaximo);
+    }
+    double duracion = max(static_cast<double>(max(total.ultimaRespuesta, fin) - inicio) / 1e9, 1e-9);
+    auto ms = [](uint64_t nanosegundos) { return static_cast<double>(nanosegundos) / 1e6; };
+    cout << numeroConexiones << " conexiones, " << hilos << " hilos, " << tasa << " consultas/s previstas durante " << segundos
+         << " s (" << consultas.size() << " consultas distintas)" << endl;
+    cout << "enviadas: " << total.enviadas << ", correctas: " << total.correctas << ", con error: " << total.errores
+         << ", sin respuesta: " << total.sinRespuesta << endl;
+    cout << "rendimiento: " << static_cast<double>(total.correctas + total.errores) / duracion << " respuestas/s" << endl;
+    cout << "latencia (ms): min " << ms(total.latencias.menor()) << ", p50 " << ms(total.latencias.percentil(50)) << ", p90 "
+         << ms(total.latencias.percentil(90)) << ", p99 " << ms(total.latencias.percentil(99)) << ", p99.9 "
+         << ms(total.latencias.percentil(99.9)) << ", max " << ms(total.latencias.mayor()) << ", promedio "
+         << total.latencias.promedio() / 1e6 << endl;
+    // Si el generador se atrasa mucho es el que no da abasto: la medicion sigue siendo correcta, pero la carga no
+    // fue la prevista
+    cout << "atraso maximo del generador: " << ms(static_cast<uint64_t>(total.retrasoMaximo)) << " ms" << endl;
+    return total.sinRespuesta == 0 && total.errores == 0 ? 0 : 2;
+}
+
+int main(int argc, char* argv[]) {
+    const char* direccion = argc > 1 ? argv[1] : "127.0.0.1";
+    int puerto = argc > 2 ? atoi(argv[2]) : 8080;
+    int sock = 0;
+    struct sockaddr_in serv_addr{};
+
     serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(8080);
+    serv_addr.sin_port = htons(static_cast<uint16_t>(puerto));
 
-    if (inet_pton(AF_INET, "192.168.1.3", &serv_addr.sin_addr) <= 0) {
+    if (inet_pton(AF_INET, direccion, &serv_addr.sin_addr) <= 0) {
         cout << "Invalid address/ Address not supported" << endl;
         return -1;
     }
 
+    if (argc > 4 && string(argv[3]) == "--carga") {
+        return ejecutarCarga(serv_addr, argv[4], argc > 5 ? strtoul(argv[5], nullptr, 10) : 16, argc > 6 ? atof(argv[6]) : 1000,
+                             argc > 7 ? atof(argv[7]) : 10);
+    }
+
+    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        cout << "Socket creation error" << endl;
+        return -1;
+    }
+
     if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
         cout << "Connection failed" << endl;
         return -1;
     }
 
     string input;
-    while (true) {
-        cout << "Ingrese las palabras a buscar (formato: palabra1 operador palabra2, o 'exit' para salir): ";
-        getline(cin, input);
-
-        if (input == "exit") {
+    string recibidos;  // bytes de tramas que aun no llegan enteras
+    vector<char> buffer(64 * 1024);
+    uint32_t siguienteId = 1;
+    bool conectado = true;
+    while (conectado) {
+        cout << "Ingrese las palabras a buscar (formato: palabra1 operador palabra2; varias consultas separadas por ';'; "
+                "'TODOS consulta' para todos los documentos; 'exit' para salir): ";
+        if (!getline(cin, input) || input == "exit") {
             break;
         }
 
-        send(sock, input.c_str(), input.length(), 0);
-
-        int valread = read(sock, buffer, 1024);
-        if (valread > 0) {
-            cout << "Archivos encontrados:\n" << buffer << endl;
-        } else {
-            cout << "No se recibió respuesta del servidor." << endl;
+        // Todas las consultas de la linea van en un solo envio
+        string salida;
+        unordered_map<uint32_t, string> pendientes;  // id -> consulta que aun no termina de responderse
+        unordered_map<uint32_t, size_t> lineas;      // id -> documentos recibidos
+        size_t inicio = 0;
+        while (inicio <= input.size()) {
+            size_t fin = input.find(';', inicio);
+            string consulta = recortar(input.substr(inicio, fin == string::npos ? string::npos : fin - inicio));
+            inicio = fin == string::npos ? input.size() + 1 : fin + 1;
+            if (consulta.empty()) {
+                continue;
+            }
+            uint8_t operacion = OPERACION_CONSULTA;
+            if (consulta.rfind("TODOS ", 0) == 0) {
+                operacion = OPERACION_TODOS;
+                consulta = recortar(consulta.substr(6));
+            }
+            escribirTrama(salida, siguienteId, operacion, consulta);
+            pendientes[siguienteId++] = consulta;
+        }
+        if (pendientes.empty()) {
+            continue;
+        }
+        if (!enviarTodo(sock, salida)) {
+            cout << "No se pudo enviar la consulta." << endl;
+            break;
         }
 
-        memset(buffer, 0, sizeof(buffer));
+        bool varias = pendientes.size() > 1;
+        uint32_t ultimoMostrado = 0;
+        while (!pendientes.empty()) {
+            Trama trama;
+            size_t bytes = leerTrama(recibidos.data(), recibidos.size(), trama, MAXIMO_CUERPO_RESPUESTA);
+            if (bytes == TRAMA_INVALIDA) {
+                cout << "Respuesta invalida del servidor." << endl;
+                conectado = false;
+                break;
+            }
+            if (bytes == TRAMA_INCOMPLETA) {
+                ssize_t valread = read(sock, buffer.data(), buffer.size());
+                if (valread <= 0) {
+                    cout << "No se recibió respuesta del servidor." << endl;
+                    conectado = false;
+                    break;
+                }
+                recibidos.append(buffer.data(), static_cast<size_t>(valread));
+                continue;
+            }
+            auto it = pendientes.find(trama.id);
+            if (it != pendientes.end()) {
+                if (varias && trama.id != ultimoMostrado) {
+                    cout << "--- " << it->second << " ---" << endl;  // los trozos de varias respuestas pueden alternarse
+                    ultimoMostrado = trama.id;
+                }
+                if (trama.codigo == ESTADO_OK || trama.codigo == ESTADO_PARCIAL) {
+                    if (!trama.cuerpo.empty() && lineas[trama.id] == 0 && !varias) {
+                        cout << "Archivos encontrados:" << endl;
+                    }
+                    for (char c : trama.cuerpo) {
+                        lineas[trama.id] += c == '\n';
+                    }
+                    cout << trama.cuerpo;
+                    if (trama.codigo == ESTADO_OK && lineas[trama.id] == 0) {
+                        cout << (trama.cuerpo.empty() ? "No se encontraron resultados." : "") << endl;
+                    }
+                } else {
+                    cout << "Error: " << trama.cuerpo << endl;
+                }
+                if (trama.codigo != ESTADO_PARCIAL) {
+                    pendientes.erase(it);
+                }
+            } else if (trama.codigo == ESTADO_TRAMA_INVALIDA) {
+                cout << "Error: " << trama.cuerpo << endl;
+                conectado = false;
+                break;
+            }
+            recibidos.erase(0, bytes);
+        }
     }
 
     close(sock);
     return 0;
-}
\ No newline at end of file
+}
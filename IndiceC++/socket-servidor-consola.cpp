@@ -5,359 +5,658 @@
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
+#include <deque>
 #include <thread>
 #include <mutex>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
 #include <functional>
-
-#pragma comment(lib, "ws2_32.lib")
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../ii-servidor/IndiceInvertido.h" // Trie de doble arreglo y funciones del indice compartidas con el servidor Qt
+#include "../ii-servidor/ArchivoIndice.h" // indice guardado en disco
+#include "../ii-servidor/IndicePublicado.h" // versiones del indice que se leen sin candados
+#include "../ii-servidor/CacheConsultas.h" // resultados de las consultas repetidas
+#include "../ii-servidor/PoolHilos.h" // hilos que ejecutan las consultas
+#include "../ii-servidor/Consulta.h" // plan de las consultas que piden todos los documentos
+#include "../ii-servidor/Protocolo.h" // tramas con las peticiones y las respuestas
+#include "../ii-servidor/Metricas.h" // contadores de la construccion y de las consultas (STATS)
 
 using namespace std;
 
-// Nodo del Trie
-struct Node {
-    unordered_map<char, Node*> children; // hijo, contiene un caracter y una referencia a un hijo
-    unordered_set<string> nombresArchivos;  // archivos que contienen la palabra hasta ese punto
-};
-
-// Clase Trie
-class Trie {
+// Servidor de consultas para Linux basado en epoll
+// Unos pocos hilos de E/S atienden todas las conexiones con sockets no bloqueantes. Cada hilo tiene su propio
+// epoll y acepta conexiones del socket que escucha (EPOLLEXCLUSIVE despierta a uno solo por conexion nueva),
+// asi que una conexion vive siempre en el hilo que la acepto y sus datos no necesitan candados. Las peticiones
+// llegan en tramas (Protocolo.h) y cada una se ejecuta en el pool de hilos por separado: un cliente puede enviar
+// muchas sin esperar y recibe cada respuesta cuando termina, en cualquier orden. La respuesta vuelve al hilo de
+// la conexion por una cola y un eventfd, y se envia de a trozos solo cuando el socket tiene espacio, turnando
+// las respuestas de la conexion; una lista larga de documentos nunca se arma entera en memoria.
+// Cada consulta fija la version del indice que esta publicada al empezar (IndicePublicado) y la usa hasta enviar
+// el ultimo nombre; un comando de administracion publica una version nueva sin detener a las consultas.
+// Con SIGINT o SIGTERM el servidor deja de aceptar, termina las consultas en curso, envia sus respuestas y cierra.
+// Las metricas (STATS) se escriben tambien en formato de Prometheus en un archivo cada INTERVALO_METRICAS.
+
+// Cargamos las palabras vacias (no aportan informacion) del archivo
+unordered_set<string> cargarStopWords(const string& carpeta) {
+    ifstream archivoEntrada(carpeta + "/stop_words_spanish.txt"); // archivo de palabras vacias
+    unordered_set<string> stopWords; // almacena las palabras vacías
+    if (archivoEntrada) { // si el archivo de StopWords se pudo abrir
+        string palabra;
+        while (getline(archivoEntrada, palabra)) { // para cada palabra en el archivo
+            stopWords.insert(palabra); // la palabra se almacena en 'stopWords'
+        }
+    } else { // en caso no se pudo abrir
+        cerr << "Error al abrir el archivo de palabras vacias." << endl; // mensaje de error
+    }
+    return stopWords;
+}
 
-private:
-    Node* root; // nodo inicial
+string carpetaTextos = ".";  // los textos que se indexan; los comandos ADMIN solo alcanzan archivos de esta carpeta
+const string rutaIndice = "indice-servidor.iidx";
+CacheConsultas cacheConsultas;  // se invalida sola cuando un comando cambia el indice
+MetricasConsultas metricasConsultas;
+const string rutaMetricas = "metricas-servidor.prom";
+const auto INTERVALO_METRICAS = chrono::seconds(15);
+
+const uint16_t PUERTO_SERVIDOR = 8080;
+const size_t HILOS_ENTRADA_SALIDA = 2;
+const size_t MAXIMO_ENTRADA = 4 * (BYTES_CABECERA + MAXIMO_CUERPO_PETICION);  // bytes recibidos sin procesar por conexion
+const size_t MAXIMO_EN_VUELO = 64;  // peticiones de una conexion en el pool; las demas esperan en su bufer
+const auto ESPERA_MAXIMA_CIERRE = chrono::seconds(5);  // para terminar las consultas en curso al detener
+
+// Respuesta a una peticion, calculada en un hilo del pool. Los documentos de OPERACION_TODOS quedan como IDs y
+// el hilo de E/S escribe sus nombres a medida que los envia, de la misma version del indice que los encontro.
+struct Respuesta {
+    int fd;
+    uint64_t conexion;
+    uint32_t peticion;
+    uint8_t estado = ESTADO_OK;  // el de la ultima trama
+    string texto;
+    ListaPostings documentos;
+    shared_ptr<const VersionIndice> version;  // con 'documentos'
+    size_t enviado = 0;  // bytes de 'texto' o documentos ya puestos en tramas
+};
 
-public:
-    Trie() {
-        root = new Node(); // constructor, crea nodo inicial
+// Ejecuta una consulta o un comando (en un hilo del pool)
+void responder(uint8_t operacion, const string& entrada, IndicePublicado& indice, Respuesta& respuesta) {
+    auto inicio = MetricasConsultas::empezar();
+    if (operacion != OPERACION_CONSULTA && operacion != OPERACION_TODOS) {
+        respuesta.estado = ESTADO_OPERACION_DESCONOCIDA;
+        respuesta.texto = "operacion desconocida: " + to_string(operacion);
+        return;
     }
-
-    // Insertar una palabra y el nombre de su archivo en el Trie
-    void insertar(const string& palabra, const string& nombreArchivo) { 
-        Node* node = root; // nodo inicial
-        for (char letra : palabra) { // para cada letra en nuestra palabra
-            if (!node->children.count(letra)) { // si existe aun un hijo con esa letra
-                node->children[letra] = new Node(); // creamos un nuevo nodo hijo con dicha letra
-            }
-            node = node->children[letra]; // nos movemos al nodo hijo que contiene la letra
+    if (esComandoCache(entrada)) {
+        metricasConsultas.registrarComando();
+        respuesta.texto = describirEstadisticas(cacheConsultas.estadisticas());
+        return;
+    }
+    if (esComandoMetricas(entrada)) {
+        metricasConsultas.registrarComando();
+        respuesta.texto = textoMetricas(*indice.fijar(), cacheConsultas.estadisticas(), metricasConsultas);
+        return;
+    }
+    if (esComandoAdministracion(entrada)) {
+        metricasConsultas.registrarComando();
+        // el indice compactado se guarda para usarlo en el proximo arranque
+        ComandoAdministracion comando = ejecutarComandoAdministracion(entrada, carpetaTextos, indice, respuesta.texto, rutaIndice);
+        if (comando == COMANDO_FALLIDO || comando == NO_ES_COMANDO) {
+            respuesta.estado = ESTADO_COMANDO_FALLIDO;
         }
-        node->nombresArchivos.insert(nombreArchivo); // insertamos el nombre del archivo (final de palabra)
+        return;
     }
-
-    // Buscar los archivos que contienen la palabra
-    unordered_set<string> buscar(string& palabra) {
-        Node* node = root; // nodo inicial
-        for (char letra : palabra) { // para cada letra en nuestra palabra
-            if (!node->children.count(letra)) { // si no existe un hijo con esa letra
-                return {}; // no existe, devolvemos un conjunto vacío
-            }
-            node = node->children[letra]; // nos movemos al nodo hijo que contiene la letra
+    NodoConsulta consulta;
+    if (!analizarConsulta(entrada, consulta, respuesta.texto)) {
+        metricasConsultas.registrarInvalida();
+        respuesta.estado = ESTADO_CONSULTA_INVALIDA;
+        return;
+    }
+    shared_ptr<const VersionIndice> version = indice.fijar();
+    const TablaDocumentos& documentos = version->documentos;
+    if (operacion == OPERACION_TODOS) {
+        NodoPlan plan = planificarConsulta(version->trie, documentos, consulta);
+        respuesta.documentos = ejecutarPlan(plan, version->trie, documentos);
+        metricasConsultas.registrarConsulta(consulta.tipo, true, inicio, respuesta.documentos.size());
+        if (!respuesta.documentos.empty()) {
+            respuesta.version = move(version);
         }
-        return node->nombresArchivos; // retorna los archivos a los que pertenece el ultimo nodo (final de palabra)
+        return;
+    }
+    vector<ResultadoBusqueda> resultados = buscarRankingConCache(cacheConsultas, version->trie, documentos, consulta);  // los mas relevantes primero
+    for (const ResultadoBusqueda& resultado : resultados) {
+        respuesta.texto += documentos.obtener(resultado.documento).nombre + "\n";
     }
+    metricasConsultas.registrarConsulta(consulta.tipo, false, inicio, resultados.size());
+}
 
+// Lo que comparten los hilos de E/S
+struct Servidor {
+    IndicePublicado& indice;
+    PoolHilos& pool;
+    int escucha = -1;
+    atomic<bool> deteniendo{false};
+    atomic<size_t> conexiones{0};
+    atomic<uint64_t> siguienteId{0};
+};
 
+class HiloEntradaSalida {
+private:
+    struct Conexion {
+        int fd;
+        uint64_t id;            // distingue esta conexion de una posterior que reciba el mismo descriptor
+        string entrada;         // bytes recibidos con tramas que aun no se envian al pool
+        string salida;          // tramas que falta enviar desde 'enviados'
+        size_t enviados = 0;
+        deque<Respuesta> pendientes;  // respuestas que faltan poner en tramas; se turnan de a un trozo
+        size_t enVuelo = 0;     // peticiones en el pool
+        bool cerrada = false;   // ya no se lee: se cierra cuando no quede nada por responder
+        bool pausada = false;   // se dejo de leer con el bufer lleno; se sigue cuando se procesen sus tramas
+        bool fallida = false;   // error del socket: se cierra sin mas
+    };
+
+    Servidor& servidor;
+    int epoll = -1;
+    int despertar = -1;  // eventfd: hay respuestas en la cola o hay que detenerse
+    int reserva = -1;    // descriptor libre para rechazar conexiones cuando se acaban los descriptores
+    unordered_map<int, unique_ptr<Conexion>> conexiones;
+    mutex mxRespuestas;
+    vector<Respuesta> respuestas;
+    vector<char> bufer = vector<char>(64 * 1024);  // una lectura, compartida por las conexiones del hilo
+    thread hilo;
+
+    void aceptar();
+    void leer(Conexion& conexion);
+    void separarPeticiones(Conexion& conexion);
+    void escribir(Conexion& conexion);
+    bool ponerTrozo(Respuesta& respuesta, string& salida);
+    void procesarRespuestas();
+    bool terminada(const Conexion& conexion) const {
+        return conexion.fallida || (conexion.cerrada && conexion.enVuelo == 0 && conexion.pendientes.empty() &&
+                                    conexion.enviados == conexion.salida.size());
+    }
+    void revisar(int fd);  // cierra la conexion si ya termino
+    void atender();
+
+public:
+    explicit HiloEntradaSalida(Servidor& compartido) : servidor(compartido) {}
+    ~HiloEntradaSalida();
+
+    bool iniciar();
+    // Deja la respuesta para su conexion y despierta al hilo (se llama desde el pool)
+    void entregar(Respuesta respuesta);
+    void avisar();  // despierta al hilo para que vea que el servidor se detiene
+    void esperar() { if (hilo.joinable()) hilo.join(); }
 };
 
-// Función para recolectar los archivos de texto
-unordered_map<string, string> recolectarArchivos(vector<string> &nombresArchivos) {
-    unordered_map<string, string> archivosRecolectados; // mapa de archivos recolectados (nombre archivo - contenido)
-    for (string& nombre : nombresArchivos) {  // para cada archivo
-        ifstream archivoEntrada(nombre); // lo lee (modo lectura ifstream)
-        if (archivoEntrada) { // si se pudo abrir
-            stringstream texto; // se crea un stream para el texto
-            texto << archivoEntrada.rdbuf(); // se almacena el contenido en 'texto'
-            archivosRecolectados[nombre] = texto.str(); // el texto se almacena en el nombre del archivo en 'archivosRecolectados'
-        } else { // no se pudo abrir
-            cerr << "Error al abrir el archivo: " << nombre << endl; // imprime mensaje error
+HiloEntradaSalida::~HiloEntradaSalida() {
+    esperar();
+    for (auto& [fd, conexion] : conexiones) {
+        close(fd);
+    }
+    for (int fd : {epoll, despertar, reserva}) {
+        if (fd >= 0) {
+            close(fd);
         }
     }
-    return archivosRecolectados; // retorna los archivos recolectados
 }
 
-// Función para eliminar signos de puntuación y saltos de linea
-string eliminarSignos(string& texto) {
-    string nuevoTexto; // almacena el nuevo texto
-    for (char caracter : texto) { // para cada caracter en el texto
-        if (isalnum(caracter) || caracter == ' ') { // si es alfanumerico o espacio en blanco
-            nuevoTexto += caracter; // lo añade a nuevoTexto
-        } else if (caracter == '\n') { // si es salto de linea
-            nuevoTexto += " "; // añade un espacio
-        }
+bool HiloEntradaSalida::iniciar() {
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    despertar = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reserva = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (epoll < 0 || despertar < 0) {
+        cerr << "No se pudo crear el epoll del hilo de E/S: " << strerror(errno) << endl;
+        return false;
+    }
+    epoll_event evento{};
+    evento.events = EPOLLIN;
+    evento.data.fd = despertar;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, despertar, &evento) < 0) {
+        cerr << "epoll_ctl fallo: " << strerror(errno) << endl;
+        return false;
     }
-    return nuevoTexto; // retorna el nuevo texto
+    evento.events = EPOLLIN | EPOLLEXCLUSIVE;
+    evento.data.fd = servidor.escucha;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, servidor.escucha, &evento) < 0) {
+        cerr << "epoll_ctl fallo: " << strerror(errno) << endl;
+        return false;
+    }
+    hilo = thread(&HiloEntradaSalida::atender, this);
+    return true;
 }
 
-// Función para tokenizar un texto (separa palabra por palabra)
-vector<string> tokenizarTexto(string& texto) {
-    vector<string> listaPalabras; // lista de palabras
-    
-    // istringstream sirve para tratar un string como si fuera un stream de entrada
-    istringstream stream(texto); // se crea un stream para el texto
-    string palabra; // almacena una palabra
-
-    // Se extraen palabra por palabra del stream y se almacenan en la lista
-    while (stream >> palabra) { // mientras se pueda extraer una palabra
-        listaPalabras.push_back(palabra);  // esa palabra se almacena en la lista
+void HiloEntradaSalida::entregar(Respuesta respuesta) {
+    {
+        lock_guard<mutex> candado(mxRespuestas);
+        respuestas.push_back(move(respuesta));
     }
-    return listaPalabras; // retorna la lista de palabras (vector)
+    avisar();
 }
 
-// Función para eliminar palabras que no brindan informacion
-vector<string> eliminarStopWords(vector<string>& listaPalabras, unordered_set<string>& stopWords) {
-    vector<string> palabrasFiltradas; // almacena las palabras filtradas
-    for (string& palabra : listaPalabras) { // para cada palabra en nuestra lista de palabras
-        // Se verifica si la palabra no está en el conjunto de palabras vacías
-        if (stopWords.find(palabra) == stopWords.end()) { // si esa palabra no esta en los StopWords
-            palabrasFiltradas.push_back(palabra); // la palabra se almacena en palabrasFiltradass
+void HiloEntradaSalida::avisar() {
+    uint64_t uno = 1;
+    ssize_t escrito = write(despertar, &uno, sizeof(uno));  // solo falla si el contador se desborda: ya hay aviso
+    (void)escrito;
+}
+
+void HiloEntradaSalida::aceptar() {
+    while (true) {
+        int fd = accept4(servidor.escucha, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && reserva >= 0) {
+                // Sin descriptores la conexion quedaria en la cola y epoll avisaria sin parar: se libera la
+                // reserva para aceptarla y cerrarla de inmediato
+                cerr << "Sin descriptores libres: se rechaza una conexion" << endl;
+                close(reserva);
+                int rechazada = accept(servidor.escucha, nullptr, nullptr);
+                if (rechazada >= 0) {
+                    close(rechazada);
+                }
+                reserva = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                cerr << "Accept failed: " << strerror(errno) << endl;
+            }
+            return;
         }
+        int uno = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));  // respuestas cortas: no esperar a juntar mas
+        // Flanco: cada aviso se atiende leyendo o escribiendo hasta EAGAIN, y EPOLLOUT no hace falta quitarlo
+        epoll_event evento{};
+        evento.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        evento.data.fd = fd;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &evento) < 0) {
+            cerr << "epoll_ctl fallo: " << strerror(errno) << endl;
+            close(fd);
+            continue;
+        }
+        auto conexion = make_unique<Conexion>();
+        conexion->fd = fd;
+        conexion->id = servidor.siguienteId.fetch_add(1, memory_order_relaxed);
+        conexiones[fd] = move(conexion);
+        servidor.conexiones.fetch_add(1, memory_order_relaxed);
     }
-    return palabrasFiltradas; // retorna las palabras filtradas
 }
 
-// Estructura auxiliar para almacenar la palabra y el nombre del archivo
-struct PalabraArchivo { 
-    string palabra;
-    string nombreArchivo;
-};
-
-// Función para mapear los archivos procesados
-vector<PalabraArchivo> mapearArchivos(unordered_map<string, vector<string>>& archivosProcesados) {
-    PalabraArchivo pa; // usamos la estructura 'PalabraArchivo' para almacenar el nombre de archivo y la palabra
-    vector<PalabraArchivo> datosMappeados; // vector de palabraArchivo
-    // para cada nombre de archivo y lista de palabras en los archivos procesados
-    for (auto& [nombre, listaPalabras] : archivosProcesados) { 
-        for (string& palabra : listaPalabras) { // para cada palabra en la lista de palabras
-            pa.palabra = palabra; // la palabra se almacena en la palabra de la palabraArchivo
-            pa.nombreArchivo = nombre; // el nombre de archivo se almacena en el nombre de archivo de la palabraArchivo
-            datosMappeados.push_back(pa); // la palabraArchivo se almacena en datosMappeados
+void HiloEntradaSalida::leer(Conexion& conexion) {
+    while (true) {
+        bool lleno = false;
+        while (!conexion.cerrada) {
+            if (conexion.entrada.size() >= MAXIMO_ENTRADA) {
+                lleno = true;  // el resto espera en el socket (y el cliente, por control de flujo de TCP)
+                break;
+            }
+            size_t espacio = min(bufer.size(), MAXIMO_ENTRADA - conexion.entrada.size());
+            ssize_t leidos = recv(conexion.fd, bufer.data(), espacio, 0);
+            if (leidos > 0) {
+                conexion.entrada.append(bufer.data(), static_cast<size_t>(leidos));
+            } else if (leidos == 0) {
+                conexion.cerrada = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            } else {
+                conexion.fallida = true;
+                return;
+            }
+        }
+        size_t antes = conexion.entrada.size();
+        separarPeticiones(conexion);
+        conexion.pausada = lleno;
+        if (!lleno || conexion.entrada.size() == antes) {
+            return;  // sin tramas que pasar al pool no hay espacio nuevo para leer
         }
     }
-    return datosMappeados; // retorna los datosMappeados (vector de PalabraArchivo)
 }
 
-// Organización de los datos intermedios: Agrupación por clave (palabra, palabra, ...)
-unordered_map<string, vector<string>> shuffle(vector<PalabraArchivo>& datosMapeados) {
-    unordered_map<string, vector<string>> datosAgrupados; // almacena los datos agrupados (palabra - nombre archivo)
-    for (auto& dato : datosMapeados) { // para cada palabraArchivo de nuestro vector de palabraArchivo
-        datosAgrupados[dato.palabra].push_back(dato.nombreArchivo); // la palabra se almacena como clave y el nombre de archivo como valor
-        // esta asignacion evita repeticiones
+void HiloEntradaSalida::separarPeticiones(Conexion& conexion) {
+    size_t usados = 0;
+    while (conexion.enVuelo < MAXIMO_EN_VUELO && !conexion.fallida) {
+        Trama trama;
+        size_t bytes = leerTrama(conexion.entrada.data() + usados, conexion.entrada.size() - usados, trama, MAXIMO_CUERPO_PETICION);
+        if (bytes == TRAMA_INCOMPLETA) {
+            break;
+        }
+        if (bytes == TRAMA_INVALIDA) {
+            // No se puede saber donde empieza la siguiente: se avisa y se cierra cuando termine lo que esta en curso
+            escribirTrama(conexion.salida, 0, ESTADO_TRAMA_INVALIDA, "peticion de mas de " + to_string(MAXIMO_CUERPO_PETICION) + " bytes");
+            conexion.cerrada = true;
+            conexion.entrada.clear();
+            escribir(conexion);
+            return;
+        }
+        usados += bytes;
+        ++conexion.enVuelo;
+        Respuesta respuesta;
+        respuesta.fd = conexion.fd;
+        respuesta.conexion = conexion.id;
+        respuesta.peticion = trama.id;
+        servidor.pool.agregar([this, respuesta = move(respuesta), operacion = trama.codigo, consulta = string(trama.cuerpo)]() mutable {
+            responder(operacion, consulta, servidor.indice, respuesta);
+            entregar(move(respuesta));
+        });
     }
-    return datosAgrupados; // retorna los datos agrupados
+    conexion.entrada.erase(0, usados);
 }
 
-// Reducir combinando listas de nombre de los archivos para cada palabra usando un Trie
-void reducirDatos(unordered_map<string, vector<string>>& datosAgrupados, Trie& trie) {
-    for (auto& [palabra, nombreArchivo] : datosAgrupados) { // para cada palabra y lista de archivos en los datos agrupados
-        for (auto& nom : nombreArchivo) { // para cada nombre de archivo por palabra
-            // insertamos la palabra y los nombres de los archivos a los que pertenece en el Trie
-            trie.insertar(palabra, nom); 
+bool HiloEntradaSalida::ponerTrozo(Respuesta& respuesta, string& salida) {
+    bool terminada;
+    size_t inicio = abrirTrama(salida, respuesta.peticion, ESTADO_PARCIAL);
+    if (!respuesta.documentos.empty()) {
+        // Los nombres se leen al enviar, de la version fijada (no cambia aunque se publique otra)
+        const TablaDocumentos& documentos = respuesta.version->documentos;
+        size_t limite = salida.size() + TAMANO_TROZO;
+        while (respuesta.enviado < respuesta.documentos.size() && salida.size() < limite) {
+            salida += documentos.obtener(respuesta.documentos[respuesta.enviado++]).nombre;
+            salida += '\n';
         }
+        terminada = respuesta.enviado == respuesta.documentos.size();
+    } else {
+        size_t cantidad = min(TAMANO_TROZO, respuesta.texto.size() - respuesta.enviado);
+        salida.append(respuesta.texto, respuesta.enviado, cantidad);
+        respuesta.enviado += cantidad;
+        terminada = respuesta.enviado == respuesta.texto.size();
+    }
+    if (terminada) {
+        salida[inicio + 8] = static_cast<char>(respuesta.estado);
     }
+    cerrarTrama(salida, inicio);
+    return terminada;
 }
 
-unordered_set<string> procesarEntrada(Trie& trie ,string& entrada){ // procesa la entrada
-    istringstream stream(entrada); // se crea un stream para la entrada
-    string palabra1; 
-    stream >> palabra1; // se extrae la primer palabra
-    string operador;
-    stream >> operador; // se extrae el operador
-    string palabra2;
-    stream >> palabra2; // se extrae la segunda palabra
-
-    if (operador == "AND" || operador == "and") { // si es AND (deben estar si o si las 2 palabras)
-        // hacemos doble busqueda en el trie
-        unordered_set<string> archivosEncontrados1 = trie.buscar(palabra1); 
-        unordered_set<string> archivosEncontrados2 = trie.buscar(palabra2);
-        unordered_set<string> interseccionArchivos;
-        for (const string& nombres : archivosEncontrados1) { // para los nombres encontrados en la primera busqueda
-            // el metodo find devuelve un iterador al elemento si lo encuentra, si no, devuelve un iterador al final ( end() )
-            if (archivosEncontrados2.find(nombres) != archivosEncontrados2.end()) { // si el nombre del archivo esta en la segunda busqueda
-                interseccionArchivos.insert(nombres); // lo inserta en interseccionArchivos
+void HiloEntradaSalida::escribir(Conexion& conexion) {
+    while (!conexion.fallida) {
+        if (conexion.enviados == conexion.salida.size()) {
+            // Todo lo anterior ya salio: se arma el siguiente trozo de cada respuesta pendiente, por turnos
+            conexion.salida.clear();
+            conexion.enviados = 0;
+            while (!conexion.pendientes.empty() && conexion.salida.size() < TAMANO_TROZO) {
+                Respuesta respuesta = move(conexion.pendientes.front());
+                conexion.pendientes.pop_front();
+                if (!ponerTrozo(respuesta, conexion.salida)) {
+                    conexion.pendientes.push_back(move(respuesta));
+                }
+            }
+            if (conexion.salida.empty()) {
+                return;
             }
         }
-        return interseccionArchivos; // retorna la interseccionArchivos
-    } else if (operador == "OR" || operador == "or") { // si el operador es OR (debe contener almenos una de las palabras)
-        // hacemos doble busqueda en el trie
-        unordered_set<string> archivosEncontrados1 = trie.buscar(palabra1); 
-        unordered_set<string> archivosEncontrados2 = trie.buscar(palabra2);
-        
-        archivosEncontrados1.merge(archivosEncontrados2); // combina los resultados de ambas busquedas
-        return archivosEncontrados1; // retorna los archivos encontrados
-    } else { // si no hay operador
-        unordered_set<string> archivosEncontrados1 = trie.buscar(palabra1); // busca la primer palabra
-        return archivosEncontrados1; // retorna los archivos encontrados
-    }
-    
-}
-void crearIndiceInvertido(vector<string> nombresArchivos, Trie trie) {
-    mutex mx ;
-    // Cargamos las StopWords del archivo
-    ifstream archivoEntrada("stop_words_spanish.txt"); // archivo de palabras vacias (no aportan informacion)
-    unordered_set<string> stopWords; // almacena las palabras vacías
-    if (archivoEntrada) { // si el archivo de StopWords se pudo abrir
-        string palabra; 
-        while (getline(archivoEntrada, palabra)) { // para cada palabra en el archivo
-            stopWords.insert(palabra); // la palabra se almacena en 'stopWords'
+        ssize_t enviados = send(conexion.fd, conexion.salida.data() + conexion.enviados, conexion.salida.size() - conexion.enviados,
+                                MSG_NOSIGNAL);
+        if (enviados >= 0) {
+            conexion.enviados += static_cast<size_t>(enviados);
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;  // sigue cuando epoll avise que hay espacio
+        } else {
+            conexion.fallida = true;
         }
-    } else { // en caos no se pudo abrir
-        cerr << "Error al abrir el archivo de palabras vacias." << endl;// mensaje de error
-    } 
-    // recolectamos los archivos (nombre - contenido)
-    unordered_map<string, string> archivosRecolectados = recolectarArchivos(nombresArchivos); 
-
-    unordered_map<string, vector<string>> archivosProcesados; // contendra los archivos procesados
-    for (auto& [nombre, texto] : archivosRecolectados) { // para cada archivo en archivosRecolectados
-        texto = eliminarSignos(texto); // elimina los signos en los textos
-        vector<string> listaPalabras = tokenizarTexto(texto); // separa las palabras en el texto
-        vector<string> palabrasFiltradas = eliminarStopWords(listaPalabras, stopWords); // elimina las palabras vacías
-        archivosProcesados[nombre] = palabrasFiltradas; // la palabra filtrada se almacena en archivosProcesados
-    }
-
-    // los mapeamos (pasan a estar en estructura PalabraArchivo contiene palabra y nombre del archivo) 
-    vector<PalabraArchivo> datosMapeados = mapearArchivos(archivosProcesados);
-
-    // los ordenamos, pasan a estar de nuevo en clave-valor, ahora sin repeticiones
-    unordered_map<string, vector<string>> datosAgrupados = shuffle(datosMapeados);// 
-    
-    // Usamos mutex para controlar la insercion al trie con los hilos
-    lock_guard<mutex> lock(mx);
-    reducirDatos(datosAgrupados, trie); // ingresamos el indice invertido en el trie
+    }
+}
 
+void HiloEntradaSalida::procesarRespuestas() {
+    vector<Respuesta> listas;
+    {
+        lock_guard<mutex> candado(mxRespuestas);
+        listas.swap(respuestas);
+    }
+    for (Respuesta& respuesta : listas) {
+        auto it = conexiones.find(respuesta.fd);
+        if (it == conexiones.end() || it->second->id != respuesta.conexion) {
+            continue;  // la conexion se cerro mientras se ejecutaba la consulta
+        }
+        Conexion& conexion = *it->second;
+        --conexion.enVuelo;
+        conexion.pendientes.push_back(move(respuesta));
+    }
+    // Cada conexion escribe una vez, con todas sus respuestas nuevas juntas
+    for (Respuesta& respuesta : listas) {
+        auto it = conexiones.find(respuesta.fd);
+        if (it == conexiones.end() || it->second->id != respuesta.conexion) {
+            continue;
+        }
+        Conexion& conexion = *it->second;
+        if (conexion.pausada || !conexion.entrada.empty()) {
+            leer(conexion);  // hay lugar en el pool para las tramas que esperaban
+        }
+        escribir(conexion);
+        revisar(respuesta.fd);
+    }
 }
 
-void manejarCliente(SOCKET clienteSocket, Trie& trie) {
-    char buffer[1024] = {0};
+void HiloEntradaSalida::revisar(int fd) {
+    auto it = conexiones.find(fd);
+    if (it != conexiones.end() && terminada(*it->second)) {
+        close(fd);  // tambien lo quita del epoll
+        conexiones.erase(it);
+        servidor.conexiones.fetch_sub(1, memory_order_relaxed);
+    }
+}
 
+void HiloEntradaSalida::atender() {
+    vector<epoll_event> eventos(256);
+    bool escuchando = true;
+    chrono::steady_clock::time_point limite;
     while (true) {
-        int valread = recv(clienteSocket, buffer, 1024, 0);
-        if (valread <= 0) {
-            cerr << "Error al leer del socket o cliente desconectado" << endl;
-            break;
-        }
-
-        string entrada(buffer);
-        unordered_set<string> resultados = procesarEntrada(trie, entrada);
-        string respuesta;
-        if (resultados.empty()) {
-            respuesta = "No se encontraron resultados.";
-        } else {
-            for (const string& archivo : resultados) {
-                respuesta += archivo + "\n";
+        if (servidor.deteniendo.load() && escuchando) {
+            // Deja de aceptar y de leer; las conexiones que no esperan respuesta se cierran ya
+            epoll_ctl(epoll, EPOLL_CTL_DEL, servidor.escucha, nullptr);
+            escuchando = false;
+            limite = chrono::steady_clock::now() + ESPERA_MAXIMA_CIERRE;
+            vector<int> abiertas;
+            for (auto& [fd, conexion] : conexiones) {
+                conexion->cerrada = true;
+                conexion->entrada.clear();
+                abiertas.push_back(fd);
+            }
+            for (int fd : abiertas) {
+                revisar(fd);
             }
         }
+        if (!escuchando && (conexiones.empty() || chrono::steady_clock::now() >= limite)) {
+            break;  // las que quedan se cierran en el destructor
+        }
 
-        if (send(clienteSocket, respuesta.c_str(), respuesta.length(), 0) == SOCKET_ERROR) {
-            cerr << "Error al enviar la respuesta: " << WSAGetLastError() << endl;
+        int n = epoll_wait(epoll, eventos.data(), static_cast<int>(eventos.size()), escuchando ? -1 : 100);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "epoll_wait fallo: " << strerror(errno) << endl;
             break;
         }
-        memset(buffer, 0, sizeof(buffer));
+        for (int i = 0; i < n; ++i) {
+            int fd = eventos[i].data.fd;
+            uint32_t tipo = eventos[i].events;
+            if (fd == servidor.escucha) {
+                if (escuchando) {
+                    aceptar();
+                }
+            } else if (fd == despertar) {
+                uint64_t avisos;
+                ssize_t leido = read(despertar, &avisos, sizeof(avisos));
+                (void)leido;
+                procesarRespuestas();
+            } else {
+                auto it = conexiones.find(fd);
+                if (it == conexiones.end()) {
+                    continue;  // se cerro al atender un evento anterior de esta misma tanda
+                }
+                Conexion& conexion = *it->second;
+                if (tipo & (EPOLLERR | EPOLLHUP)) {
+                    conexion.fallida = true;
+                } else {
+                    if (tipo & (EPOLLIN | EPOLLRDHUP)) {
+                        leer(conexion);
+                    }
+                    escribir(conexion);  // por EPOLLOUT, o por la trama de error que dejo una peticion invalida
+                }
+                revisar(fd);
+            }
+        }
     }
+}
 
-    closesocket(clienteSocket);
+// Socket que escucha en el puerto, no bloqueante y con una cola de conexiones pendientes tan grande como
+// permita el sistema; -1 si falla
+int abrirEscucha(uint16_t puerto) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        cerr << "Socket failed: " << strerror(errno) << endl;
+        return -1;
+    }
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        cerr << "Setsockopt failed: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(puerto);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        cerr << "Bind failed: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) < 0) {  // el kernel lo limita a net.core.somaxconn
+        cerr << "Listen failed: " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
 
-int main() {
-    WSADATA wsaData;
-    int iResult;
+// Decenas de miles de conexiones necesitan mas descriptores que el limite habitual de 1024
+void subirLimiteDescriptores() {
+    rlimit limite;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur < limite.rlim_max) {
+        limite.rlim_cur = limite.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limite) < 0) {
+            cerr << "No se pudo subir el limite de descriptores: " << strerror(errno) << endl;
+        }
+    }
+}
 
-    iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (iResult != 0) {
-        cerr << "WSAStartup failed: " << iResult << endl;
-        return 1;
+int main(int argc, char* argv[]) {
+    uint16_t puerto = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : PUERTO_SERVIDOR;
+    if (argc > 2) {
+        carpetaTextos = argv[2];
     }
 
+    // SIGINT y SIGTERM se bloquean antes de crear hilos (los heredan bloqueados) y se esperan en main con sigwait
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGINT);
+    sigaddset(&senales, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &senales, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+    subirLimiteDescriptores();
 
     // Iniciamos el cronómetro para medir tiempo de ejecucion
     auto start = std::chrono::high_resolution_clock::now();
 
-    
-
     // Nombre de los documentos a procesar
-    vector<vector<string>> nombresArchivos = { // nombres de archivos a procesar
-        {"17 LEYES DEL TRABAJO EN EQUIPO - JOHN C. MAXWELL.txt"},
-        {"21 LEYES DEL LIDERAZGO - JOHN C. MAXWELL.txt"},
-        {"25 MANERAS DE GANARSE A LA GENTE - JOHN C. MAXWELL.txt"},
-        {"ACTITUD DE VENCEDOR - JOHN C. MAXWELL.txt"},
-        {"El Oro Y La Ceniza - Abecassis Eliette.txt"},
-        {"La ultima sirena - Abe ShanaLa.txt"},
-        {"SEAMOS PERSONAS DE INFLUENCIA - JOHN MAXWELL.txt"},
-        {"VIVE TU SUENO - JOHN MAXWELL.txt"}
+    vector<string> nombresArchivos = { // nombres de archivos a procesar
+        "17 LEYES DEL TRABAJO EN EQUIPO - JOHN C. MAXWELL.txt",
+        "21 LEYES DEL LIDERAZGO - JOHN C. MAXWELL.txt",
+        "25 MANERAS DE GANARSE A LA GENTE - JOHN C. MAXWELL.txt",
+        "ACTITUD DE VENCEDOR - JOHN C. MAXWELL.txt",
+        "El Oro Y La Ceniza - Abecassis Eliette.txt",
+        "La ultima sirena - Abe ShanaLa.txt",
+        "SEAMOS PERSONAS DE INFLUENCIA - JOHN MAXWELL.txt",
+        "VIVE TU SUENO - JOHN MAXWELL.txt"
     };
-
-    Trie trie; // creamos el trie
-    thread threads[8]; // usaremos 8 hilos
-    for (int i = 0; i < 8; ++i) { // a cada hilo, le asignamos un archivo a leer
-        threads[i] = thread(crearIndiceInvertido, nombresArchivos[i] , trie);
-    }
-
-    // Esperamos a que todos los hilos terminen
-    for (int i = 0; i < 8; ++i) {
-        if (threads[i].joinable()){
-            threads[i].join(); // unimos los hilos al principal cuando estos terminen
-        } else {
-            cerr << "Error al unir el hilo " << i << endl;
-        }
+    for (string& nombreArchivo : nombresArchivos) {
+        nombreArchivo = carpetaTextos + "/" + nombreArchivo;  // la misma ruta que arman los comandos ADMIN
     }
 
-    
+    // Cargamos el indice guardado; si no existe o quedo viejo se construye una vez y se guarda
+    auto version = make_shared<VersionIndice>(); // el trie y la tabla de documentos (ID -> archivo)
+    unordered_set<string> stopWords = cargarStopWords(carpetaTextos);
+    OpcionesIndexado opciones;
+    opciones.posiciones = true;  // para las consultas de frase ("trabajo en equipo")
+    opciones.metricas = &version->construccion;
+    bool cargado = cargarOCrearIndice(rutaIndice, nombresArchivos, version->trie, version->documentos, stopWords, opciones);
+    version->stopWords = make_shared<const unordered_set<string>>(move(stopWords));  // ya normalizadas
+    cout << (cargado ? "indice cargado de disco" : "indice construido y guardado") << endl;
+    cout << resumenIndexado(*version) << endl;
 
     // Detenemos el cronómetro y mostramos el tiempo transcurrido
     auto stop = std::chrono::high_resolution_clock::now();
     // imprime el tiempo transcurrido en leer los archivos
     cout << "tiempo= " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << " ms" << endl;
 
-
-
-    SOCKET server_fd, new_socket;
-    struct sockaddr_in address;
-    int opt = 1;
-    int addrlen = sizeof(address);
-
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET) {
-        cerr << "Socket failed: " << WSAGetLastError() << endl;
-        WSACleanup();
+    PoolHilos pool;  // un hilo por nucleo para las consultas
+    IndicePublicado indice;
+    indice.publicar(move(version));
+    Servidor servidor{indice, pool};
+    servidor.escucha = abrirEscucha(puerto);
+    if (servidor.escucha < 0) {
         return 1;
     }
 
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt)) == SOCKET_ERROR) {
-        cerr << "Setsockopt failed: " << WSAGetLastError() << endl;
-        closesocket(server_fd);
-        WSACleanup();
-        return 1;
+    vector<unique_ptr<HiloEntradaSalida>> hilos;
+    for (size_t i = 0; i < HILOS_ENTRADA_SALIDA; ++i) {
+        hilos.push_back(make_unique<HiloEntradaSalida>(servidor));
+        if (!hilos.back()->iniciar()) {
+            servidor.deteniendo = true;
+            break;
+        }
     }
-
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(8080);
-
-    if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
-        cerr << "Bind failed: " << WSAGetLastError() << endl;
-        closesocket(server_fd);
-        WSACleanup();
-        return 1;
+    // Las metricas se escriben cada INTERVALO_METRICAS y una vez mas al terminar
+    mutex mxMetricas;
+    condition_variable finMetricas;
+    auto escribirMetricasServidor = [&] {
+        escribirMetricas(rutaMetricas, textoMetricas(*indice.fijar(), cacheConsultas.estadisticas(), metricasConsultas));
+    };
+    thread escritorMetricas([&] {
+        unique_lock<mutex> lock(mxMetricas);
+        while (!finMetricas.wait_for(lock, INTERVALO_METRICAS, [&] { return servidor.deteniendo.load(); })) {
+            escribirMetricasServidor();
+        }
+    });
+
+    if (!servidor.deteniendo) {
+        cout << "escuchando en el puerto " << puerto << " (" << hilos.size() << " hilos de E/S, " << pool.size()
+             << " hilos de consulta)" << endl;
+        int senal = 0;
+        sigwait(&senales, &senal);
+        cout << "deteniendo el servidor (" << servidor.conexiones.load() << " conexiones abiertas)" << endl;
+        lock_guard<mutex> lock(mxMetricas);
+        servidor.deteniendo = true;
     }
+    finMetricas.notify_one();
+    escritorMetricas.join();
 
-    if (listen(server_fd, 3) == SOCKET_ERROR) {
-        cerr << "Listen failed: " << WSAGetLastError() << endl;
-        closesocket(server_fd);
-        WSACleanup();
-        return 1;
+    for (auto& hilo : hilos) {
+        hilo->avisar();
     }
-
-    while (true) {
-        if ((new_socket = accept(server_fd, (struct sockaddr*)&address, &addrlen)) == INVALID_SOCKET) {
-            cerr << "Accept failed: " << WSAGetLastError() << endl;
-            closesocket(server_fd);
-            WSACleanup();
-            return 1;
-        }
-
-        thread(manejarCliente, new_socket, ref(trie)).detach();
+    for (auto& hilo : hilos) {
+        hilo->esperar();
     }
-
-    closesocket(server_fd);
-    WSACleanup();
-
+    pool.esperar();  // las consultas que seguian entregan su respuesta a hilos que ya no la envian
+    hilos.clear();
+    close(servidor.escucha);
+    cout << describirEstadisticas(cacheConsultas.estadisticas()) << endl;
+    escribirMetricasServidor();
     return 0;
-}
\ No newline at end of file
+}
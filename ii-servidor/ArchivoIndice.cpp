@@ -0,0 +1,341 @@
+#include "ArchivoIndice.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+
+using namespace std;
+
+static const char MAGIA[8] = {'I', 'I', 'D', 'X', 'S', 'N', 'A', 'P'};
+static const uint32_t MARCA_ORDEN = 0x01020304;  // se lee distinto si el archivo viene de otra arquitectura
+static const uint64_t CON_POSICIONES = 1;  // bandera: el indice guarda la posicion de cada palabra
+
+struct Cabecera {
+    char magia[8];
+    uint32_t version;
+    uint32_t marcaOrden;
+    uint64_t tamanoArchivo;
+    uint64_t sumaVerificacion;  // FNV-1a de la cabecera (con este campo en 0), los documentos y la tabla de particiones
+    uint64_t sumaStopWords;
+    uint64_t numeroDocumentos;
+    uint64_t inicioDocumentos;
+    uint64_t bytesDocumentos;
+    uint64_t inicioParticiones;
+    uint64_t banderas;
+};
+
+struct EntradaParticion {
+    uint64_t inicioBase, inicioCheck, inicioInicios, inicioIniciosBytes, inicioPostings;  // posiciones dentro del archivo
+    uint64_t inicioInicioPosiciones, inicioPosiciones;
+    uint32_t estados, claves, inicios, documentos;  // cantidad de elementos de cada arreglo (documentos: postings en total)
+    uint32_t iniciosPosiciones, bytesPosiciones, bytesPostings, reservado;
+    uint64_t letras[4];  // bytes que aparecen en las transiciones del diccionario (DobleArreglo::letrasUsadas)
+};
+
+static_assert(sizeof(Cabecera) == 80, "la cabecera del indice no debe tener relleno");
+static_assert(sizeof(EntradaParticion) == 120, "la tabla de particiones no debe tener relleno");
+
+static uint64_t fnv1a(const void* datos, size_t n, uint64_t suma = 14695981039346656037ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(datos);
+    for (size_t i = 0; i < n; ++i) {
+        suma ^= bytes[i];
+        suma *= 1099511628211ULL;
+    }
+    return suma;
+}
+
+// No depende del orden del conjunto: las palabras se ordenan antes de sumarlas
+static uint64_t sumaStopWords(const unordered_set<string>& stopWords) {
+    vector<string> palabras(stopWords.begin(), stopWords.end());
+    sort(palabras.begin(), palabras.end());
+    uint64_t suma = fnv1a(nullptr, 0);
+    for (const string& palabra : palabras) {
+        suma = fnv1a(palabra.data(), palabra.size(), suma);
+        suma = fnv1a("\n", 1, suma);
+    }
+    return suma;
+}
+
+static uint64_t sumaMetadatos(Cabecera cabecera, const char* documentos, const EntradaParticion* tabla) {
+    cabecera.sumaVerificacion = 0;
+    uint64_t suma = fnv1a(&cabecera, sizeof(cabecera));
+    suma = fnv1a(documentos, cabecera.bytesDocumentos, suma);
+    return fnv1a(tabla, 256 * sizeof(EntradaParticion), suma);
+}
+
+static uint64_t alinear(uint64_t posicion) {
+    return (posicion + 7) & ~static_cast<uint64_t>(7);
+}
+
+template <typename T>
+static void escribirValor(string& salida, T valor) {
+    salida.append(reinterpret_cast<const char*>(&valor), sizeof(valor));
+}
+
+template <typename T>
+static bool leerValor(string_view& entrada, T& valor) {
+    if (entrada.size() < sizeof(valor)) {
+        return false;
+    }
+    memcpy(&valor, entrada.data(), sizeof(valor));
+    entrada.remove_prefix(sizeof(valor));
+    return true;
+}
+
+static bool leerTexto(string_view& entrada, string& texto) {
+    uint32_t longitud;
+    if (!leerValor(entrada, longitud) || entrada.size() < longitud) {
+        return false;
+    }
+    texto.assign(entrada.data(), longitud);
+    entrada.remove_prefix(longitud);
+    return true;
+}
+
+// Comprueba que 'cantidad' elementos a partir de 'inicio' caben en el archivo y estan alineados
+static bool regionValida(uint64_t inicio, uint64_t cantidad, size_t tamanoElemento, uint64_t tamanoArchivo) {
+    return inicio % tamanoElemento == 0 && inicio <= tamanoArchivo && cantidad <= (tamanoArchivo - inicio) / tamanoElemento;
+}
+
+bool guardarIndice(const string& ruta, const Trie& trie, const TablaDocumentos& documentos, const unordered_set<string>& stopWords) {
+    for (const Trie::Particion& particion : trie.particiones) {
+        if (!particion.agregados.empty()) {
+            cerr << "No se puede guardar un indice con palabras sin compactar: " << ruta << endl;
+            return false;
+        }
+    }
+
+    string seccionDocumentos;
+    for (uint32_t id = 0; id < documentos.size(); ++id) {
+        const Documento& documento = documentos.obtener(id);
+        escribirValor(seccionDocumentos, documento.bytes);
+        escribirValor(seccionDocumentos, documento.modificado);
+        escribirValor(seccionDocumentos, static_cast<uint8_t>(documento.borrado));
+        escribirValor(seccionDocumentos, documento.longitud);
+        escribirValor(seccionDocumentos, static_cast<uint32_t>(documento.ruta.size()));
+        seccionDocumentos += documento.ruta;
+        escribirValor(seccionDocumentos, static_cast<uint32_t>(documento.nombre.size()));
+        seccionDocumentos += documento.nombre;
+    }
+
+    // Primero se calcula donde va cada arreglo; asi la cabecera y las tablas se escriben de una vez
+    Cabecera cabecera = {};
+    memcpy(cabecera.magia, MAGIA, sizeof(MAGIA));
+    cabecera.version = VERSION_ARCHIVO_INDICE;
+    cabecera.marcaOrden = MARCA_ORDEN;
+    cabecera.sumaStopWords = sumaStopWords(stopWords);
+    cabecera.numeroDocumentos = documentos.size();
+    cabecera.inicioDocumentos = sizeof(Cabecera);
+    cabecera.bytesDocumentos = seccionDocumentos.size();
+    cabecera.inicioParticiones = alinear(cabecera.inicioDocumentos + cabecera.bytesDocumentos);
+    cabecera.banderas = trie.tienePosiciones() ? CON_POSICIONES : 0;
+
+    vector<EntradaParticion> tabla(256);
+    uint64_t posicion = cabecera.inicioParticiones + tabla.size() * sizeof(EntradaParticion);
+    for (size_t i = 0; i < 256; ++i) {
+        const Trie::Particion& particion = trie.particiones[i];
+        EntradaParticion& entrada = tabla[i];
+        entrada.estados = static_cast<uint32_t>(particion.diccionario.estados());
+        entrada.claves = static_cast<uint32_t>(particion.diccionario.claves());
+        entrada.inicios = static_cast<uint32_t>(particion.inicios.size());
+        entrada.documentos = particion.inicios.empty() ? 0 : particion.inicios[particion.inicios.size() - 1];
+        entrada.bytesPostings = static_cast<uint32_t>(particion.postings.size());
+        array<uint64_t, 4> letras = particion.diccionario.letrasUsadas();
+        copy(letras.begin(), letras.end(), entrada.letras);
+        entrada.inicioBase = alinear(posicion);
+        entrada.inicioCheck = alinear(entrada.inicioBase + entrada.estados * sizeof(int32_t));
+        entrada.inicioInicios = alinear(entrada.inicioCheck + entrada.estados * sizeof(int32_t));
+        entrada.inicioIniciosBytes = alinear(entrada.inicioInicios + entrada.inicios * sizeof(uint32_t));
+        entrada.inicioPostings = alinear(entrada.inicioIniciosBytes + entrada.inicios * sizeof(uint32_t));
+        entrada.iniciosPosiciones = static_cast<uint32_t>(particion.inicioPosiciones.size());
+        entrada.bytesPosiciones = static_cast<uint32_t>(particion.posiciones.size());
+        entrada.inicioInicioPosiciones = alinear(entrada.inicioPostings + entrada.bytesPostings);
+        entrada.inicioPosiciones = alinear(entrada.inicioInicioPosiciones + entrada.iniciosPosiciones * sizeof(uint32_t));
+        posicion = entrada.inicioPosiciones + entrada.bytesPosiciones;
+    }
+    cabecera.tamanoArchivo = posicion;
+    cabecera.sumaVerificacion = sumaMetadatos(cabecera, seccionDocumentos.data(), tabla.data());
+
+    string temporal = ruta + ".tmp";
+    ofstream salida(temporal, ios::binary | ios::trunc);
+    if (!salida) {
+        cerr << "Error al crear el archivo del indice: " << temporal << endl;
+        return false;
+    }
+    uint64_t escritos = 0;
+    auto escribir = [&](uint64_t inicio, const void* datos, size_t bytes) {
+        static const char ceros[8] = {};
+        salida.write(ceros, static_cast<streamsize>(inicio - escritos));  // relleno de alineacion
+        salida.write(static_cast<const char*>(datos), static_cast<streamsize>(bytes));
+        escritos = inicio + bytes;
+    };
+    escribir(0, &cabecera, sizeof(cabecera));
+    escribir(cabecera.inicioDocumentos, seccionDocumentos.data(), seccionDocumentos.size());
+    escribir(cabecera.inicioParticiones, tabla.data(), tabla.size() * sizeof(EntradaParticion));
+    for (size_t i = 0; i < 256; ++i) {
+        const Trie::Particion& particion = trie.particiones[i];
+        const EntradaParticion& entrada = tabla[i];
+        escribir(entrada.inicioBase, particion.diccionario.datosBase(), entrada.estados * sizeof(int32_t));
+        escribir(entrada.inicioCheck, particion.diccionario.datosCheck(), entrada.estados * sizeof(int32_t));
+        escribir(entrada.inicioInicios, particion.inicios.data(), entrada.inicios * sizeof(uint32_t));
+        escribir(entrada.inicioIniciosBytes, particion.iniciosBytes.data(), entrada.inicios * sizeof(uint32_t));
+        escribir(entrada.inicioPostings, particion.postings.data(), entrada.bytesPostings);
+        escribir(entrada.inicioInicioPosiciones, particion.inicioPosiciones.data(), entrada.iniciosPosiciones * sizeof(uint32_t));
+        escribir(entrada.inicioPosiciones, particion.posiciones.data(), entrada.bytesPosiciones);
+    }
+    escribir(cabecera.tamanoArchivo, nullptr, 0);  // relleno final si las ultimas particiones estan vacias
+    salida.close();
+    if (!salida) {
+        cerr << "Error al escribir el archivo del indice: " << temporal << endl;
+        filesystem::remove(temporal);
+        return false;
+    }
+
+    // Renombrar reemplaza el indice anterior de una vez: nunca queda un archivo a medio escribir
+    error_code error;
+    filesystem::rename(temporal, ruta, error);
+    if (error) {
+        cerr << "Error al reemplazar el archivo del indice: " << ruta << " (" << error.message() << ")" << endl;
+        filesystem::remove(temporal, error);
+        return false;
+    }
+    return true;
+}
+
+bool cargarIndice(const string& ruta, const vector<string>& nombresArchivos, const unordered_set<string>& stopWords,
+                  Trie& trie, TablaDocumentos& documentos) {
+    if (!filesystem::exists(ruta)) {
+        return false;
+    }
+    auto archivo = make_shared<ArchivoMapeado>();
+    if (!archivo->abrir(ruta, LECTURA_MAPEADA, false)) {  // las busquedas leen el archivo en desorden
+        cerr << "Error al abrir el archivo del indice: " << ruta << endl;
+        return false;
+    }
+    auto descartar = [&](const string& motivo) {
+        cerr << "Se descarta el indice guardado (" << motivo << "): " << ruta << endl;
+        return false;
+    };
+
+    string_view datos = archivo->contenido();
+    Cabecera cabecera;
+    if (datos.size() < sizeof(cabecera)) {
+        return descartar("archivo incompleto");
+    }
+    memcpy(&cabecera, datos.data(), sizeof(cabecera));
+    if (memcmp(cabecera.magia, MAGIA, sizeof(MAGIA)) != 0) {
+        return descartar("no es un archivo de indice");
+    }
+    if (cabecera.marcaOrden != MARCA_ORDEN) {
+        return descartar("orden de bytes distinto");
+    }
+    if (cabecera.version != VERSION_ARCHIVO_INDICE) {
+        return descartar("version distinta");
+    }
+    if (cabecera.tamanoArchivo != datos.size() ||
+        !regionValida(cabecera.inicioDocumentos, cabecera.bytesDocumentos, 1, datos.size()) ||
+        !regionValida(cabecera.inicioParticiones, 256 * sizeof(EntradaParticion), 1, datos.size())) {
+        return descartar("archivo incompleto");
+    }
+    const char* seccionDocumentos = datos.data() + cabecera.inicioDocumentos;
+    vector<EntradaParticion> tabla(256);
+    memcpy(tabla.data(), datos.data() + cabecera.inicioParticiones, tabla.size() * sizeof(EntradaParticion));
+    if (sumaMetadatos(cabecera, seccionDocumentos, tabla.data()) != cabecera.sumaVerificacion) {
+        return descartar("suma de verificacion incorrecta");
+    }
+
+    // Vigencia: mismas palabras vacias y los mismos archivos, sin cambios desde que se indexaron
+    if (cabecera.sumaStopWords != sumaStopWords(stopWords)) {
+        return descartar("cambiaron las palabras vacias");
+    }
+    // Los documentos agregados o borrados en el servidor se conservan: basta con que cada archivo
+    // de la lista este vigente en el indice y que ningun documento vigente haya cambiado en disco
+    TablaDocumentos nuevaTabla;
+    string_view entrada(seccionDocumentos, cabecera.bytesDocumentos);
+    for (uint64_t i = 0; i < cabecera.numeroDocumentos; ++i) {
+        Documento guardado;
+        uint8_t borrado;
+        if (!leerValor(entrada, guardado.bytes) || !leerValor(entrada, guardado.modificado) || !leerValor(entrada, borrado) ||
+            !leerValor(entrada, guardado.longitud) ||
+            !leerTexto(entrada, guardado.ruta) || !leerTexto(entrada, guardado.nombre)) {
+            return descartar("tabla de documentos incompleta");
+        }
+        guardado.borrado = borrado != 0;
+        if (!guardado.borrado) {
+            TablaDocumentos actual;
+            const Documento& documento = actual.obtener(actual.agregar(guardado.ruta));
+            if (documento.bytes != guardado.bytes || documento.modificado != guardado.modificado) {
+                return descartar("se modifico " + guardado.ruta);
+            }
+        }
+        nuevaTabla.agregar(guardado);
+    }
+    for (const string& nombre : nombresArchivos) {
+        if (nuevaTabla.buscarRuta(nombre) == DOCUMENTO_INVALIDO) {
+            return descartar("falta " + nombre);
+        }
+    }
+
+    // Las particiones apuntan al archivo mapeado; el trie conserva el mapeo mientras exista
+    Trie nuevoTrie;
+    for (size_t i = 0; i < 256; ++i) {
+        const EntradaParticion& entradaParticion = tabla[i];
+        bool valida = regionValida(entradaParticion.inicioBase, entradaParticion.estados, sizeof(int32_t), datos.size()) &&
+                      regionValida(entradaParticion.inicioCheck, entradaParticion.estados, sizeof(int32_t), datos.size()) &&
+                      regionValida(entradaParticion.inicioInicios, entradaParticion.inicios, sizeof(uint32_t), datos.size()) &&
+                      regionValida(entradaParticion.inicioIniciosBytes, entradaParticion.inicios, sizeof(uint32_t), datos.size()) &&
+                      regionValida(entradaParticion.inicioPostings, entradaParticion.bytesPostings, 1, datos.size()) &&
+                      regionValida(entradaParticion.inicioInicioPosiciones, entradaParticion.iniciosPosiciones, sizeof(uint32_t), datos.size()) &&
+                      regionValida(entradaParticion.inicioPosiciones, entradaParticion.bytesPosiciones, 1, datos.size()) &&
+                      (entradaParticion.iniciosPosiciones == 0 || entradaParticion.iniciosPosiciones == entradaParticion.documentos + 1) &&
+                      entradaParticion.inicios == (entradaParticion.claves == 0 ? 0 : entradaParticion.claves + 1);
+        if (valida && entradaParticion.inicios > 0) {
+            // Los ultimos inicios cierran los arreglos de postings
+            uint32_t ultimoInicio, ultimoByte;
+            memcpy(&ultimoInicio, datos.data() + entradaParticion.inicioInicios + (entradaParticion.inicios - 1) * sizeof(uint32_t), sizeof(uint32_t));
+            memcpy(&ultimoByte, datos.data() + entradaParticion.inicioIniciosBytes + (entradaParticion.inicios - 1) * sizeof(uint32_t), sizeof(uint32_t));
+            valida = ultimoInicio == entradaParticion.documentos && ultimoByte == entradaParticion.bytesPostings;
+        }
+        if (!valida) {
+            return descartar("tabla de particiones invalida");
+        }
+        Trie::Particion& particion = nuevoTrie.particiones[i];
+        array<uint64_t, 4> letras;
+        copy(begin(entradaParticion.letras), end(entradaParticion.letras), letras.begin());
+        particion.diccionario.asignarVista(reinterpret_cast<const int32_t*>(datos.data() + entradaParticion.inicioBase),
+                                           reinterpret_cast<const int32_t*>(datos.data() + entradaParticion.inicioCheck),
+                                           entradaParticion.estados, entradaParticion.claves, letras);
+        particion.inicios.vista(reinterpret_cast<const uint32_t*>(datos.data() + entradaParticion.inicioInicios), entradaParticion.inicios);
+        particion.iniciosBytes.vista(reinterpret_cast<const uint32_t*>(datos.data() + entradaParticion.inicioIniciosBytes),
+                                     entradaParticion.inicios);
+        particion.postings.vista(reinterpret_cast<const uint8_t*>(datos.data() + entradaParticion.inicioPostings),
+                                 entradaParticion.bytesPostings);
+        particion.inicioPosiciones.vista(reinterpret_cast<const uint32_t*>(datos.data() + entradaParticion.inicioInicioPosiciones),
+                                         entradaParticion.iniciosPosiciones);
+        particion.posiciones.vista(reinterpret_cast<const uint8_t*>(datos.data() + entradaParticion.inicioPosiciones),
+                                   entradaParticion.bytesPosiciones);
+    }
+    nuevoTrie.mapeo = archivo;
+    nuevoTrie.configurar((cabecera.banderas & CON_POSICIONES) != 0, stopWords);
+
+    trie = move(nuevoTrie);
+    documentos = move(nuevaTabla);
+    return true;
+}
+
+bool cargarOCrearIndice(const string& ruta, const vector<string>& nombresArchivos, Trie& trie, TablaDocumentos& documentos,
+                        unordered_set<string>& stopWords, const OpcionesIndexado& opciones) {
+    stopWords = normalizarPalabras(stopWords);
+    if (cargarIndice(ruta, nombresArchivos, stopWords, trie, documentos)) {
+        if (trie.tienePosiciones() || !opciones.posiciones) {
+            return true;
+        }
+        cerr << "El indice guardado no tiene posiciones: se reconstruye " << ruta << endl;
+    }
+    trie = Trie();
+    documentos = TablaDocumentos();
+    crearIndiceInvertido(nombresArchivos, trie, documentos, stopWords, opciones);
+    guardarIndice(ruta, trie, documentos, stopWords);
+    return false;
+}
@@ -0,0 +1,36 @@
+#ifndef ARCHIVOINDICE_H
+#define ARCHIVOINDICE_H
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include "IndiceInvertido.h"
+
+using namespace std;
+
+// Indice guardado en disco
+// Formato (enteros en el orden de bytes de la maquina, marcado en la cabecera):
+//   cabecera | tabla de documentos | tabla de 256 particiones | arreglos de cada particion
+// Los arreglos (base, check, inicios, listas comprimidas y, si se indexaron, las posiciones) se guardan alineados a 8 bytes tal como estan en
+// memoria, asi que al cargar se mapea el archivo y el trie apunta directamente a ellos sin copiarlos:
+// el tiempo de carga no depende del tamaño del corpus. La suma de verificacion cubre la cabecera y
+// las tablas; un arreglo dañado no se detecta al cargar, pero las busquedas comprueban sus limites.
+const uint32_t VERSION_ARCHIVO_INDICE = 7;  // 6: palabras en minusculas y sin tildes; 7: letras de cada particion
+
+// Guarda el indice (ya construido o compactado, sin delta) en 'ruta'; se escribe a un archivo temporal y luego se renombra
+bool guardarIndice(const string& ruta, const Trie& trie, const TablaDocumentos& documentos, const unordered_set<string>& stopWords);
+
+// Carga el indice guardado en 'ruta' si es valido y sigue vigente: todos los archivos de la lista estan en el
+// indice, ningun documento vigente cambio en disco (tamaño y fecha de modificacion) y las palabras vacias
+// son las mismas. Los documentos agregados o borrados despues de construir se conservan.
+// Devuelve false sin tocar 'trie' ni 'documentos' si no.
+bool cargarIndice(const string& ruta, const vector<string>& nombresArchivos, const unordered_set<string>& stopWords,
+                  Trie& trie, TablaDocumentos& documentos);
+
+// Carga el indice guardado o, si no existe, esta dañado, quedo viejo o le faltan las posiciones que piden
+// las opciones, lo reconstruye y lo vuelve a guardar. Las palabras vacias quedan normalizadas (Tokenizador.h).
+// Devuelve true si se cargo de disco.
+bool cargarOCrearIndice(const string& ruta, const vector<string>& nombresArchivos, Trie& trie, TablaDocumentos& documentos,
+                        unordered_set<string>& stopWords, const OpcionesIndexado& opciones = OpcionesIndexado());
+
+#endif // ARCHIVOINDICE_H
@@ -0,0 +1,78 @@
+#include "ArchivoMapeado.h"
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+ArchivoMapeado::ArchivoMapeado() : datos(nullptr), tamano(0), mapeado(false) {}
+
+ArchivoMapeado::~ArchivoMapeado() {
+    cerrar();
+}
+
+bool ArchivoMapeado::abrir(const string& ruta, ModoLectura modo, bool secuencial) {
+    cerrar();
+#ifndef _WIN32
+    if (modo == LECTURA_MAPEADA) {
+        int descriptor = open(ruta.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return false;
+        }
+        struct stat informacion;
+        if (fstat(descriptor, &informacion) != 0) {
+            close(descriptor);
+            return false;
+        }
+        tamano = static_cast<size_t>(informacion.st_size);
+        if (tamano == 0) {  // mmap no acepta longitud 0: el archivo vacio es una vista vacia
+            close(descriptor);
+            return true;
+        }
+        void* direccion = mmap(nullptr, tamano, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        close(descriptor);  // el mapeo sigue siendo valido sin el descriptor
+        if (direccion == MAP_FAILED) {
+            tamano = 0;
+            return false;
+        }
+        if (secuencial) {
+            madvise(direccion, tamano, MADV_SEQUENTIAL);  // el tokenizador lee de principio a fin una sola vez
+        }
+        datos = static_cast<const char*>(direccion);
+        mapeado = true;
+        return true;
+    }
+#else
+    (void)modo;
+    (void)secuencial;
+#endif
+    ifstream archivoEntrada(ruta, ios::binary);
+    if (!archivoEntrada) {
+        return false;
+    }
+    stringstream texto;
+    texto << archivoEntrada.rdbuf();
+    copia = texto.str();
+    datos = copia.data();
+    tamano = copia.size();
+    return true;
+}
+
+void ArchivoMapeado::cerrar() {
+#ifndef _WIN32
+    if (mapeado) {
+        munmap(const_cast<char*>(datos), tamano);
+    }
+#endif
+    datos = nullptr;
+    tamano = 0;
+    mapeado = false;
+    copia.clear();
+    copia.shrink_to_fit();
+}
@@ -0,0 +1,38 @@
+#ifndef ARCHIVOMAPEADO_H
+#define ARCHIVOMAPEADO_H
+
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Forma de leer los documentos al indexar
+enum ModoLectura {
+    LECTURA_MAPEADA,  // mmap de solo lectura, sin copiar el archivo
+    LECTURA_FLUJO     // ifstream hacia un string (copia del archivo)
+};
+
+// Vista de solo lectura del contenido completo de un archivo
+// Con LECTURA_MAPEADA el archivo se mapea en memoria con aviso de lectura secuencial y se
+// desmapea al cerrar o destruir el objeto, por lo que solo ocupa memoria mientras se tokeniza.
+// Donde no hay mmap (Windows) se usa siempre LECTURA_FLUJO.
+class ArchivoMapeado {
+private:
+    const char* datos;
+    size_t tamano;
+    bool mapeado;
+    string copia;  // contenido leido con LECTURA_FLUJO
+
+public:
+    ArchivoMapeado();
+    ~ArchivoMapeado();
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    // Devuelve false si no se pudo abrir; 'secuencial' avisa al sistema que se leera de principio a fin una sola vez
+    bool abrir(const string& ruta, ModoLectura modo = LECTURA_MAPEADA, bool secuencial = true);
+    void cerrar();
+    string_view contenido() const { return string_view(datos, tamano); }
+};
+
+#endif // ARCHIVOMAPEADO_H
@@ -0,0 +1,42 @@
+#include "AutomataLevenshtein.h"
+#include <algorithm>
+
+using namespace std;
+
+AutomataLevenshtein::AutomataLevenshtein(string_view buscada, uint32_t distanciaMaxima)
+    : palabra(buscada), maxima(static_cast<uint8_t>(min<uint32_t>(distanciaMaxima, 254))) {}
+
+void AutomataLevenshtein::inicial(uint8_t* fila) const {
+    for (size_t j = 0; j <= palabra.size(); ++j) {
+        fila[j] = static_cast<uint8_t>(min<size_t>(j, maxima + 1));
+    }
+}
+
+bool AutomataLevenshtein::avanzar(const uint8_t* fila, uint8_t letra, uint8_t* siguiente) const {
+    uint8_t tope = maxima + 1;
+    siguiente[0] = static_cast<uint8_t>(min(fila[0] + 1, static_cast<int>(tope)));
+    uint8_t minimo = siguiente[0];
+    for (size_t j = 1; j <= palabra.size(); ++j) {
+        int valor = min(fila[j] + 1, siguiente[j - 1] + 1);  // borrar la letra leida o insertar palabra[j - 1]
+        valor = min(valor, fila[j - 1] + (static_cast<uint8_t>(palabra[j - 1]) != letra));  // igual o cambiada
+        siguiente[j] = static_cast<uint8_t>(min(valor, static_cast<int>(tope)));
+        minimo = min(minimo, siguiente[j]);
+    }
+    return minimo <= maxima;
+}
+
+bool AutomataLevenshtein::letrasPosibles(const uint8_t* fila, vector<uint8_t>& letras) const {
+    letras.clear();
+    for (size_t j = 0; j <= palabra.size(); ++j) {
+        if (fila[j] < maxima) {
+            return false;
+        }
+    }
+    for (size_t j = 0; j < palabra.size(); ++j) {
+        uint8_t letra = static_cast<uint8_t>(palabra[j]);
+        if (fila[j] == maxima && find(letras.begin(), letras.end(), letra) == letras.end()) {
+            letras.push_back(letra);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef AUTOMATALEVENSHTEIN_H
+#define AUTOMATALEVENSHTEIN_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Automata de Levenshtein: acepta las palabras a distancia de edicion de a lo mas 'maxima' de la buscada
+// (insertar, borrar o cambiar un byte cuesta 1). Un estado es una fila de la tabla de programacion dinamica:
+// la celda j es la distancia entre lo leido y los primeros j bytes de la palabra, topada en maxima + 1. Leer
+// un byte calcula la fila siguiente; si ninguna celda queda <= maxima, nada que empiece asi puede aceptarse,
+// asi que al recorrer un trie se descarta la rama entera.
+class AutomataLevenshtein {
+private:
+    string palabra;
+    uint8_t maxima;
+
+public:
+    AutomataLevenshtein(string_view buscada, uint32_t distanciaMaxima);
+
+    size_t columnas() const { return palabra.size() + 1; }
+    uint32_t distanciaMaxima() const { return maxima; }
+
+    // Fila del estado inicial (nada leido); 'fila' tiene columnas() celdas
+    void inicial(uint8_t* fila) const;
+
+    // Deja en 'siguiente' la fila tras leer 'letra'; devuelve false si la rama ya no puede aceptar
+    bool avanzar(const uint8_t* fila, uint8_t letra, uint8_t* siguiente) const;
+
+    // Distancia entre lo leido y la palabra; mayor que distanciaMaxima() si no se acepta
+    uint32_t distancia(const uint8_t* fila) const { return fila[palabra.size()]; }
+
+    // Si ninguna celda esta por debajo de la maxima, cualquier byte distinto del que sigue en la palabra mata la
+    // rama: solo sobreviven los que siguen a una celda que vale la maxima. Los deja en 'letras' (sin repetir) y
+    // devuelve true; con holgura devuelve false y puede seguir cualquier byte.
+    bool letrasPosibles(const uint8_t* fila, vector<uint8_t>& letras) const;
+};
+
+#endif // AUTOMATALEVENSHTEIN_H
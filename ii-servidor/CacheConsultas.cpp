@@ -0,0 +1,141 @@
+#include "CacheConsultas.h"
+#include "Consulta.h"
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+CacheConsultas::CacheConsultas(size_t bytesMaximos, size_t cantidadFragmentos)
+    : fragmentos(new Fragmento[max<size_t>(cantidadFragmentos, 1)]), numeroFragmentos(max<size_t>(cantidadFragmentos, 1)),
+      bytesPorFragmento(bytesMaximos / max<size_t>(cantidadFragmentos, 1)) {}
+
+CacheConsultas::Fragmento& CacheConsultas::fragmento(const string& clave) const {
+    return fragmentos[hash<string>()(clave) % numeroFragmentos];
+}
+
+bool CacheConsultas::renovar(Fragmento& fragmento, uint64_t generacion) {
+    if (generacion < fragmento.generacion) {
+        return false;
+    }
+    if (generacion > fragmento.generacion) {
+        invalidadas.fetch_add(fragmento.uso.size(), memory_order_relaxed);
+        fragmento.porClave.clear();
+        fragmento.uso.clear();
+        fragmento.bytes = 0;
+        fragmento.generacion = generacion;
+    }
+    return true;
+}
+
+bool CacheConsultas::buscar(const string& clave, uint64_t generacion, vector<ResultadoBusqueda>& resultados) {
+    Fragmento& elegido = fragmento(clave);
+    {
+        lock_guard<mutex> candado(elegido.candado);
+        if (renovar(elegido, generacion)) {
+            auto it = elegido.porClave.find(clave);
+            if (it != elegido.porClave.end()) {
+                elegido.uso.splice(elegido.uso.begin(), elegido.uso, it->second);  // pasa a ser la mas reciente
+                resultados = it->second->resultados;
+                aciertos.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    fallos.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void CacheConsultas::guardar(const string& clave, uint64_t generacion, const vector<ResultadoBusqueda>& resultados) {
+    size_t bytes = sizeof(Entrada) + clave.size() + resultados.size() * sizeof(ResultadoBusqueda) + 6 * sizeof(void*);
+    if (bytes > bytesPorFragmento) {
+        return;
+    }
+    Fragmento& elegido = fragmento(clave);
+    lock_guard<mutex> candado(elegido.candado);
+    if (!renovar(elegido, generacion) || elegido.porClave.count(clave) > 0) {
+        return;  // resultado viejo, u otro hilo ya guardo la misma consulta
+    }
+    while (elegido.bytes + bytes > bytesPorFragmento) {
+        Entrada& ultima = elegido.uso.back();
+        elegido.bytes -= ultima.bytes;
+        elegido.porClave.erase(ultima.clave);
+        elegido.uso.pop_back();
+        expulsadas.fetch_add(1, memory_order_relaxed);
+    }
+    elegido.uso.push_front({clave, resultados, bytes});
+    elegido.porClave.emplace(elegido.uso.front().clave, elegido.uso.begin());
+    elegido.bytes += bytes;
+}
+
+void CacheConsultas::vaciar() {
+    for (size_t i = 0; i < numeroFragmentos; ++i) {
+        lock_guard<mutex> candado(fragmentos[i].candado);
+        fragmentos[i].porClave.clear();
+        fragmentos[i].uso.clear();
+        fragmentos[i].bytes = 0;
+    }
+}
+
+EstadisticasCache CacheConsultas::estadisticas() const {
+    EstadisticasCache estadisticas;
+    estadisticas.aciertos = aciertos.load(memory_order_relaxed);
+    estadisticas.fallos = fallos.load(memory_order_relaxed);
+    estadisticas.expulsadas = expulsadas.load(memory_order_relaxed);
+    estadisticas.invalidadas = invalidadas.load(memory_order_relaxed);
+    for (size_t i = 0; i < numeroFragmentos; ++i) {
+        lock_guard<mutex> candado(fragmentos[i].candado);
+        estadisticas.entradas += fragmentos[i].uso.size();
+        estadisticas.bytes += fragmentos[i].bytes;
+    }
+    return estadisticas;
+}
+
+vector<ResultadoBusqueda> buscarRankingConCache(CacheConsultas& cache, const Trie& trie, const TablaDocumentos& documentos,
+                                                const string& entrada, size_t k, const ParametrosBM25& parametros, string* error) {
+    NodoConsulta consulta;
+    string motivo;
+    if (!analizarConsulta(entrada, consulta, motivo)) {
+        if (error) {
+            *error = motivo;
+        } else {
+            cerr << "Consulta invalida (" << motivo << "): " << entrada << endl;
+        }
+        return vector<ResultadoBusqueda>();
+    }
+    return buscarRankingConCache(cache, trie, documentos, consulta, k, parametros);
+}
+
+vector<ResultadoBusqueda> buscarRankingConCache(CacheConsultas& cache, const Trie& trie, const TablaDocumentos& documentos,
+                                                const NodoConsulta& consulta, size_t k, const ParametrosBM25& parametros) {
+    ostringstream texto;
+    texto << normalizarConsulta(consulta) << '#' << k << ',' << parametros.k1 << ',' << parametros.b;
+    string clave = texto.str();
+    uint64_t generacion = generacionIndice(trie, documentos);
+    vector<ResultadoBusqueda> resultados;
+    if (!cache.buscar(clave, generacion, resultados)) {
+        resultados = buscarRanking(trie, documentos, consulta, k, parametros);
+        cache.guardar(clave, generacion, resultados);
+    }
+    return resultados;
+}
+
+bool esComandoCache(const string& entrada) {
+    istringstream stream(entrada);
+    string prefijo, comando, resto;
+    stream >> prefijo >> comando >> resto;
+    return prefijo == "ADMIN" && comando == "CACHE" && resto.empty();
+}
+
+string describirEstadisticas(const EstadisticasCache& estadisticas) {
+    uint64_t consultas = estadisticas.aciertos + estadisticas.fallos;
+    ostringstream texto;
+    texto << "Cache: " << estadisticas.aciertos << " aciertos, " << estadisticas.fallos << " fallos";
+    if (consultas > 0) {
+        texto << " (" << 100 * estadisticas.aciertos / consultas << "% de aciertos)";
+    }
+    texto << ", " << estadisticas.entradas << " consultas guardadas en " << (estadisticas.bytes + 1023) / 1024 << " KiB, "
+          << estadisticas.expulsadas << " expulsadas, " << estadisticas.invalidadas << " invalidadas.";
+    return texto.str();
+}
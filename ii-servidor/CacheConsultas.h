@@ -0,0 +1,92 @@
+#ifndef CACHECONSULTAS_H
+#define CACHECONSULTAS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "IndiceInvertido.h"
+
+using namespace std;
+
+// Contadores de la cache, para ajustar su tamaño
+struct EstadisticasCache {
+    uint64_t aciertos = 0;
+    uint64_t fallos = 0;
+    uint64_t expulsadas = 0;   // entradas sacadas para hacer espacio
+    uint64_t invalidadas = 0;  // entradas descartadas porque el indice cambio
+    size_t entradas = 0;
+    size_t bytes = 0;
+};
+
+const size_t BYTES_CACHE_CONSULTAS = 16 * 1024 * 1024;
+const size_t FRAGMENTOS_CACHE_CONSULTAS = 16;
+
+// Cache de resultados de consultas: clave (la consulta normalizada) -> documentos encontrados
+// Se reparte en fragmentos, cada uno con su candado y su parte del presupuesto de memoria, para que los hilos
+// que consultan a la vez casi nunca esperen el mismo candado. Cada fragmento saca primero la entrada usada
+// hace mas tiempo (LRU). Las entradas valen para una generacion del indice (generacionIndice): cuando llega
+// una mas nueva, el fragmento descarta todo lo que tenia. Un resultado de una generacion anterior (un hilo
+// que empezo antes del cambio) no se devuelve ni se guarda.
+class CacheConsultas {
+private:
+    struct Entrada {
+        string clave;
+        vector<ResultadoBusqueda> resultados;
+        size_t bytes;  // estimados, con lo que ocupan el nodo de la lista y el del mapa
+    };
+    struct Fragmento {
+        mutable mutex candado;
+        list<Entrada> uso;  // de la usada mas recientemente a la menos
+        unordered_map<string_view, list<Entrada>::iterator> porClave;  // las claves apuntan a las de 'uso'
+        uint64_t generacion = 0;
+        size_t bytes = 0;
+    };
+    unique_ptr<Fragmento[]> fragmentos;
+    size_t numeroFragmentos;
+    size_t bytesPorFragmento;
+    atomic<uint64_t> aciertos{0};
+    atomic<uint64_t> fallos{0};
+    atomic<uint64_t> expulsadas{0};
+    atomic<uint64_t> invalidadas{0};
+
+    Fragmento& fragmento(const string& clave) const;
+    // Con el candado tomado: deja el fragmento en 'generacion' si es mas nueva; false si 'generacion' es vieja
+    bool renovar(Fragmento& fragmento, uint64_t generacion);
+
+public:
+    explicit CacheConsultas(size_t bytesMaximos = BYTES_CACHE_CONSULTAS, size_t cantidadFragmentos = FRAGMENTOS_CACHE_CONSULTAS);
+    CacheConsultas(const CacheConsultas&) = delete;
+    CacheConsultas& operator=(const CacheConsultas&) = delete;
+
+    // Copia en 'resultados' lo guardado para la clave en esa generacion; false si no esta
+    bool buscar(const string& clave, uint64_t generacion, vector<ResultadoBusqueda>& resultados);
+    // Guarda el resultado calculado con esa generacion (un resultado mas grande que un fragmento no se guarda)
+    void guardar(const string& clave, uint64_t generacion, const vector<ResultadoBusqueda>& resultados);
+    void vaciar();
+    EstadisticasCache estadisticas() const;
+};
+
+// Como buscarRanking, pero primero busca la consulta en la cache. La clave es la consulta normalizada
+// (normalizarConsulta) con k y los parametros de BM25, asi que "equipo actitud" aprovecha lo calculado para
+// "actitud AND equipo". Una consulta mal escrita no se guarda: su motivo queda en 'error' o, sin 'error', se
+// informa en cerr como en buscarRanking.
+vector<ResultadoBusqueda> buscarRankingConCache(CacheConsultas& cache, const Trie& trie, const TablaDocumentos& documentos,
+                                                const string& entrada, size_t k = RESULTADOS_POR_CONSULTA,
+                                                const ParametrosBM25& parametros = ParametrosBM25(), string* error = nullptr);
+// La misma, con la consulta ya analizada (Consulta.h)
+struct NodoConsulta;
+vector<ResultadoBusqueda> buscarRankingConCache(CacheConsultas& cache, const Trie& trie, const TablaDocumentos& documentos,
+                                                const NodoConsulta& consulta, size_t k = RESULTADOS_POR_CONSULTA,
+                                                const ParametrosBM25& parametros = ParametrosBM25());
+
+// Comando con el que los servidores devuelven los contadores de la cache: ADMIN CACHE
+bool esComandoCache(const string& entrada);
+string describirEstadisticas(const EstadisticasCache& estadisticas);
+
+#endif // CACHECONSULTAS_H
@@ -0,0 +1,196 @@
+#ifndef COMPARTIDO_H
+#define COMPARTIDO_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+
+using namespace std;
+
+// Contenedores que comparten sus datos con sus copias (copia al escribir)
+// Las versiones de un indice (IndicePublicado.h) se copian en cada cambio y solo difieren en lo que toco el
+// cambio. Copiar uno de estos contenedores copia un puntero; escribir copia solo los bloques o nodos que
+// otra copia todavia ve, y los siguientes cambios de la misma copia ya los escriben en su lugar. Una copia
+// publicada no se modifica mas, asi que sus lectores no necesitan candados.
+
+// El bloque listo para escribirlo: si otra copia lo ve, se reemplaza por uno propio
+template <typename T>
+T& bloquePropio(shared_ptr<T>& bloque) {
+    if (bloque.use_count() != 1) {
+        bloque = make_shared<T>(*bloque);
+    } else {
+        // La ultima copia que lo veia ya lo solto: sus lecturas quedan antes de nuestras escrituras
+        atomic_thread_fence(memory_order_acquire);
+    }
+    return *bloque;
+}
+
+// Vector por bloques de BLOQUE_COMPARTIDO elementos: cambiar un elemento copia a lo mas su bloque
+const size_t BLOQUE_COMPARTIDO = 1024;
+
+template <typename T>
+class VectorCompartido {
+private:
+    vector<shared_ptr<vector<T>>> bloques;
+    size_t n = 0;
+
+public:
+    const T& operator[](size_t i) const { return (*bloques[i / BLOQUE_COMPARTIDO])[i % BLOQUE_COMPARTIDO]; }
+    T& modificar(size_t i) { return bloquePropio(bloques[i / BLOQUE_COMPARTIDO])[i % BLOQUE_COMPARTIDO]; }
+    void push_back(T valor) {
+        if (n % BLOQUE_COMPARTIDO == 0) {
+            bloques.push_back(make_shared<vector<T>>());
+            bloques.back()->reserve(BLOQUE_COMPARTIDO);
+        }
+        bloquePropio(bloques.back()).push_back(move(valor));
+        ++n;
+    }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+};
+
+// Mapa de texto a V persistente (un trie sobre el hash de la clave, con 32 hijos por nivel)
+// Las hojas guardan hasta MAXIMO_HOJA claves y se dividen al llenarse. Cambiar una clave copia los nodos del
+// camino hasta su hoja (unos pocos, con punteros) y su valor si otra copia lo ve, nunca el mapa entero.
+template <typename V>
+class MapaCompartido {
+private:
+    static const unsigned BITS_NIVEL = 5;
+    static const unsigned NIVELES = 64 / BITS_NIVEL;  // despues, las claves con el mismo hash quedan en una hoja
+    static const size_t MAXIMO_HOJA = 8;
+
+    struct Nodo {
+        bool hoja = true;
+        uint32_t hijosPresentes = 0;            // nodo interno: bit b si hay hijo para el grupo de bits b
+        vector<shared_ptr<Nodo>> hijos;         // en el orden de los bits
+        vector<pair<string, shared_ptr<V>>> entradas;  // hoja
+    };
+    shared_ptr<Nodo> raiz;
+    size_t n = 0;
+
+    static uint64_t hashClave(string_view clave) { return hash<string_view>()(clave); }
+    static unsigned grupo(uint64_t h, unsigned nivel) { return static_cast<unsigned>(h >> (nivel * BITS_NIVEL)) & 31; }
+    static size_t posicionHijo(const Nodo& nodo, unsigned bit) {
+        return bitset<32>(nodo.hijosPresentes & ((1u << bit) - 1)).count();
+    }
+
+    // Convierte la hoja llena en un nodo interno con las claves repartidas por sus bits de este nivel
+    static void dividir(Nodo& nodo, unsigned nivel) {
+        vector<pair<string, shared_ptr<V>>> entradas = move(nodo.entradas);
+        nodo.entradas.clear();
+        nodo.hoja = false;
+        for (auto& entrada : entradas) {
+            unsigned bit = grupo(hashClave(entrada.first), nivel);
+            size_t posicion = posicionHijo(nodo, bit);
+            if (!(nodo.hijosPresentes & (1u << bit))) {
+                nodo.hijos.insert(nodo.hijos.begin() + static_cast<ptrdiff_t>(posicion), make_shared<Nodo>());
+                nodo.hijosPresentes |= 1u << bit;
+            }
+            nodo.hijos[posicion]->entradas.push_back(move(entrada));
+        }
+    }
+
+    static void recorrerNodo(const Nodo& nodo, const function<void(const string&, const V&)>& visitar) {
+        for (const auto& [clave, valor] : nodo.entradas) {
+            visitar(clave, *valor);
+        }
+        for (const shared_ptr<Nodo>& hijo : nodo.hijos) {
+            recorrerNodo(*hijo, visitar);
+        }
+    }
+
+public:
+    // El valor de la clave o nullptr si no esta
+    const V* buscar(string_view clave) const {
+        if (n == 0) {
+            return nullptr;
+        }
+        uint64_t h = hashClave(clave);
+        const Nodo* nodo = raiz.get();
+        for (unsigned nivel = 0; !nodo->hoja; ++nivel) {
+            unsigned bit = grupo(h, nivel);
+            if (!(nodo->hijosPresentes & (1u << bit))) {
+                return nullptr;
+            }
+            nodo = nodo->hijos[posicionHijo(*nodo, bit)].get();
+        }
+        for (const auto& [otra, valor] : nodo->entradas) {
+            if (otra == clave) {
+                return valor.get();
+            }
+        }
+        return nullptr;
+    }
+
+    // El valor de la clave listo para cambiarlo; si no estaba, se agrega con V()
+    V& modificar(string_view clave) {
+        if (!raiz) {
+            raiz = make_shared<Nodo>();
+        }
+        uint64_t h = hashClave(clave);
+        Nodo* nodo = &bloquePropio(raiz);
+        for (unsigned nivel = 0;; ++nivel) {
+            if (nodo->hoja) {
+                for (auto& [otra, valor] : nodo->entradas) {
+                    if (otra == clave) {
+                        return bloquePropio(valor);
+                    }
+                }
+                if (nodo->entradas.size() < MAXIMO_HOJA || nivel >= NIVELES) {
+                    nodo->entradas.emplace_back(string(clave), make_shared<V>());
+                    ++n;
+                    return *nodo->entradas.back().second;
+                }
+                dividir(*nodo, nivel);
+            }
+            unsigned bit = grupo(h, nivel);
+            size_t posicion = posicionHijo(*nodo, bit);
+            if (!(nodo->hijosPresentes & (1u << bit))) {
+                nodo->hijos.insert(nodo->hijos.begin() + static_cast<ptrdiff_t>(posicion), make_shared<Nodo>());
+                nodo->hijosPresentes |= 1u << bit;
+            }
+            nodo = &bloquePropio(nodo->hijos[posicion]);
+        }
+    }
+
+    // Quita la clave; devuelve false si no estaba. Las hojas vacias quedan (se liberan con clear).
+    bool borrar(string_view clave) {
+        if (buscar(clave) == nullptr) {
+            return false;
+        }
+        uint64_t h = hashClave(clave);
+        Nodo* nodo = &bloquePropio(raiz);
+        for (unsigned nivel = 0; !nodo->hoja; ++nivel) {
+            nodo = &bloquePropio(nodo->hijos[posicionHijo(*nodo, grupo(h, nivel))]);
+        }
+        for (auto it = nodo->entradas.begin(); it != nodo->entradas.end(); ++it) {
+            if (it->first == clave) {
+                nodo->entradas.erase(it);
+                break;
+            }
+        }
+        --n;
+        return true;
+    }
+
+    // Recorre las claves en el orden de sus hashes
+    void recorrer(const function<void(const string&, const V&)>& visitar) const {
+        if (raiz) {
+            recorrerNodo(*raiz, visitar);
+        }
+    }
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    void clear() {
+        raiz.reset();
+        n = 0;
+    }
+};
+
+#endif // COMPARTIDO_H
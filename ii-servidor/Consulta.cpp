@@ -0,0 +1,561 @@
+#include "Consulta.h"
+#include "ListasOrdenadas.h"
+#include <algorithm>
+#include <iterator>
+#include <cstdlib>
+
+using namespace std;
+
+// Pieza lexica de la consulta
+struct Pieza {
+    enum Tipo { PALABRA, FRASE, PREFIJO, DIFUSA, ABRE, CIERRA, Y, O, NO } tipo;
+    string texto;
+    uint32_t holgura = 0;
+    uint32_t distancia = 0;
+};
+
+// La palabra normalizada como las del texto (Tokenizador.h): vacia si solo tiene signos y con las partes
+// separadas por espacios si tiene varias ("Líder—equipo")
+static string normalizarPalabra(const string& palabra) {
+    Tokenizador tokenizador;
+    string normalizada;
+    tokenizador.tokenizar(palabra, [&](string_view parte) {
+        if (!normalizada.empty()) {
+            normalizada += ' ';
+        }
+        normalizada += parte;
+    });
+    return normalizada;
+}
+
+static bool dividirPiezas(const string& entrada, vector<Pieza>& piezas, string& error) {
+    size_t i = 0;
+    while (i < entrada.size()) {
+        char c = entrada[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++i;
+        } else if (c == '(' || c == ')') {
+            piezas.push_back({c == '(' ? Pieza::ABRE : Pieza::CIERRA, string()});
+            ++i;
+        } else if (c == '"') {
+            size_t fin = entrada.find('"', i + 1);
+            if (fin == string::npos) {
+                error = "comillas sin cerrar";
+                return false;
+            }
+            Pieza frase{Pieza::FRASE, entrada.substr(i + 1, fin - i - 1)};
+            i = fin + 1;
+            if (i < entrada.size() && entrada[i] == '~') {
+                char* final;
+                unsigned long holgura = strtoul(entrada.c_str() + i + 1, &final, 10);
+                frase.holgura = static_cast<uint32_t>(min<unsigned long>(holgura, UINT32_MAX));
+                i = static_cast<size_t>(final - entrada.c_str());
+            }
+            piezas.push_back(move(frase));
+        } else {
+            size_t fin = entrada.find_first_of(" \t\r\n()\"", i);
+            string palabra = entrada.substr(i, fin == string::npos ? string::npos : fin - i);
+            i = fin == string::npos ? entrada.size() : fin;
+            if (palabra == "AND" || palabra == "and") {
+                piezas.push_back({Pieza::Y, palabra});
+            } else if (palabra == "OR" || palabra == "or") {
+                piezas.push_back({Pieza::O, palabra});
+            } else if (palabra == "NOT" || palabra == "not") {
+                piezas.push_back({Pieza::NO, palabra});
+            } else if (palabra.find('~') != string::npos) {
+                size_t tilde = palabra.find('~');
+                string numero = palabra.substr(tilde + 1);
+                if (palabra.rfind('*', tilde) != string::npos) {
+                    error = "falta la palabra antes del ~: " + palabra;
+                    return false;
+                }
+                Pieza difusa{Pieza::DIFUSA, normalizarPalabra(palabra.substr(0, tilde))};
+                if (difusa.texto.empty()) {
+                    error = "falta la palabra antes del ~: " + palabra;
+                    return false;
+                }
+                if (difusa.texto.find(' ') != string::npos) {
+                    error = "la busqueda difusa es de una sola palabra: " + palabra;
+                    return false;
+                }
+                if (numero.empty()) {
+                    difusa.distancia = difusa.texto.size() <= 5 ? 1 : DISTANCIA_MAXIMA_DIFUSA;
+                } else if (numero.size() == 1 && numero[0] >= '1' && numero[0] <= '0' + static_cast<char>(DISTANCIA_MAXIMA_DIFUSA)) {
+                    difusa.distancia = static_cast<uint32_t>(numero[0] - '0');
+                } else {
+                    error = "la distancia despues del ~ va de 1 a " + to_string(DISTANCIA_MAXIMA_DIFUSA) + ": " + palabra;
+                    return false;
+                }
+                piezas.push_back(move(difusa));
+            } else if (palabra.find('*') != string::npos) {
+                // Solo al final y con al menos una letra antes: las ramas del trie salen de la primera letra
+                if (palabra.size() < 2 || palabra.find('*') != palabra.size() - 1) {
+                    error = "el * va al final de una palabra: " + palabra;
+                    return false;
+                }
+                palabra.pop_back();
+                string prefijo = normalizarPalabra(palabra);
+                if (prefijo.empty() || prefijo.find(' ') != string::npos) {
+                    error = "el * va al final de una palabra: " + palabra + "*";
+                    return false;
+                }
+                piezas.push_back({Pieza::PREFIJO, move(prefijo)});
+            } else {
+                // Una palabra que al normalizarla queda en varias se busca como frase; una sin letras se ignora
+                string normalizada = normalizarPalabra(palabra);
+                if (normalizada.find(' ') != string::npos) {
+                    piezas.push_back({Pieza::FRASE, move(normalizada)});
+                } else if (!normalizada.empty()) {
+                    piezas.push_back({Pieza::PALABRA, move(normalizada)});
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static bool esHoja(Pieza::Tipo tipo) {
+    return tipo == Pieza::PALABRA || tipo == Pieza::FRASE || tipo == Pieza::PREFIJO || tipo == Pieza::DIFUSA;
+}
+
+static TipoNodo tipoHoja(Pieza::Tipo tipo) {
+    switch (tipo) {
+    case Pieza::FRASE:
+        return NODO_FRASE;
+    case Pieza::PREFIJO:
+        return NODO_PREFIJO;
+    case Pieza::DIFUSA:
+        return NODO_DIFUSO;
+    default:
+        return NODO_PALABRA;
+    }
+}
+
+// Descenso recursivo sobre las piezas, un metodo por nivel de precedencia
+class AnalizadorConsulta {
+private:
+    const vector<Pieza>& piezas;
+    string& error;
+    size_t siguiente = 0;
+    size_t profundidad = 0;
+
+    bool hay(Pieza::Tipo tipo) const { return siguiente < piezas.size() && piezas[siguiente].tipo == tipo; }
+    bool empiezaFactor() const {
+        return siguiente < piezas.size() && (esHoja(piezas[siguiente].tipo) || hay(Pieza::ABRE) || hay(Pieza::NO));
+    }
+
+    // Junta los hijos en un nodo del tipo dado; con un solo hijo basta el hijo
+    static void juntar(TipoNodo tipo, vector<NodoConsulta>& hijos, NodoConsulta& nodo) {
+        if (hijos.size() == 1) {
+            nodo = move(hijos[0]);
+        } else {
+            nodo.tipo = tipo;
+            nodo.hijos = move(hijos);
+        }
+    }
+
+public:
+    AnalizadorConsulta(const vector<Pieza>& lista, string& mensaje) : piezas(lista), error(mensaje) {}
+
+    bool terminado() const { return siguiente == piezas.size(); }
+
+    bool consulta(NodoConsulta& nodo) {
+        vector<NodoConsulta> terminos(1);
+        if (!termino(terminos.back())) {
+            return false;
+        }
+        while (hay(Pieza::O)) {
+            ++siguiente;
+            terminos.emplace_back();
+            if (!termino(terminos.back())) {
+                return false;
+            }
+        }
+        juntar(NODO_O, terminos, nodo);
+        return true;
+    }
+
+    bool termino(NodoConsulta& nodo) {
+        vector<NodoConsulta> factores(1);
+        if (!factor(factores.back())) {
+            return false;
+        }
+        while (hay(Pieza::Y) || empiezaFactor()) {
+            if (hay(Pieza::Y)) {
+                ++siguiente;
+            }
+            factores.emplace_back();
+            if (!factor(factores.back())) {
+                return false;
+            }
+        }
+        juntar(NODO_Y, factores, nodo);
+        return true;
+    }
+
+    bool factor(NodoConsulta& nodo) {
+        if (siguiente == piezas.size()) {
+            error = "falta una palabra al final";
+            return false;
+        }
+        const Pieza& pieza = piezas[siguiente];
+        if (esHoja(pieza.tipo)) {
+            nodo.tipo = tipoHoja(pieza.tipo);
+            nodo.texto = pieza.texto;
+            nodo.holgura = pieza.holgura;
+            nodo.distancia = pieza.distancia;
+            ++siguiente;
+            return true;
+        }
+        if (pieza.tipo != Pieza::NO && pieza.tipo != Pieza::ABRE) {
+            error = "falta una palabra antes de " + (pieza.tipo == Pieza::CIERRA ? string(")") : pieza.texto);
+            return false;
+        }
+        if (++profundidad > PROFUNDIDAD_MAXIMA_CONSULTA) {
+            error = "demasiados niveles anidados";
+            return false;
+        }
+        ++siguiente;
+        bool valido;
+        if (pieza.tipo == Pieza::NO) {
+            nodo.tipo = NODO_NO;
+            nodo.hijos.resize(1);
+            valido = factor(nodo.hijos[0]);
+        } else {
+            valido = consulta(nodo);
+            if (valido && !hay(Pieza::CIERRA)) {
+                error = "falta cerrar un parentesis";
+                valido = false;
+            }
+            ++siguiente;
+        }
+        --profundidad;
+        return valido;
+    }
+};
+
+bool analizarConsulta(const string& entrada, NodoConsulta& raiz, string& error) {
+    vector<Pieza> piezas;
+    raiz = NodoConsulta();
+    if (!dividirPiezas(entrada, piezas, error)) {
+        return false;
+    }
+    if (piezas.empty()) {
+        return true;  // consulta vacia: ningun documento
+    }
+    AnalizadorConsulta analizador(piezas, error);
+    if (!analizador.consulta(raiz)) {
+        return false;
+    }
+    if (!analizador.terminado()) {
+        error = "sobra un parentesis de cierre";
+        return false;
+    }
+    return true;
+}
+
+// Cada hoja lleva el largo de su texto, asi que ningun texto se confunde con los separadores
+static void escribirCanonica(const NodoConsulta& nodo, string& salida) {
+    switch (nodo.tipo) {
+    case NODO_PALABRA:
+    case NODO_PREFIJO:
+    case NODO_DIFUSO:
+    case NODO_FRASE: {
+        string texto = nodo.texto;
+        if (nodo.tipo == NODO_FRASE) {
+            texto.clear();
+            Tokenizador tokenizador;
+            tokenizador.tokenizar(nodo.texto, [&](string_view palabra) {
+                if (!texto.empty()) {
+                    texto += ' ';
+                }
+                texto += palabra;
+            });
+        }
+        salida += nodo.tipo == NODO_PALABRA ? 'p' : nodo.tipo == NODO_PREFIJO ? '*' : nodo.tipo == NODO_DIFUSO ? '~' : '"';
+        if (nodo.tipo == NODO_DIFUSO) {
+            salida += to_string(nodo.distancia) + ',';
+        } else if (nodo.tipo == NODO_FRASE) {
+            salida += to_string(nodo.holgura) + ',';
+        }
+        salida += to_string(texto.size()) + ':' + texto;
+        break;
+    }
+    case NODO_NO:
+        salida += '!';
+        escribirCanonica(nodo.hijos[0], salida);
+        break;
+    case NODO_Y:
+    case NODO_O: {
+        // Los hijos del mismo tipo se aplanan, como en planificar
+        vector<const NodoConsulta*> pendientes;
+        vector<string> hijos;
+        for (const NodoConsulta& hijo : nodo.hijos) {
+            pendientes.push_back(&hijo);
+        }
+        while (!pendientes.empty()) {
+            const NodoConsulta* hijo = pendientes.back();
+            pendientes.pop_back();
+            if (hijo->tipo == nodo.tipo) {
+                for (const NodoConsulta& nieto : hijo->hijos) {
+                    pendientes.push_back(&nieto);
+                }
+            } else {
+                hijos.emplace_back();
+                escribirCanonica(*hijo, hijos.back());
+            }
+        }
+        sort(hijos.begin(), hijos.end());
+        salida += nodo.tipo == NODO_Y ? "&(" : "|(";
+        for (const string& hijo : hijos) {
+            salida += hijo;
+            salida += ' ';
+        }
+        salida += ')';
+        break;
+    }
+    }
+}
+
+string normalizarConsulta(const NodoConsulta& consulta) {
+    string salida;
+    escribirCanonica(consulta, salida);
+    return salida;
+}
+
+static bool esHoja(const NodoPlan& nodo) {
+    return nodo.tipo == NODO_PALABRA || nodo.tipo == NODO_FRASE || nodo.tipo == NODO_PREFIJO || nodo.tipo == NODO_DIFUSO;
+}
+
+// Una frase no sale de mas documentos que su palabra mas rara; se estima sin leer posiciones
+static size_t costoFrase(const Trie& trie, const string& frase) {
+    Tokenizador tokenizador;
+    size_t costo = SIZE_MAX;
+    tokenizador.tokenizar(frase, [&](string_view palabra) {
+        string texto(palabra);
+        if (!trie.esPalabraVacia(texto)) {
+            costo = min(costo, trie.buscar(texto).size());
+        }
+    });
+    return costo == SIZE_MAX ? 0 : costo;
+}
+
+static NodoPlan planificar(const Trie& trie, const TablaDocumentos& documentos, const NodoConsulta& consulta) {
+    NodoPlan plan;
+    plan.tipo = consulta.tipo;
+    plan.texto = consulta.texto;
+    plan.holgura = consulta.holgura;
+    switch (consulta.tipo) {
+    case NODO_PALABRA:
+        plan.postings = trie.buscar(consulta.texto);
+        plan.costo = plan.postings.size();
+        break;
+    case NODO_FRASE:
+        plan.costo = costoFrase(trie, consulta.texto);
+        break;
+    case NODO_PREFIJO:
+    case NODO_DIFUSO:
+        plan.expansion = consulta.tipo == NODO_PREFIJO ? trie.expandirPrefijo(consulta.texto)
+                                                       : trie.buscarParecidas(consulta.texto, consulta.distancia);
+        plan.costo = min(plan.expansion.documentos, documentos.size());
+        break;
+    case NODO_NO:
+        plan.hijos.push_back(planificar(trie, documentos, consulta.hijos[0]));
+        plan.costo = documentos.vigentes() - min(plan.hijos[0].costo, documentos.vigentes());
+        break;
+    case NODO_Y:
+    case NODO_O:
+        for (const NodoConsulta& hijo : consulta.hijos) {
+            NodoPlan subplan = planificar(trie, documentos, hijo);
+            if (subplan.tipo == plan.tipo) {
+                // (a AND b) AND c es a AND b AND c: el AND aplanado puede ordenar las tres listas juntas
+                move(subplan.hijos.begin(), subplan.hijos.end(), back_inserter(plan.hijos));
+            } else if (subplan.tipo == NODO_NO && plan.tipo == NODO_O) {
+                NodoPlan y;
+                y.tipo = NODO_Y;
+                y.costo = subplan.costo;
+                y.hijos.push_back(move(subplan));
+                plan.hijos.push_back(move(y));
+            } else {
+                plan.hijos.push_back(move(subplan));
+            }
+        }
+        if (plan.tipo == NODO_O) {
+            for (const NodoPlan& hijo : plan.hijos) {
+                plan.costo += hijo.costo;
+            }
+        } else {
+            // Primero los hijos positivos de menor a mayor costo; los NOT solo restan y van al final
+            stable_sort(plan.hijos.begin(), plan.hijos.end(), [](const NodoPlan& a, const NodoPlan& b) {
+                if ((a.tipo == NODO_NO) != (b.tipo == NODO_NO)) {
+                    return b.tipo == NODO_NO;
+                }
+                return a.costo < b.costo;
+            });
+            plan.costo = plan.hijos.empty() || plan.hijos[0].tipo == NODO_NO ? documentos.vigentes() : plan.hijos[0].costo;
+        }
+        break;
+    }
+    return plan;
+}
+
+NodoPlan planificarConsulta(const Trie& trie, const TablaDocumentos& documentos, const NodoConsulta& consulta) {
+    NodoPlan plan = planificar(trie, documentos, consulta);
+    if (plan.tipo == NODO_NO) {
+        NodoPlan y;
+        y.tipo = NODO_Y;
+        y.costo = plan.costo;
+        y.hijos.push_back(move(plan));
+        return y;
+    }
+    return plan;
+}
+
+const VistaPostings& listaHoja(NodoPlan& hoja, const Trie& trie) {
+    if (!hoja.evaluada) {
+        if (hoja.tipo == NODO_PALABRA) {
+            hoja.lista = juntarPostings(hoja.postings, hoja.apoyo);
+        } else if (hoja.tipo == NODO_PREFIJO || hoja.tipo == NODO_DIFUSO) {
+            hoja.lista = juntarExpansion(hoja.expansion, hoja.apoyo);
+        } else {
+            hoja.apoyo = buscarFrase(trie, hoja.texto, hoja.holgura);
+            hoja.lista = hoja.apoyo;
+        }
+        hoja.evaluada = true;
+    }
+    return hoja.lista;
+}
+
+bool hojaComprimida(const NodoPlan& hoja) {
+    return hoja.tipo == NODO_PALABRA && !hoja.evaluada && hoja.postings.agregada.empty() && !hoja.postings.compactada.empty();
+}
+
+// Como filtrarEn, pero sin decodificar la lista: cada documento se busca con la tabla de saltos y solo se
+// decodifican los bloques donde caen. Conviene cuando el resultado parcial es mucho mas corto que la lista.
+static void filtrarComprimida(ListaPostings& resultado, const PostingsComprimidos& lista, bool quitar) {
+    LectorPostings lector(lista);
+    size_t escritos = 0;
+    for (uint32_t documento : resultado) {
+        bool esta = lector.avanzarHasta(documento) && lector.documento() == documento;
+        if (esta != quitar) {
+            resultado[escritos++] = documento;
+        }
+    }
+    resultado.resize(escritos);
+}
+
+// Deja en 'resultado' solo los documentos que tambien estan (o con 'quitar', que no estan) en 'lista'.
+// La interseccion usa los nucleos de ListasOrdenadas, que galopan sobre 'lista' si es mucho mas larga.
+// En la resta, si 'lista' es mucho mas larga cada documento se busca con busqueda binaria desde el anterior,
+// asi que el costo depende sobre todo del resultado parcial, que es el corto.
+static void filtrarEn(ListaPostings& resultado, VistaPostings lista, bool quitar) {
+    if (!quitar) {
+        ListaPostings comunes;
+        intersectarOrdenadas(resultado.data(), resultado.size(), lista.begin(), lista.size(), comunes);
+        resultado.swap(comunes);
+        return;
+    }
+    size_t escritos = 0;
+    const uint32_t* cursor = lista.begin();
+    bool binaria = lista.size() > 8 * resultado.size();
+    for (uint32_t documento : resultado) {
+        if (binaria) {
+            cursor = lower_bound(cursor, lista.end(), documento);
+        } else {
+            while (cursor != lista.end() && *cursor < documento) {
+                ++cursor;
+            }
+        }
+        if (cursor == lista.end() || *cursor != documento) {
+            resultado[escritos++] = documento;
+        }
+    }
+    resultado.resize(escritos);
+}
+
+static ListaPostings documentosVigentes(const TablaDocumentos& documentos) {
+    ListaPostings todos;
+    todos.reserve(documentos.vigentes());
+    for (uint32_t id = 0; id < documentos.size(); ++id) {
+        if (documentos.vigente(id)) {
+            todos.push_back(id);
+        }
+    }
+    return todos;
+}
+
+static ListaPostings evaluar(NodoPlan& nodo, const Trie& trie, const TablaDocumentos& documentos) {
+    if (esHoja(nodo)) {
+        const VistaPostings& lista = listaHoja(nodo, trie);
+        return ListaPostings(lista.begin(), lista.end());
+    }
+    if (nodo.tipo == NODO_O) {
+        // Todos los hijos se juntan en una sola mezcla de k listas
+        vector<ListaPostings> parciales;
+        vector<ListaOrdenada> listas;
+        parciales.reserve(nodo.hijos.size());
+        for (NodoPlan& hijo : nodo.hijos) {
+            if (esHoja(hijo)) {
+                const VistaPostings& lista = listaHoja(hijo, trie);
+                listas.push_back({lista.begin(), lista.size()});
+            } else {
+                parciales.push_back(evaluar(hijo, trie, documentos));
+                listas.push_back({parciales.back().data(), parciales.back().size()});
+            }
+        }
+        ListaPostings resultado;
+        unirVarias(listas, resultado);
+        return resultado;
+    }
+    if (nodo.tipo == NODO_NO) {  // planificar deja cada NOT dentro de un AND; esto solo cubre un plan armado a mano
+        ListaPostings resultado = documentosVigentes(documentos);
+        filtrarEn(resultado, evaluar(nodo.hijos[0], trie, documentos), true);
+        return resultado;
+    }
+
+    ListaPostings resultado;
+    bool primero = true;
+    for (NodoPlan& hijo : nodo.hijos) {
+        if (primero) {
+            // Sin hijos positivos (solo NOT) se parte de todos los documentos vigentes
+            resultado = hijo.tipo == NODO_NO ? documentosVigentes(documentos) : evaluar(hijo, trie, documentos);
+            primero = false;
+            if (hijo.tipo != NODO_NO) {
+                if (resultado.empty()) {
+                    break;
+                }
+                continue;
+            }
+        }
+        bool quitar = hijo.tipo == NODO_NO;
+        NodoPlan& operando = quitar ? hijo.hijos[0] : hijo;
+        if (hojaComprimida(operando) && resultado.size() * PROPORCION_GALOPE < operando.postings.size()) {
+            filtrarComprimida(resultado, operando.postings.compactada, quitar);
+        } else if (esHoja(operando)) {
+            filtrarEn(resultado, listaHoja(operando, trie), quitar);
+        } else {
+            ListaPostings parcial = evaluar(operando, trie, documentos);
+            filtrarEn(resultado, parcial, quitar);
+        }
+        if (resultado.empty()) {
+            break;  // corto circuito: las listas que faltan ya no se leen
+        }
+    }
+    return resultado;
+}
+
+ListaPostings ejecutarPlan(NodoPlan& plan, const Trie& trie, const TablaDocumentos& documentos) {
+    ListaPostings resultado = evaluar(plan, trie, documentos);
+    documentos.quitarBorrados(resultado);
+    return resultado;
+}
+
+void hojasPositivas(NodoPlan& plan, vector<NodoPlan*>& hojas) {
+    if (esHoja(plan)) {
+        hojas.push_back(&plan);
+    } else if (plan.tipo != NODO_NO) {
+        for (NodoPlan& hijo : plan.hijos) {
+            hojasPositivas(hijo, hojas);
+        }
+    }
+}
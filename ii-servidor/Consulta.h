@@ -0,0 +1,94 @@
+#ifndef CONSULTA_H
+#define CONSULTA_H
+
+#include <string>
+#include <vector>
+#include "IndiceInvertido.h"
+
+using namespace std;
+
+// Lenguaje de consultas
+//   consulta := termino { OR termino }
+//   termino  := factor { [AND] factor }      (dos factores seguidos tambien se intersectan)
+//   factor   := NOT factor | ( consulta ) | palabra | prefijo* | palabra~[d] | "frase"[~k]
+// NOT tiene la mayor precedencia, luego AND y al final OR. Los operadores van en mayusculas o en minusculas.
+// Un * al final de una palabra busca todas las que empiezan asi (lider* encuentra lider, lideres, liderazgo).
+// Un ~ al final busca las palabras a distancia de edicion de a lo mas d (1 o 2) para tolerar errores de
+// escritura (liderasgo~ encuentra liderazgo); sin d es 1 hasta 5 letras y 2 en palabras mas largas.
+enum TipoNodo {
+    NODO_PALABRA,
+    NODO_FRASE,
+    NODO_PREFIJO,  // union de las palabras que empiezan con 'texto'
+    NODO_DIFUSO,   // union de las palabras parecidas a 'texto'
+
+    NODO_Y,   // interseccion de los hijos
+    NODO_O,   // union de los hijos
+    NODO_NO   // documentos vigentes que no cumplen el unico hijo
+};
+
+// Arbol de la consulta tal como se escribio
+struct NodoConsulta {
+    TipoNodo tipo = NODO_O;  // un O sin hijos es la consulta vacia
+    string texto;            // palabra, frase o prefijo (sin el *); las palabras ya normalizadas como el texto
+    uint32_t holgura = 0;    // solo en frases
+    uint32_t distancia = 0;  // solo en busquedas difusas
+    vector<NodoConsulta> hijos;
+};
+
+const size_t PROFUNDIDAD_MAXIMA_CONSULTA = 64;  // parentesis y NOT anidados (las consultas llegan por la red)
+
+// Analiza la entrada; si la sintaxis no es valida devuelve false y deja el motivo en 'error'
+// Las palabras, prefijos y busquedas difusas se normalizan como al indexar (Tokenizador.h): "Líder" busca lider
+bool analizarConsulta(const string& entrada, NodoConsulta& raiz, string& error);
+
+// Forma canonica de la consulta, para reconocer la misma consulta escrita de otra manera: aplana los AND y OR
+// anidados, ordena sus hijos (el orden no cambia el resultado) y escribe las frases con sus palabras separadas
+// por un espacio. "equipo and (actitud)" y "actitud AND equipo" dan el mismo texto; dos consultas con distinto
+// texto pueden dar los mismos documentos, pero no al reves.
+string normalizarConsulta(const NodoConsulta& consulta);
+
+// Nodo del plan de una consulta. Las palabras ya tienen sus postings buscados en el trie, todavia comprimidos
+// (se decodifican o se recorren con saltos cuando se necesitan; las frases se calculan cuando se necesitan)
+// y los prefijos y las busquedas difusas sus palabras expandidas, que se unen cuando se necesitan. 'costo' estima
+// cuantos documentos salen del nodo: en una hoja es el tamaño de su lista (en un prefijo o una busqueda difusa, la
+// suma de las listas de sus palabras), en un AND el del hijo mas corto y en un OR la suma.
+struct NodoPlan {
+    TipoNodo tipo = NODO_O;
+    string texto;
+    uint32_t holgura = 0;
+    size_t costo = 0;
+    PostingsPalabra postings;  // de una palabra
+    ExpansionPalabras expansion;  // de un prefijo o una busqueda difusa
+    bool evaluada = false;   // la hoja ya tiene 'lista'
+    ListaFrecuencias apoyo;  // lista decodificada y juntada con el delta o resultado de la frase
+    VistaPostings lista;
+    vector<NodoPlan> hijos;
+
+    // 'lista' puede apuntar a 'apoyo': al mover se conserva el bufer, al copiar no
+    NodoPlan() = default;
+    NodoPlan(NodoPlan&&) = default;
+    NodoPlan& operator=(NodoPlan&&) = default;
+    NodoPlan(const NodoPlan&) = delete;
+    NodoPlan& operator=(const NodoPlan&) = delete;
+};
+
+// Compila la consulta: aplana los AND y OR anidados y ordena los hijos de cada AND del mas barato al mas caro,
+// con los NOT al final. Un NOT fuera de un AND se convierte en un AND con solo ese NOT.
+NodoPlan planificarConsulta(const Trie& trie, const TablaDocumentos& documentos, const NodoConsulta& consulta);
+
+// Ejecuta el plan: un AND empieza por su hijo mas corto, intersecta los demas en orden y se detiene en cuanto
+// el resultado queda vacio, asi que cuesta lo proporcional a la lista mas rara y no a la mas comun.
+// Devuelve los IDs de los documentos vigentes que cumplen la consulta, en orden.
+ListaPostings ejecutarPlan(NodoPlan& plan, const Trie& trie, const TablaDocumentos& documentos);
+
+// Lista de una hoja del plan (la decodifica, calcula la frase o une las palabras expandidas la primera vez)
+const VistaPostings& listaHoja(NodoPlan& hoja, const Trie& trie);
+
+// La hoja es una palabra sin delta que aun no se decodifico: se puede recorrer comprimida con LectorPostings
+bool hojaComprimida(const NodoPlan& hoja);
+
+// Hojas que no estan bajo un NOT: las que suman al puntaje de un documento (un prefijo o una busqueda difusa
+// suma como una palabra cuya frecuencia es la de todas sus palabras juntas)
+void hojasPositivas(NodoPlan& plan, vector<NodoPlan*>& hojas);
+
+#endif // CONSULTA_H
@@ -0,0 +1,301 @@
+#include "DobleArreglo.h"
+#include <algorithm>
+
+using namespace std;
+
+// Codigo de una clave en la profundidad dada: 0 si la clave termina ahi, 1..256 para cada byte
+static int codigoEn(const string& clave, size_t profundidad) {
+    return profundidad == clave.size() ? 0 : static_cast<unsigned char>(clave[profundidad]) + 1;
+}
+
+DobleArreglo::DobleArreglo() : numeroClaves(0) {}
+
+void DobleArreglo::construir(const vector<string>& claves, const vector<uint32_t>& valores) {
+    numeroClaves = claves.size();
+    if (claves.empty()) {
+        base.asignar({});
+        check.asignar({});
+        codigosUsados.clear();
+        return;
+    }
+
+    // Cada rango [inicio, fin) de claves comparte el prefijo que lleva al estado
+    struct Rango {
+        int32_t estado;
+        size_t inicio, fin, profundidad;
+    };
+    struct Hijo {
+        int codigo;
+        size_t inicio, fin;
+    };
+
+    vector<int32_t> base(1024, 0);
+    vector<int32_t> check(1024, -1);
+    int32_t siguienteLibre = 1;  // primera posicion que podria estar libre
+    int32_t baseMaxima = 0;
+
+    vector<Rango> pendientes = {{0, 0, claves.size(), 0}};
+    vector<Hijo> hijos;
+    while (!pendientes.empty()) {
+        Rango rango = pendientes.back();
+        pendientes.pop_back();
+
+        // Agrupamos las claves del rango por su siguiente byte (ya vienen ordenadas)
+        hijos.clear();
+        for (size_t i = rango.inicio; i < rango.fin;) {
+            int codigo = codigoEn(claves[i], rango.profundidad);
+            size_t j = i + 1;
+            while (j < rango.fin && codigoEn(claves[j], rango.profundidad) == codigo) {
+                ++j;
+            }
+            hijos.push_back({codigo, i, j});
+            i = j;
+        }
+
+        // Buscamos la primera base en la que caben todos los hijos
+        int32_t posicion = siguienteLibre;
+        int32_t b;
+        while (true) {
+            while (posicion < static_cast<int32_t>(check.size()) && check[posicion] != -1) {
+                ++posicion;
+            }
+            b = posicion - hijos.front().codigo;
+            if (b >= 1) {
+                if (static_cast<size_t>(b) + 257 > check.size()) {
+                    size_t nuevoTamano = max(check.size() * 2, static_cast<size_t>(b) + 257);
+                    base.resize(nuevoTamano, 0);
+                    check.resize(nuevoTamano, -1);
+                }
+                bool cabe = true;
+                for (const Hijo& hijo : hijos) {
+                    if (check[b + hijo.codigo] != -1) {
+                        cabe = false;
+                        break;
+                    }
+                }
+                if (cabe) {
+                    break;
+                }
+            }
+            ++posicion;
+        }
+
+        base[rango.estado] = b;
+        baseMaxima = max(baseMaxima, b);
+        for (const Hijo& hijo : hijos) {
+            check[b + hijo.codigo] = rango.estado;
+        }
+        while (siguienteLibre < static_cast<int32_t>(check.size()) && check[siguienteLibre] != -1) {
+            ++siguienteLibre;
+        }
+
+        for (const Hijo& hijo : hijos) {
+            int32_t t = b + hijo.codigo;
+            if (hijo.codigo == 0) {
+                // Hoja: las claves no se repiten, asi que el grupo tiene una sola clave
+                base[t] = -static_cast<int32_t>(valores[hijo.inicio]) - 1;
+            } else {
+                pendientes.push_back({t, hijo.inicio, hijo.fin, rango.profundidad + 1});
+            }
+        }
+    }
+
+    // Dejamos 257 posiciones despues de la base mayor para no comprobar limites al buscar
+    base.resize(static_cast<size_t>(baseMaxima) + 257);
+    check.resize(static_cast<size_t>(baseMaxima) + 257);
+    base.shrink_to_fit();
+    check.shrink_to_fit();
+    this->base.asignar(move(base));
+    this->check.asignar(move(check));
+    calcularCodigosUsados();
+}
+
+void DobleArreglo::calcularCodigosUsados() {
+    vector<bool> usado(257, false);
+    uint32_t n = static_cast<uint32_t>(base.size());
+    for (uint32_t t = 1; t < n; ++t) {
+        int32_t s = check[t];
+        if (s >= 0 && static_cast<uint32_t>(s) < n) {
+            int64_t codigo = static_cast<int64_t>(t) - base[s];
+            if (codigo >= 1 && codigo <= 256) {
+                usado[codigo] = true;
+            }
+        }
+    }
+    codigosUsados.clear();
+    for (uint16_t codigo = 1; codigo <= 256; ++codigo) {
+        if (usado[codigo]) {
+            codigosUsados.push_back(codigo);
+        }
+    }
+}
+
+void DobleArreglo::asignarVista(const int32_t* datosBase, const int32_t* datosCheck, size_t numeroEstados, size_t claves,
+                                const array<uint64_t, 4>& letras) {
+    base.vista(datosBase, numeroEstados);
+    check.vista(datosCheck, numeroEstados);
+    numeroClaves = claves;
+    codigosUsados.clear();
+    for (uint16_t letra = 0; letra < 256; ++letra) {
+        if ((letras[letra / 64] >> (letra % 64)) & 1) {
+            codigosUsados.push_back(letra + 1);
+        }
+    }
+}
+
+array<uint64_t, 4> DobleArreglo::letrasUsadas() const {
+    array<uint64_t, 4> letras{};
+    for (uint16_t codigo : codigosUsados) {
+        letras[(codigo - 1) / 64] |= uint64_t(1) << ((codigo - 1) % 64);
+    }
+    return letras;
+}
+
+bool DobleArreglo::buscar(string_view palabra, uint32_t& valor) const {
+    if (base.empty()) {
+        return false;
+    }
+    // Las comparaciones con el tamaño solo fallan con un arreglo dañado (por ejemplo, un indice guardado corrupto)
+    uint32_t n = static_cast<uint32_t>(base.size());
+    int32_t s = 0;
+    for (char letra : palabra) {
+        int32_t t = base[s] + static_cast<unsigned char>(letra) + 1;
+        if (static_cast<uint32_t>(t) >= n || check[t] != s) {
+            return false;
+        }
+        s = t;
+    }
+    int32_t hoja = base[s];
+    if (static_cast<uint32_t>(hoja) >= n || check[hoja] != s) {
+        return false;
+    }
+    valor = static_cast<uint32_t>(-base[hoja] - 1);
+    return true;
+}
+
+bool DobleArreglo::rangoPrefijo(string_view prefijo, uint32_t& primero, uint32_t& ultimo) const {
+    if (base.empty()) {
+        return false;
+    }
+    uint32_t n = static_cast<uint32_t>(base.size());
+    int32_t s = 0;
+    for (char letra : prefijo) {
+        int32_t t = base[s] + static_cast<unsigned char>(letra) + 1;
+        if (static_cast<uint32_t>(t) >= n || check[t] != s) {
+            return false;
+        }
+        s = t;
+    }
+    // La primera clave del subarbol baja siempre por el codigo menor (el 0, fin de palabra, va antes que
+    // cualquier letra) y la ultima por el mayor, hasta llegar a una hoja
+    auto extremo = [&](bool menor, uint32_t& valor) {
+        int32_t estado = s;
+        for (size_t profundidad = 0; profundidad <= n; ++profundidad) {  // un arreglo dañado podria tener ciclos
+            int32_t siguiente = -1;
+            int codigo = 0;
+            for (int i = 0; i <= 256; ++i) {
+                codigo = menor ? i : 256 - i;
+                int32_t t = base[estado] + codigo;
+                if (static_cast<uint32_t>(t) < n && check[t] == estado) {
+                    siguiente = t;
+                    break;
+                }
+            }
+            if (siguiente < 0) {
+                return false;
+            }
+            if (codigo == 0) {
+                valor = static_cast<uint32_t>(-base[siguiente] - 1);
+                return true;
+            }
+            estado = siguiente;
+        }
+        return false;
+    };
+    return extremo(true, primero) && extremo(false, ultimo) && primero <= ultimo;
+}
+
+struct DobleArreglo::RecorridoParecidas {
+    const AutomataLevenshtein& automata;
+    const function<void(const string&, uint32_t, uint32_t)>& visitar;
+    size_t columnas;
+    size_t profundidadMaxima;    // mas abajo ninguna fila del automata sobrevive
+    vector<uint8_t> filas;       // la fila de cada profundidad, una detras de otra
+    vector<vector<uint8_t>> letras;  // letras posibles de cada profundidad
+    string clave;
+};
+
+void DobleArreglo::recorrerParecidas(const AutomataLevenshtein& automata, const uint8_t* fila,
+                                     const function<void(const string&, uint32_t, uint32_t)>& visitar) const {
+    if (base.empty()) {
+        return;
+    }
+    size_t columnas = automata.columnas();
+    size_t profundidadMaxima = columnas + automata.distanciaMaxima();
+    RecorridoParecidas recorrido{automata, visitar, columnas, profundidadMaxima, vector<uint8_t>((profundidadMaxima + 1) * columnas),
+                                 vector<vector<uint8_t>>(profundidadMaxima + 1), string()};
+    copy(fila, fila + columnas, recorrido.filas.begin());
+    parecidasDesde(0, 0, recorrido);
+}
+
+void DobleArreglo::parecidasDesde(int32_t estado, size_t profundidad, RecorridoParecidas& recorrido) const {
+    uint32_t n = static_cast<uint32_t>(base.size());
+    const uint8_t* fila = recorrido.filas.data() + profundidad * recorrido.columnas;
+    int32_t hoja = base[estado];
+    if (static_cast<uint32_t>(hoja) < n && check[hoja] == estado && recorrido.automata.distancia(fila) <= recorrido.automata.distanciaMaxima()) {
+        recorrido.visitar(recorrido.clave, static_cast<uint32_t>(-base[hoja] - 1), recorrido.automata.distancia(fila));
+    }
+    if (profundidad == recorrido.profundidadMaxima) {
+        return;  // solo con un arreglo dañado: las ramas mueren antes
+    }
+    uint8_t* siguiente = recorrido.filas.data() + (profundidad + 1) * recorrido.columnas;
+    auto probar = [&](int codigo) {
+        int32_t t = base[estado] + codigo;
+        if (static_cast<uint32_t>(t) < n && check[t] == estado &&
+            recorrido.automata.avanzar(fila, static_cast<uint8_t>(codigo - 1), siguiente)) {
+            recorrido.clave.push_back(static_cast<char>(codigo - 1));
+            parecidasDesde(t, profundidad + 1, recorrido);
+            recorrido.clave.pop_back();
+        }
+    };
+    vector<uint8_t>& letras = recorrido.letras[profundidad];
+    if (recorrido.automata.letrasPosibles(fila, letras)) {
+        for (uint8_t letra : letras) {
+            probar(letra + 1);
+        }
+    } else {
+        for (uint16_t codigo : codigosUsados) {
+            probar(codigo);
+        }
+    }
+}
+
+void DobleArreglo::recorrer(const function<void(const string&, uint32_t)>& visitar) const {
+    if (base.empty()) {
+        return;
+    }
+    string prefijo;
+    // Pila de (estado, siguiente codigo por probar); el prefijo crece y se recorta junto con la pila
+    vector<pair<int32_t, int>> pila = {{0, 0}};
+    while (!pila.empty()) {
+        auto& [s, codigo] = pila.back();
+        if (codigo > 256) {
+            pila.pop_back();
+            if (!pila.empty()) {
+                prefijo.pop_back();
+            }
+            continue;
+        }
+        int32_t t = base[s] + codigo;
+        int c = codigo++;
+        if (static_cast<uint32_t>(t) >= base.size() || check[t] != s) {
+            continue;
+        }
+        if (c == 0) {
+            visitar(prefijo, static_cast<uint32_t>(-base[t] - 1));
+        } else {
+            prefijo.push_back(static_cast<char>(c - 1));
+            pila.push_back({t, 0});
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef DOBLEARREGLO_H
+#define DOBLEARREGLO_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <functional>
+#include "AutomataLevenshtein.h"
+
+using namespace std;
+
+// Arreglo de solo lectura: sus datos son propios o apuntan a memoria externa (por ejemplo, un indice mapeado)
+// Como nunca cambian, las copias comparten los datos propios: copiar un trie no copia sus arreglos, y la
+// version vieja de un indice sigue valida mientras se construye una nueva a partir de su copia.
+template <typename T>
+class Arreglo {
+private:
+    shared_ptr<const vector<T>> propio;
+    const T* datos = nullptr;
+    size_t n = 0;
+
+public:
+    void asignar(vector<T>&& valores) {
+        auto nuevo = make_shared<const vector<T>>(move(valores));
+        datos = nuevo->data();
+        n = nuevo->size();
+        propio = move(nuevo);
+    }
+    void vista(const T* externos, size_t tamano) {
+        propio.reset();
+        datos = externos;
+        n = tamano;
+    }
+
+    const T& operator[](size_t i) const { return datos[i]; }
+    const T* data() const { return datos; }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+};
+
+// Trie de doble arreglo (base/check)
+// Desde el estado s, la letra c lleva al estado t = base[s] + codigo(c) siempre que check[t] == s.
+// El codigo 0 marca el final de una palabra: ese estado hoja guarda el valor de la palabra en base
+// (como numero negativo). Todo el trie vive en dos arreglos contiguos de enteros.
+class DobleArreglo {
+private:
+    Arreglo<int32_t> base;
+    Arreglo<int32_t> check;
+    size_t numeroClaves;
+    vector<uint16_t> codigosUsados;  // codigos de letra (1..256) que aparecen en alguna transicion
+
+    void calcularCodigosUsados();  // recorre todos los estados: solo al construir
+    struct RecorridoParecidas;
+    void parecidasDesde(int32_t estado, size_t profundidad, RecorridoParecidas& recorrido) const;
+
+public:
+    DobleArreglo();
+
+    // Construye el trie a partir de claves ordenadas y sin repetir; valores[i] corresponde a claves[i]
+    void construir(const vector<string>& claves, const vector<uint32_t>& valores);
+
+    // Usa arreglos externos ya construidos (no se copian, deben vivir mas que el trie). 'letras' es lo que devolvio
+    // letrasUsadas al guardarlos, para no recorrer los estados al cargar.
+    void asignarVista(const int32_t* datosBase, const int32_t* datosCheck, size_t numeroEstados, size_t claves,
+                      const array<uint64_t, 4>& letras);
+
+    // Busca la palabra y deja su valor en 'valor'; devuelve false si no existe
+    bool buscar(string_view palabra, uint32_t& valor) const;
+
+    // Valores de la primera y la ultima clave (en orden lexicografico) que empiezan con 'prefijo'; false si no hay
+    // ninguna. Si los valores siguen el orden de las claves, las del prefijo son justo los valores [primero, ultimo].
+    bool rangoPrefijo(string_view prefijo, uint32_t& primero, uint32_t& ultimo) const;
+
+    // Recorre las claves que acepta el automata de Levenshtein, llamando a visitar(clave, valor, distancia).
+    // 'fila' es el estado del automata antes de la primera letra de las claves (lo que ya se leyo fuera del
+    // trie). Las ramas donde el automata muere no se recorren, y sin holgura solo se prueban las letras que
+    // pueden seguir; con holgura, solo los codigos que usa el trie.
+    void recorrerParecidas(const AutomataLevenshtein& automata, const uint8_t* fila,
+                           const function<void(const string&, uint32_t, uint32_t)>& visitar) const;
+
+    // Recorre todas las claves en orden lexicografico
+    void recorrer(const function<void(const string&, uint32_t)>& visitar) const;
+
+    // Un bit por cada byte que aparece en alguna transicion (el bit b de letras[b / 64])
+    array<uint64_t, 4> letrasUsadas() const;
+
+    size_t claves() const { return numeroClaves; }
+    size_t estados() const { return base.size(); }
+    size_t bytesUsados() const { return (base.size() + check.size()) * sizeof(int32_t); }
+    const int32_t* datosBase() const { return base.data(); }
+    const int32_t* datosCheck() const { return check.data(); }
+};
+
+#endif // DOBLEARREGLO_H
@@ -0,0 +1,72 @@
+#include "HistogramaLatencias.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const unsigned BITS_CUBETA = 7;  // 128 cubetas por potencia de dos
+static const uint64_t CUBETAS = uint64_t(1) << BITS_CUBETA;
+static const size_t TOTAL_CUBETAS = 2 * CUBETAS + (64 - BITS_CUBETA - 1) * CUBETAS;
+
+// Los valores menores que 2 * CUBETAS tienen una cubeta cada uno; los demas comparten la suya con los que solo
+// difieren en los bits que quedan despues de los BITS_CUBETA + 1 mas significativos
+static size_t cubeta(uint64_t valor) {
+    if (valor < 2 * CUBETAS) {
+        return static_cast<size_t>(valor);
+    }
+    unsigned desplazamiento = static_cast<unsigned>(63 - __builtin_clzll(valor)) - BITS_CUBETA;
+    return static_cast<size_t>(2 * CUBETAS + (desplazamiento - 1) * CUBETAS + ((valor >> desplazamiento) - CUBETAS));
+}
+
+static uint64_t mayorDeCubeta(size_t indice) {
+    if (indice < 2 * CUBETAS) {
+        return indice;
+    }
+    unsigned desplazamiento = static_cast<unsigned>((indice - 2 * CUBETAS) / CUBETAS) + 1;
+    uint64_t base = ((indice - 2 * CUBETAS) % CUBETAS + CUBETAS) << desplazamiento;
+    return base + ((uint64_t(1) << desplazamiento) - 1);
+}
+
+HistogramaLatencias::HistogramaLatencias() : cuentas(TOTAL_CUBETAS, 0) {}
+
+void HistogramaLatencias::registrar(uint64_t valor, uint64_t veces) {
+    cuentas[cubeta(valor)] += veces;
+    total += veces;
+    minimo = min(minimo, valor);
+    maximo = max(maximo, valor);
+    suma += static_cast<double>(valor) * static_cast<double>(veces);
+}
+
+void HistogramaLatencias::sumar(const HistogramaLatencias& otro) {
+    for (size_t i = 0; i < cuentas.size(); ++i) {
+        cuentas[i] += otro.cuentas[i];
+    }
+    total += otro.total;
+    minimo = min(minimo, otro.minimo);
+    maximo = max(maximo, otro.maximo);
+    suma += otro.suma;
+}
+
+void HistogramaLatencias::vaciar() {
+    fill(cuentas.begin(), cuentas.end(), 0);
+    total = 0;
+    minimo = UINT64_MAX;
+    maximo = 0;
+    suma = 0;
+}
+
+uint64_t HistogramaLatencias::percentil(double percentil) const {
+    if (total == 0) {
+        return 0;
+    }
+    double fraccion = min(max(percentil, 0.0), 100.0) / 100.0;
+    uint64_t objetivo = max<uint64_t>(1, static_cast<uint64_t>(ceil(fraccion * static_cast<double>(total))));
+    uint64_t acumulado = 0;
+    for (size_t i = 0; i < cuentas.size(); ++i) {
+        acumulado += cuentas[i];
+        if (acumulado >= objetivo) {
+            return min(mayorDeCubeta(i), maximo);
+        }
+    }
+    return maximo;
+}
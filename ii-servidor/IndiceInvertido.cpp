@@ -1,149 +1,1416 @@
 #include "IndiceInvertido.h"
+#include "Consulta.h"
+#include "ListasOrdenadas.h"
 #include <sstream>
 #include <iostream>
-#include <QCoreApplication>
-#include <QDir>
+#include <algorithm>
+#include <iterator>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <cmath>
+#include <numeric>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
 using namespace std;
 
-Trie::Trie() {
-    root = new Node();
+// Contador compartido por todas las tablas y tries del proceso (ver TablaDocumentos::generacion)
+static atomic<uint64_t> ultimaGeneracion{0};
+
+static uint64_t nuevaGeneracion() {
+    return ultimaGeneracion.fetch_add(1, memory_order_relaxed) + 1;
+}
+
+uint64_t generacionIndice(const Trie& trie, const TablaDocumentos& documentos) {
+    return max(trie.generacion(), documentos.generacion());
+}
+
+TablaDocumentos::TablaDocumentos() : numeroGeneracion(nuevaGeneracion()) {}
+
+uint32_t TablaDocumentos::agregar(const string& ruta) {
+    error_code error;
+    uintmax_t bytes = filesystem::file_size(ruta, error);
+    int64_t modificado = 0;
+    if (!error) {
+        modificado = static_cast<int64_t>(filesystem::last_write_time(ruta, error).time_since_epoch().count());
+    }
+    documentos.push_back({ruta, filesystem::path(ruta).filename().string(), error ? 0 : static_cast<uint64_t>(bytes),
+                          error ? 0 : modificado});
+    uint32_t id = static_cast<uint32_t>(documentos.size() - 1);
+    porRuta.modificar(ruta) = id;
+    numeroGeneracion = nuevaGeneracion();
+    return id;
+}
+
+uint32_t TablaDocumentos::agregar(const Documento& documento) {
+    documentos.push_back(documento);
+    uint32_t id = static_cast<uint32_t>(documentos.size() - 1);
+    if (documento.borrado) {
+        ++numeroBorrados;
+    } else {
+        porRuta.modificar(documento.ruta) = id;
+        longitudVigentes += documento.longitud;
+    }
+    numeroGeneracion = nuevaGeneracion();
+    return id;
+}
+
+bool TablaDocumentos::borrar(uint32_t id) {
+    if (id >= documentos.size() || documentos[id].borrado) {
+        return false;
+    }
+    documentos.modificar(id).borrado = true;
+    ++numeroBorrados;
+    longitudVigentes -= documentos[id].longitud;
+    const uint32_t* vigente = porRuta.buscar(documentos[id].ruta);
+    if (vigente != nullptr && *vigente == id) {
+        porRuta.borrar(documentos[id].ruta);
+    }
+    numeroGeneracion = nuevaGeneracion();
+    return true;
+}
+
+uint32_t TablaDocumentos::buscarRuta(const string& ruta) const {
+    const uint32_t* id = porRuta.buscar(ruta);
+    return id == nullptr ? DOCUMENTO_INVALIDO : *id;
+}
+
+void TablaDocumentos::quitarBorrados(ListaPostings& lista) const {
+    // Un ID fuera de la tabla solo aparece con un indice guardado dañado
+    lista.erase(remove_if(lista.begin(), lista.end(), [&](uint32_t id) { return id >= documentos.size() || documentos[id].borrado; }),
+                lista.end());
+}
+
+void TablaDocumentos::asignarLongitud(uint32_t id, uint32_t longitud) {
+    if (!documentos[id].borrado) {
+        longitudVigentes += longitud;
+        longitudVigentes -= documentos[id].longitud;
+    }
+    documentos.modificar(id).longitud = longitud;
+    numeroGeneracion = nuevaGeneracion();
+}
+
+double TablaDocumentos::longitudPromedio() const {
+    size_t cantidad = vigentes();
+    return cantidad == 0 ? 0.0 : static_cast<double>(longitudVigentes) / cantidad;
+}
+
+void ListaFrecuencias::agregar(uint32_t documento, uint32_t frecuencia) {
+    if (documentos.empty() || documentos.back() < documento) {
+        documentos.push_back(documento);
+        frecuencias.push_back(frecuencia);
+    } else if (documentos.back() == documento) {
+        frecuencias.back() += frecuencia;
+    } else {
+        auto it = lower_bound(documentos.begin(), documentos.end(), documento);
+        size_t posicion = static_cast<size_t>(it - documentos.begin());
+        if (*it == documento) {
+            frecuencias[posicion] += frecuencia;
+        } else {
+            documentos.insert(it, documento);
+            frecuencias.insert(frecuencias.begin() + posicion, frecuencia);
+        }
+    }
+}
+
+static void escribirVarint(vector<uint8_t>& salida, uint32_t valor) {
+    while (valor >= 0x80) {
+        salida.push_back(static_cast<uint8_t>(valor | 0x80));
+        valor >>= 7;
+    }
+    salida.push_back(static_cast<uint8_t>(valor));
+}
+
+// Codifica una lista creciente de posiciones: la primera absoluta y luego las diferencias
+static void escribirPosiciones(const vector<uint32_t>& lista, vector<uint8_t>& salida) {
+    uint32_t anterior = 0;
+    for (uint32_t posicion : lista) {
+        escribirVarint(salida, posicion - anterior);
+        anterior = posicion;
+    }
+}
+
+void ListaFrecuencias::agregarPosicion(uint32_t documento, uint32_t posicion) {
+    if (inicioPosiciones.empty()) {
+        inicioPosiciones.push_back(0);
+    }
+    if (documentos.empty() || documentos.back() != documento) {
+        documentos.push_back(documento);
+        frecuencias.push_back(1);
+        escribirVarint(posiciones, posicion);
+        inicioPosiciones.push_back(static_cast<uint32_t>(posiciones.size()));
+    } else {
+        ++frecuencias.back();
+        escribirVarint(posiciones, posicion - ultimaPosicion);
+        inicioPosiciones.back() = static_cast<uint32_t>(posiciones.size());
+    }
+    ultimaPosicion = posicion;
 }
 
-void Trie::insertar(const string& palabra, const string& nombreArchivo) {
-    Node* node = root;
-    for (char letra : palabra) {
-        if (!node->children.count(letra)) {
-            node->children[letra] = new Node();
+void ListaFrecuencias::ordenar() {
+    if (is_sorted(documentos.begin(), documentos.end())) {
+        return;
+    }
+    vector<uint32_t> orden(documentos.size());
+    iota(orden.begin(), orden.end(), 0);
+    sort(orden.begin(), orden.end(), [&](uint32_t a, uint32_t b) { return documentos[a] < documentos[b]; });
+
+    bool conPosiciones = tienePosiciones();
+    ListaFrecuencias ordenada;
+    ordenada.documentos.reserve(documentos.size());
+    ordenada.frecuencias.reserve(frecuencias.size());
+    if (conPosiciones) {
+        ordenada.inicioPosiciones.reserve(inicioPosiciones.size());
+        ordenada.inicioPosiciones.push_back(0);
+        ordenada.posiciones.reserve(posiciones.size());
+    }
+    for (uint32_t i : orden) {
+        ordenada.documentos.push_back(documentos[i]);
+        ordenada.frecuencias.push_back(frecuencias[i]);
+        if (conPosiciones) {
+            ordenada.posiciones.insert(ordenada.posiciones.end(), posiciones.begin() + inicioPosiciones[i],
+                                       posiciones.begin() + inicioPosiciones[i + 1]);
+            ordenada.inicioPosiciones.push_back(static_cast<uint32_t>(ordenada.posiciones.size()));
         }
-        node = node->children[letra];
     }
-    node->nombresArchivos.insert(nombreArchivo);
+    ordenada.ultimaPosicion = ultimaPosicion;
+    *this = move(ordenada);
 }
 
-unordered_set<string> Trie::buscar(const string& palabra) const {
-    Node* node = root;
-    for (char letra : palabra) {
-        if (!node->children.count(letra)) {
-            return {};
+bool VistaPostings::leerPosiciones(size_t i, vector<uint32_t>& salida) const {
+    salida.clear();
+    if (!inicioPosiciones) {
+        return false;
+    }
+    uint32_t inicio = inicioPosiciones[i];
+    uint32_t fin = inicioPosiciones[i + 1];
+    if (inicio > fin || fin > bytesPosiciones) {  // solo con un indice guardado corrupto
+        return false;
+    }
+    // Casi todas las diferencias caben en uno o dos bytes: el caso de un byte no entra al ciclo interno
+    salida.reserve(frecuencia(i));
+    const uint8_t* byte = posiciones + inicio;
+    const uint8_t* final = posiciones + fin;
+    uint32_t posicion = 0;
+    while (byte < final) {
+        uint32_t valor = *byte++;
+        if (valor >= 0x80) {
+            valor &= 0x7F;
+            unsigned desplazamiento = 7;
+            uint8_t siguiente;
+            do {
+                if (byte == final || desplazamiento > 28) {
+                    return false;
+                }
+                siguiente = *byte++;
+                valor |= static_cast<uint32_t>(siguiente & 0x7F) << desplazamiento;
+                desplazamiento += 7;
+            } while (siguiente & 0x80);
         }
-        node = node->children[letra];
+        posicion += valor;
+        salida.push_back(posicion);
     }
-    return node->nombresArchivos;
+    return true;
 }
 
-unordered_map<string, string> recolectarArchivos(const vector<string>& nombresArchivos) {
-    unordered_map<string, string> archivosRecolectados;
-    for (const string& nombre : nombresArchivos) {
-        ifstream archivoEntrada(nombre);
-        if (archivoEntrada) {
-            stringstream texto;
-            texto << archivoEntrada.rdbuf();
-            archivosRecolectados[nombre] = texto.str();
+void combinarPostings(VistaPostings a, VistaPostings b, ListaFrecuencias& salida, const TablaDocumentos* filtro) {
+    bool conPosiciones = a.tienePosiciones() || b.tienePosiciones();
+    if (conPosiciones && salida.inicioPosiciones.empty()) {
+        salida.inicioPosiciones.assign(salida.documentos.size() + 1, static_cast<uint32_t>(salida.posiciones.size()));
+    }
+    auto descartado = [&](uint32_t documento) {
+        return filtro && (documento >= filtro->size() || !filtro->vigente(documento));
+    };
+    auto copiar = [&](const VistaPostings& lista, size_t i) {
+        if (descartado(lista[i])) {
+            return;
+        }
+        salida.documentos.push_back(lista[i]);
+        salida.frecuencias.push_back(lista.frecuencia(i));
+        if (conPosiciones) {
+            // Los bytes se copian tal cual: cada documento empieza con su posicion absoluta
+            if (lista.tienePosiciones() && lista.inicioPosiciones[i] <= lista.inicioPosiciones[i + 1] &&
+                lista.inicioPosiciones[i + 1] <= lista.bytesPosiciones) {
+                salida.posiciones.insert(salida.posiciones.end(), lista.posiciones + lista.inicioPosiciones[i],
+                                         lista.posiciones + lista.inicioPosiciones[i + 1]);
+            }
+            salida.inicioPosiciones.push_back(static_cast<uint32_t>(salida.posiciones.size()));
+        }
+    };
+
+    vector<uint32_t> posicionesA, posicionesB, juntas;
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] < b[j]) {
+            copiar(a, i++);
+        } else if (b[j] < a[i]) {
+            copiar(b, j++);
         } else {
-            cerr << "Error al abrir el archivo: " << nombre << endl;
+            if (!descartado(a[i])) {
+                salida.documentos.push_back(a[i]);
+                salida.frecuencias.push_back(a.frecuencia(i) + b.frecuencia(j));
+                if (conPosiciones) {
+                    a.leerPosiciones(i, posicionesA);
+                    b.leerPosiciones(j, posicionesB);
+                    juntas.clear();
+                    merge(posicionesA.begin(), posicionesA.end(), posicionesB.begin(), posicionesB.end(), back_inserter(juntas));
+                    escribirPosiciones(juntas, salida.posiciones);
+                    salida.inicioPosiciones.push_back(static_cast<uint32_t>(salida.posiciones.size()));
+                }
+            }
+            ++i;
+            ++j;
         }
     }
-    return archivosRecolectados;
+    for (; i < a.size(); ++i) {
+        copiar(a, i);
+    }
+    for (; j < b.size(); ++j) {
+        copiar(b, j);
+    }
 }
 
-string eliminarSignos(const string& texto) {
-    string nuevoTexto;
-    for (char caracter : texto) {
-        if (isalnum(caracter) || caracter == ' ') {
-            nuevoTexto += caracter;
-        } else if (caracter == '\n') {
-            nuevoTexto += ' ';
+Trie::Trie() : numeroGeneracion(nuevaGeneracion()) {}
+
+void Trie::marcarCambio() {
+    numeroGeneracion = nuevaGeneracion();
+}
+
+PostingsComprimidos Trie::Particion::compactada(string_view resto) const {
+    uint32_t termino;
+    if (!diccionario.buscar(resto, termino)) {
+        return PostingsComprimidos();
+    }
+    return compactada(termino);
+}
+
+PostingsComprimidos Trie::Particion::compactada(uint32_t termino) const {
+    PostingsComprimidos lista;
+    if (termino + 1 >= inicios.size() || iniciosBytes.size() != inicios.size()) {
+        return lista;
+    }
+    uint32_t inicio = inicios[termino];
+    uint32_t fin = inicios[termino + 1];
+    uint32_t inicioBytes = iniciosBytes[termino];
+    uint32_t finBytes = iniciosBytes[termino + 1];
+    // Los limites solo fallan con un indice guardado corrupto
+    if (inicio > fin || inicioBytes > finBytes || finBytes > postings.size() ||
+        !lista.abrir(postings.data() + inicioBytes, finBytes - inicioBytes, fin - inicio)) {
+        return PostingsComprimidos();
+    }
+    if (inicioPosiciones.size() > fin) {
+        lista.inicioPosiciones = inicioPosiciones.data() + inicio;
+        lista.posiciones = posiciones.data();
+        lista.bytesPosiciones = posiciones.size();
+    }
+    return lista;
+}
+
+PostingsPalabra Trie::Particion::buscar(string_view resto) const {
+    PostingsPalabra postings;
+    postings.compactada = compactada(resto);
+    if (const ListaFrecuencias* agregada = agregados.buscar(resto)) {
+        postings.agregada = *agregada;
+    }
+    return postings;
+}
+
+ExpansionPalabras Trie::Particion::expandir(string_view resto, size_t maximo) const {
+    const uint32_t SIN_TERMINO = UINT32_MAX;
+    struct Candidata {
+        size_t documentos;
+        uint32_t termino;  // en el doble arreglo, o SIN_TERMINO si la palabra solo esta en el delta
+        const ListaFrecuencias* agregada;
+    };
+    vector<Candidata> candidatas;
+    uint32_t primero = 0, ultimo = 0;
+    bool hayCompactadas = diccionario.rangoPrefijo(resto, primero, ultimo) && ultimo + 1 < inicios.size();
+    if (hayCompactadas) {
+        candidatas.reserve(ultimo - primero + 1);
+        for (uint32_t termino = primero; termino <= ultimo; ++termino) {
+            uint32_t inicio = inicios[termino];
+            uint32_t fin = inicios[termino + 1];
+            candidatas.push_back({fin >= inicio ? fin - inicio : 0, termino, nullptr});
         }
     }
-    return nuevoTexto;
+    agregados.recorrer([&](const string& palabra, const ListaFrecuencias& lista) {
+        if (palabra.compare(0, resto.size(), resto) != 0) {
+            return;
+        }
+        uint32_t termino;
+        if (hayCompactadas && diccionario.buscar(palabra, termino) && termino >= primero && termino <= ultimo) {
+            candidatas[termino - primero].documentos += lista.size();
+            candidatas[termino - primero].agregada = &lista;
+        } else {
+            candidatas.push_back({lista.size(), SIN_TERMINO, &lista});
+        }
+    });
+
+    ExpansionPalabras expansion;
+    if (candidatas.size() > maximo) {
+        nth_element(candidatas.begin(), candidatas.begin() + maximo, candidatas.end(),
+                    [](const Candidata& a, const Candidata& b) { return a.documentos > b.documentos; });
+        expansion.descartadas = candidatas.size() - maximo;
+        candidatas.resize(maximo);
+    }
+    expansion.postings.reserve(candidatas.size());
+    for (const Candidata& candidata : candidatas) {
+        PostingsPalabra postings;
+        if (candidata.termino != SIN_TERMINO) {
+            postings.compactada = compactada(candidata.termino);
+        }
+        if (candidata.agregada) {
+            postings.agregada = *candidata.agregada;
+        }
+        expansion.documentos += postings.size();
+        expansion.postings.push_back(postings);
+    }
+    return expansion;
 }
 
-vector<string> tokenizarTexto(const string& texto) {
-    vector<string> listaPalabras;
-    istringstream stream(texto);
-    string palabra;
-    while (stream >> palabra) {
-        listaPalabras.push_back(palabra);
+void Trie::Particion::construir(const TablaDocumentos* tabla) {
+    bool descartarBorrados = tabla && tabla->borrados() > 0;
+    if (agregados.empty() && !descartarBorrados) {
+        return;
     }
-    return listaPalabras;
+    vector<pair<string_view, const ListaFrecuencias*>> nuevas;
+    nuevas.reserve(agregados.size());
+    agregados.recorrer([&](const string& resto, const ListaFrecuencias& lista) {
+        nuevas.push_back({resto, &lista});
+    });
+    fundir(nuevas, descartarBorrados ? tabla : nullptr);
+    agregados.clear();  // despues de fundir: 'nuevas' apunta al delta
 }
 
-vector<string> eliminarStopWords(const vector<string>& listaPalabras, const unordered_set<string>& stopWords) {
-    vector<string> palabrasFiltradas;
-    for (const string& palabra : listaPalabras) {
-        if (stopWords.find(palabra) == stopWords.end()) {
-            palabrasFiltradas.push_back(palabra);
+void Trie::Particion::fundir(vector<pair<string_view, const ListaFrecuencias*>>& nuevas, const TablaDocumentos* tabla) {
+    // Juntamos las palabras ya compactadas (el diccionario se recorre en orden) con las nuevas ordenadas,
+    // como pide el doble arreglo
+    struct Entrada {
+        string resto;
+        PostingsComprimidos compactada;
+        VistaPostings agregada;
+    };
+    sort(nuevas.begin(), nuevas.end());
+    vector<Entrada> entradas;
+    entradas.reserve(diccionario.claves() + nuevas.size());
+    size_t siguiente = 0;
+    diccionario.recorrer([&](const string& resto, uint32_t termino) {
+        for (; siguiente < nuevas.size() && nuevas[siguiente].first < resto; ++siguiente) {
+            entradas.push_back({string(nuevas[siguiente].first), PostingsComprimidos(), *nuevas[siguiente].second});
         }
+        VistaPostings agregada;
+        if (siguiente < nuevas.size() && nuevas[siguiente].first == resto) {
+            agregada = *nuevas[siguiente++].second;
+        }
+        entradas.push_back({resto, compactada(termino), agregada});
+    });
+    for (; siguiente < nuevas.size(); ++siguiente) {
+        entradas.push_back({string(nuevas[siguiente].first), PostingsComprimidos(), *nuevas[siguiente].second});
+    }
+
+    // Cada lista se decodifica, se junta con su delta y se vuelve a comprimir; las posiciones se copian
+    vector<string> claves;
+    vector<uint32_t> valores;
+    vector<uint32_t> nuevosInicios;
+    vector<uint32_t> nuevosIniciosBytes;
+    vector<uint8_t> nuevosPostings;
+    vector<uint32_t> nuevosInicioPosiciones;
+    vector<uint8_t> nuevasPosiciones;
+    claves.reserve(entradas.size());
+    valores.reserve(entradas.size());
+    nuevosInicios.reserve(entradas.size() + 1);
+    nuevosIniciosBytes.reserve(entradas.size() + 1);
+    uint32_t total = 0;
+    for (Entrada& entrada : entradas) {
+        ListaFrecuencias anterior, combinada;
+        combinarPostings(descomprimirPostings(entrada.compactada, anterior), entrada.agregada, combinada, tabla);
+        if (combinada.empty()) {
+            continue;  // la palabra solo aparecia en documentos borrados
+        }
+        valores.push_back(static_cast<uint32_t>(claves.size()));
+        claves.push_back(move(entrada.resto));
+        nuevosInicios.push_back(total);
+        nuevosIniciosBytes.push_back(static_cast<uint32_t>(nuevosPostings.size()));
+        comprimirPostings(combinada.documentos.data(), combinada.frecuencias.data(), combinada.size(), nuevosPostings);
+        if (combinada.tienePosiciones() && nuevosInicioPosiciones.empty()) {
+            nuevosInicioPosiciones.assign(total + 1, static_cast<uint32_t>(nuevasPosiciones.size()));
+        }
+        if (!nuevosInicioPosiciones.empty()) {
+            uint32_t base = static_cast<uint32_t>(nuevasPosiciones.size());
+            if (combinada.tienePosiciones()) {
+                nuevasPosiciones.insert(nuevasPosiciones.end(), combinada.posiciones.begin(), combinada.posiciones.end());
+                for (size_t i = 1; i < combinada.inicioPosiciones.size(); ++i) {
+                    nuevosInicioPosiciones.push_back(base + combinada.inicioPosiciones[i]);
+                }
+            } else {
+                nuevosInicioPosiciones.insert(nuevosInicioPosiciones.end(), combinada.size(), base);
+            }
+        }
+        total += static_cast<uint32_t>(combinada.size());
+    }
+    if (!claves.empty()) {
+        nuevosInicios.push_back(total);
+        nuevosIniciosBytes.push_back(static_cast<uint32_t>(nuevosPostings.size()));
     }
-    return palabrasFiltradas;
+
+    // Las entradas apuntan a los arreglos viejos y al delta: se reemplazan al final
+    diccionario.construir(claves, valores);
+    inicios.asignar(move(nuevosInicios));
+    iniciosBytes.asignar(move(nuevosIniciosBytes));
+    postings.asignar(move(nuevosPostings));
+    inicioPosiciones.asignar(move(nuevosInicioPosiciones));
+    posiciones.asignar(move(nuevasPosiciones));
 }
 
-vector<PalabraArchivo> mapearArchivos(const unordered_map<string, vector<string>>& archivosProcesados) {
-    vector<PalabraArchivo> datosMapeados;
-    for (const auto& [nombre, listaPalabras] : archivosProcesados) {
-        for (const string& palabra : listaPalabras) {
-            datosMapeados.push_back({palabra, nombre});
+// Junta 'nuevos' a la lista 'actual' de la misma palabra
+static void juntarListas(ListaFrecuencias& actual, const ListaFrecuencias& nuevos) {
+    if (actual.empty()) {
+        actual = nuevos;
+    } else if (actual.documentos.back() < nuevos.documentos.front() && actual.tienePosiciones() == nuevos.tienePosiciones()) {
+        actual.documentos.insert(actual.documentos.end(), nuevos.documentos.begin(), nuevos.documentos.end());
+        actual.frecuencias.insert(actual.frecuencias.end(), nuevos.frecuencias.begin(), nuevos.frecuencias.end());
+        if (nuevos.tienePosiciones()) {
+            uint32_t base = static_cast<uint32_t>(actual.posiciones.size());
+            actual.posiciones.insert(actual.posiciones.end(), nuevos.posiciones.begin(), nuevos.posiciones.end());
+            for (size_t i = 1; i < nuevos.inicioPosiciones.size(); ++i) {
+                actual.inicioPosiciones.push_back(base + nuevos.inicioPosiciones[i]);
+            }
         }
+    } else {
+        // Un documento repartido en fragmentos aparece en varios parciales: sus frecuencias se suman
+        ListaFrecuencias combinada;
+        combinarPostings(actual, nuevos, combinada);
+        actual = move(combinada);
+    }
+}
+
+void Trie::Particion::agregarLista(string_view resto, const ListaFrecuencias& nuevos) {
+    if (!nuevos.empty()) {
+        juntarListas(lista(resto), nuevos);
+    }
+}
+
+void Trie::insertar(const string& palabra, uint32_t documento, uint32_t frecuencia) {
+    if (palabra.empty()) {
+        return;
     }
-    return datosMapeados;
+    particiones[static_cast<unsigned char>(palabra[0])].lista(string_view(palabra).substr(1)).agregar(documento, frecuencia);
+    marcarCambio();
 }
 
-unordered_map<string, vector<string>> shuffle(const vector<PalabraArchivo>& datosMapeados) {
-    unordered_map<string, vector<string>> datosAgrupados;
-    for (const auto& dato : datosMapeados) {
-        datosAgrupados[dato.palabra].push_back(dato.nombreArchivo);
+void Trie::insertarLista(const string& palabra, const ListaFrecuencias& lista) {
+    if (palabra.empty()) {
+        return;
     }
-    return datosAgrupados;
+    particiones[static_cast<unsigned char>(palabra[0])].agregarLista(string_view(palabra).substr(1), lista);
+    marcarCambio();
 }
 
-void reducirDatos(const unordered_map<string, vector<string>>& datosAgrupados, Trie& trie) {
-    for (const auto& [palabra, nombresArchivos] : datosAgrupados) {
-        for (const auto& nombreArchivo : nombresArchivos) {
-            trie.insertar(palabra, nombreArchivo);
+void Trie::configurar(bool posiciones, const unordered_set<string>& stopWords) {
+    conPosiciones = posiciones;
+    palabrasVacias = make_shared<const unordered_set<string>>(stopWords);
+    marcarCambio();
+}
+
+PostingsPalabra Trie::buscar(const string& palabra) const {
+    if (palabra.empty()) {
+        return PostingsPalabra();
+    }
+    return particiones[static_cast<unsigned char>(palabra[0])].buscar(string_view(palabra).substr(1));
+}
+
+void Trie::Particion::parecidas(char inicial, const AutomataLevenshtein& automata, const uint8_t* fila, ExpansionPalabras& expansion) const {
+    diccionario.recorrerParecidas(automata, fila, [&](const string& resto, uint32_t termino, uint32_t distancia) {
+        PostingsPalabra postings;
+        postings.compactada = compactada(termino);
+        if (const ListaFrecuencias* agregada = agregados.buscar(resto)) {
+            postings.agregada = *agregada;
+        }
+        expansion.postings.push_back(postings);
+        expansion.palabras.push_back(inicial + resto);
+        expansion.distancias.push_back(distancia);
+    });
+    // Las palabras que solo estan en el delta se revisan una por una, dejando de leer en cuanto el automata muere
+    vector<uint8_t> filas(2 * automata.columnas());
+    agregados.recorrer([&](const string& resto, const ListaFrecuencias& lista) {
+        uint32_t termino;
+        if (lista.empty() || diccionario.buscar(resto, termino)) {
+            return;
+        }
+        copy(fila, fila + automata.columnas(), filas.begin());
+        uint8_t* actual = filas.data();
+        uint8_t* siguiente = filas.data() + automata.columnas();
+        bool viva = true;
+        for (size_t i = 0; i < resto.size() && viva; ++i) {
+            viva = automata.avanzar(actual, static_cast<uint8_t>(resto[i]), siguiente);
+            swap(actual, siguiente);
+        }
+        if (viva && automata.distancia(actual) <= automata.distanciaMaxima()) {
+            PostingsPalabra postings;
+            postings.agregada = lista;
+            expansion.postings.push_back(postings);
+            expansion.palabras.push_back(inicial + resto);
+            expansion.distancias.push_back(automata.distancia(actual));
+        }
+    });
+}
+
+ExpansionPalabras Trie::buscarParecidas(const string& palabra, uint32_t distancia, size_t maximo) const {
+    ExpansionPalabras encontradas;
+    AutomataLevenshtein automata(palabra, distancia);
+    vector<uint8_t> inicio(automata.columnas()), fila(automata.columnas());
+    automata.inicial(inicio.data());
+    for (size_t inicial = 0; inicial < particiones.size(); ++inicial) {
+        const Particion& particion = particiones[inicial];
+        if (particion.diccionario.claves() == 0 && particion.agregados.empty()) {
+            continue;
+        }
+        if (automata.avanzar(inicio.data(), static_cast<uint8_t>(inicial), fila.data())) {
+            particion.parecidas(static_cast<char>(inicial), automata, fila.data(), encontradas);
         }
     }
+
+    // Primero las mas cercanas y, a igual distancia, las de mas documentos
+    vector<size_t> orden(encontradas.postings.size());
+    iota(orden.begin(), orden.end(), 0);
+    sort(orden.begin(), orden.end(), [&](size_t a, size_t b) {
+        if (encontradas.distancias[a] != encontradas.distancias[b]) {
+            return encontradas.distancias[a] < encontradas.distancias[b];
+        }
+        return encontradas.postings[a].size() > encontradas.postings[b].size();
+    });
+    ExpansionPalabras expansion;
+    if (orden.size() > maximo) {
+        expansion.descartadas = orden.size() - maximo;
+        orden.resize(maximo);
+    }
+    for (size_t i : orden) {
+        expansion.postings.push_back(encontradas.postings[i]);
+        expansion.palabras.push_back(move(encontradas.palabras[i]));
+        expansion.distancias.push_back(encontradas.distancias[i]);
+        expansion.documentos += encontradas.postings[i].size();
+    }
+    return expansion;
 }
 
-unordered_set<string> procesarEntrada(const Trie& trie, const string& entrada) {
-    istringstream stream(entrada);
-    string palabra1, operador, palabra2;
-    stream >> palabra1 >> operador >> palabra2;
-
-    if (operador == "AND" || operador == "and") {
-        unordered_set<string> archivosEncontrados1 = trie.buscar(palabra1);
-        unordered_set<string> archivosEncontrados2 = trie.buscar(palabra2);
-        unordered_set<string> interseccionArchivos;
-        for (const string& nombres : archivosEncontrados1) {
-            if (archivosEncontrados2.find(nombres) != archivosEncontrados2.end()) {
-                interseccionArchivos.insert(nombres);
-            }
-        }
-        return interseccionArchivos;
-    } else if (operador == "OR" || operador == "or") {
-        unordered_set<string> archivosEncontrados1 = trie.buscar(palabra1);
-        unordered_set<string> archivosEncontrados2 = trie.buscar(palabra2);
-        archivosEncontrados1.merge(archivosEncontrados2);
-        return archivosEncontrados1;
+ExpansionPalabras Trie::expandirPrefijo(const string& prefijo, size_t maximo) const {
+    if (prefijo.empty()) {
+        return ExpansionPalabras();
+    }
+    return particiones[static_cast<unsigned char>(prefijo[0])].expandir(string_view(prefijo).substr(1), maximo);
+}
+
+void Trie::construir() {
+    for (Particion& particion : particiones) {
+        particion.construir();
+    }
+    marcarCambio();
+}
+
+void Trie::compactar(const TablaDocumentos& tabla) {
+    for (Particion& particion : particiones) {
+        particion.construir(&tabla);
+    }
+    marcarCambio();
+}
+
+size_t Trie::palabrasAgregadas() const {
+    size_t palabras = 0;
+    for (const Particion& particion : particiones) {
+        palabras += particion.agregados.size();
+    }
+    return palabras;
+}
+
+void Trie::reducirParticion(unsigned char inicial, const vector<Invertidor>& parciales) {
+    // Las listas de los hilos se juntan aqui y no en el delta, que se comparte entre versiones y cuesta mas
+    // llenar; una palabra que vio un solo hilo se funde sin copiar su lista
+    struct Nueva {
+        const ListaFrecuencias* lista;
+        ListaFrecuencias* juntada = nullptr;  // la copia donde se juntan las de varios hilos
+    };
+    Particion& particion = particiones[inicial];
+    unordered_map<string_view, Nueva> porResto;
+    deque<ListaFrecuencias> juntadas;
+    particion.agregados.recorrer([&](const string& resto, const ListaFrecuencias& lista) {
+        porResto.emplace(resto, Nueva{&lista});
+    });
+    for (const Invertidor& parcial : parciales) {
+        for (uint32_t termino : parcial.terminosConInicial(inicial)) {
+            const ListaFrecuencias& lista = parcial.lista(termino);
+            if (lista.empty()) {
+                continue;
+            }
+            auto [it, nueva] = porResto.try_emplace(string_view(parcial.palabra(termino)).substr(1), Nueva{&lista});
+            if (!nueva) {
+                Nueva& anterior = it->second;
+                if (anterior.juntada == nullptr) {
+                    juntadas.push_back(*anterior.lista);
+                    anterior.juntada = &juntadas.back();
+                    anterior.lista = anterior.juntada;
+                }
+                juntarListas(*anterior.juntada, lista);
+            }
+        }
+    }
+    vector<pair<string_view, const ListaFrecuencias*>> nuevas;
+    nuevas.reserve(porResto.size());
+    for (const auto& [resto, lista] : porResto) {
+        nuevas.push_back({resto, lista.lista});
+    }
+    particion.fundir(nuevas, nullptr);
+    particion.agregados.clear();
+}
+
+size_t Trie::bytesDiccionario() const {
+    size_t bytes = 0;
+    for (const Particion& particion : particiones) {
+        bytes += particion.diccionario.bytesUsados();
+    }
+    return bytes;
+}
+
+size_t Trie::bytesPostings() const {
+    size_t bytes = 0;
+    for (const Particion& particion : particiones) {
+        bytes += (particion.inicios.size() + particion.iniciosBytes.size()) * sizeof(uint32_t) + particion.postings.size();
+    }
+    return bytes + bytesPosiciones();
+}
+
+size_t Trie::bytesPosiciones() const {
+    size_t bytes = 0;
+    for (const Particion& particion : particiones) {
+        bytes += particion.inicioPosiciones.size() * sizeof(uint32_t) + particion.posiciones.size();
+    }
+    return bytes;
+}
+
+size_t Trie::terminos() const {
+    size_t terminos = 0;
+    for (const Particion& particion : particiones) {
+        terminos += particion.inicios.size() > 0 ? particion.inicios.size() - 1 : 0;
+    }
+    return terminos;
+}
+
+uint64_t Trie::numeroPostings() const {
+    uint64_t postings = 0;
+    for (const Particion& particion : particiones) {
+        postings += particion.inicios.size() > 0 ? particion.inicios[particion.inicios.size() - 1] : 0;
+        particion.agregados.recorrer([&](const string&, const ListaFrecuencias& lista) {
+            postings += lista.size();
+        });
+    }
+    return postings;
+}
+
+size_t Trie::estados() const {
+    size_t estados = 0;
+    for (const Particion& particion : particiones) {
+        estados += particion.diccionario.estados();
+    }
+    return estados;
+}
+
+bool recolectarArchivo(uint32_t documento, const TablaDocumentos& tabla, ArchivoMapeado& archivo, ModoLectura modo) {
+    const string& nombre = tabla.obtener(documento).ruta;
+    if (!archivo.abrir(nombre, modo)) {
+        cerr << "Error al abrir el archivo: " << nombre << endl;
+        return false;
+    }
+    return true;
+}
+
+unordered_set<string_view> vistaStopWords(const unordered_set<string>& stopWords) {
+    unordered_set<string_view> vista;
+    vista.reserve(stopWords.size());
+    for (const string& palabra : stopWords) {
+        vista.insert(palabra);
+    }
+    return vista;
+}
+
+void Invertidor::agregar(string_view palabra, uint32_t documento, uint32_t posicion) {
+    auto it = terminos.find(palabra);
+    if (it == terminos.end()) {
+        uint32_t termino = static_cast<uint32_t>(listas.size());
+        palabras.emplace_back(palabra);
+        it = terminos.emplace(palabras.back(), termino).first;
+        listas.emplace_back();
+        porInicial[static_cast<unsigned char>(palabra[0])].push_back(termino);
+    }
+    if (posicion == SIN_POSICION) {
+        listas[it->second].agregar(documento);
     } else {
-        return trie.buscar(palabra1);
+        listas[it->second].agregarPosicion(documento, posicion);
+    }
+    if (documento >= longitudes.size()) {
+        longitudes.resize(documento + 1, 0);
+    }
+    ++longitudes[documento];
+}
+
+void Invertidor::ordenarListas() {
+    for (ListaFrecuencias& lista : listas) {
+        if (lista.tienePosiciones()) {
+            lista.ordenar();
+        }
+    }
+}
+
+size_t procesarDocumento(string_view texto, uint32_t documento, const unordered_set<string_view>& stopWords,
+                         Tokenizador& tokenizador, Invertidor& invertidor, bool conPosiciones) {
+    uint32_t posicion = 0;  // cuenta tambien las vacias: "trabajo en equipo" deja el hueco de "en"
+    tokenizador.tokenizar(texto, [&](string_view palabra) {
+        if (stopWords.find(palabra) == stopWords.end()) {
+            invertidor.agregar(palabra, documento, conPosiciones ? posicion : SIN_POSICION);
+        }
+        ++posicion;
+    });
+    return posicion;
+}
+
+// Cuenta el avance de mapearDocumentos para opciones.progreso
+class AvanceIndexado {
+private:
+    const OpcionesIndexado& opciones;
+    mutex candado;
+    ProgresoIndexado progreso;
+    atomic<uint64_t> palabras{0};
+    chrono::steady_clock::time_point inicio = chrono::steady_clock::now();
+
+public:
+    AvanceIndexado(const vector<uint32_t>& documentos, const TablaDocumentos& tabla, const OpcionesIndexado& opciones)
+        : opciones(opciones) {
+        if (!opciones.progreso) {
+            return;
+        }
+        progreso.archivosTotales = documentos.size();
+        for (uint32_t documento : documentos) {
+            error_code error;
+            uintmax_t bytes = filesystem::file_size(tabla.obtener(documento).ruta, error);
+            if (!error) {
+                progreso.bytesTotales += bytes;
+            }
+        }
+    }
+
+    void sumarPalabras(size_t cantidad) {
+        palabras.fetch_add(cantidad, memory_order_relaxed);
+    }
+
+    uint64_t palabrasTotales() const { return palabras.load(memory_order_relaxed); }
+
+    void terminarArchivo(size_t bytes) {
+        if (!opciones.progreso) {
+            return;
+        }
+        lock_guard<mutex> lock(candado);
+        ++progreso.archivosTerminados;
+        progreso.bytesLeidos += bytes;
+        progreso.palabras = palabras.load(memory_order_relaxed);
+        progreso.segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+        opciones.progreso(progreso);
+    }
+};
+
+vector<Invertidor> mapearDocumentos(const vector<uint32_t>& documentos, const TablaDocumentos& tabla,
+                                    const unordered_set<string_view>& stopWords, const OpcionesIndexado& opciones, PoolHilos& pool) {
+    vector<Invertidor> parciales(pool.size());
+    vector<Tokenizador> tokenizadores(pool.size());
+    AvanceIndexado avance(documentos, tabla, opciones);
+    for (uint32_t documento : documentos) {
+        pool.agregar([&, documento] {
+            // Los fragmentos comparten el archivo: se desmapea cuando termina el ultimo
+            auto archivo = make_shared<ArchivoMapeado>();
+            if (!recolectarArchivo(documento, tabla, *archivo, opciones.modo)) {
+                avance.terminarArchivo(0);
+                return;
+            }
+            if (opciones.posiciones) {
+                size_t hilo = PoolHilos::hiloActual();
+                avance.sumarPalabras(procesarDocumento(archivo->contenido(), documento, stopWords, tokenizadores[hilo], parciales[hilo], true));
+                avance.terminarArchivo(archivo->contenido().size());
+                return;
+            }
+            vector<string_view> fragmentos = dividirEnFragmentos(archivo->contenido(), opciones.tamanoFragmento);
+            if (fragmentos.empty()) {
+                avance.terminarArchivo(0);
+                return;
+            }
+            // El archivo termina con el ultimo de sus fragmentos, en el hilo que sea
+            auto pendientes = make_shared<atomic<size_t>>(fragmentos.size());
+            auto procesarFragmento = [&, archivo, documento, pendientes](string_view fragmento) {
+                size_t hilo = PoolHilos::hiloActual();
+                avance.sumarPalabras(procesarDocumento(fragmento, documento, stopWords, tokenizadores[hilo], parciales[hilo]));
+                if (pendientes->fetch_sub(1) == 1) {
+                    avance.terminarArchivo(archivo->contenido().size());
+                }
+            };
+            for (size_t i = 1; i < fragmentos.size(); ++i) {
+                pool.agregar([procesarFragmento, fragmento = fragmentos[i]] { procesarFragmento(fragmento); });
+            }
+            procesarFragmento(fragmentos[0]);
+        });
+    }
+    pool.esperar();
+    if (opciones.posiciones) {
+        // Cada hilo recibio los documentos en el orden en que los tomo; sus listas se ordenan por ID en paralelo
+        for (Invertidor& parcial : parciales) {
+            pool.agregar([&parcial] { parcial.ordenarListas(); });
+        }
+        pool.esperar();
+    }
+    if (opciones.metricas) {
+        opciones.metricas->palabras = avance.palabrasTotales();
+    }
+    return parciales;
+}
+
+void reducirDatos(const vector<Invertidor>& parciales, Trie& trie, PoolHilos& pool) {
+    // Las ramas con mas palabras se agregan primero para repartir mejor el trabajo entre los hilos
+    vector<pair<size_t, int>> ramas;
+    for (int inicial = 0; inicial < 256; ++inicial) {
+        size_t palabras = 0;
+        for (const Invertidor& parcial : parciales) {
+            palabras += parcial.terminosConInicial(static_cast<unsigned char>(inicial)).size();
+        }
+        if (palabras > 0) {
+            ramas.push_back({palabras, inicial});
+        }
+    }
+    sort(ramas.rbegin(), ramas.rend());
+    for (auto& [palabras, inicial] : ramas) {
+        pool.agregar([&, inicial = inicial] {
+            trie.reducirParticion(static_cast<unsigned char>(inicial), parciales);
+        });
+    }
+    pool.esperar();
+    trie.marcarCambio();
+}
+
+void registrarLongitudes(const vector<Invertidor>& parciales, TablaDocumentos& tabla) {
+    vector<uint32_t> longitudes(tabla.size(), 0);
+    for (const Invertidor& parcial : parciales) {
+        const vector<uint32_t>& vistas = parcial.longitudesDocumentos();
+        for (size_t id = 0; id < vistas.size() && id < longitudes.size(); ++id) {
+            longitudes[id] += vistas[id];
+        }
+    }
+    for (uint32_t id = 0; id < longitudes.size(); ++id) {
+        if (longitudes[id] > 0) {
+            tabla.asignarLongitud(id, longitudes[id]);
+        }
+    }
+}
+
+ListaPostings intersectar(VistaPostings a, VistaPostings b) {
+    ListaPostings resultado;
+    intersectarOrdenadas(a.begin(), a.size(), b.begin(), b.size(), resultado);
+    return resultado;
+}
+
+ListaPostings unir(VistaPostings a, VistaPostings b) {
+    ListaPostings resultado;
+    unirOrdenadas(a.begin(), a.size(), b.begin(), b.size(), resultado);
+    return resultado;
+}
+
+VistaPostings descomprimirPostings(const PostingsComprimidos& lista, ListaFrecuencias& apoyo) {
+    if (!lista.descomprimir(apoyo.documentos, apoyo.frecuencias)) {
+        return VistaPostings();  // solo con un indice guardado corrupto
+    }
+    VistaPostings vista(apoyo.documentos.data(), apoyo.frecuencias.data(), apoyo.size());
+    vista.inicioPosiciones = lista.inicioPosiciones;
+    vista.posiciones = lista.posiciones;
+    vista.bytesPosiciones = lista.bytesPosiciones;
+    return vista;
+}
+
+VistaPostings juntarPostings(const PostingsPalabra& postings, ListaFrecuencias& apoyo) {
+    if (postings.compactada.empty()) {
+        return postings.agregada;
+    }
+    if (postings.agregada.empty()) {
+        return descomprimirPostings(postings.compactada, apoyo);
+    }
+    ListaFrecuencias compactada;
+    combinarPostings(descomprimirPostings(postings.compactada, compactada), postings.agregada, apoyo);
+    return apoyo;
+}
+
+// Como juntarPostings, pero siempre en una lista propia y sin posiciones
+static void juntarSinPosiciones(const PostingsPalabra& postings, ListaFrecuencias& salida) {
+    if (!postings.compactada.empty() && !postings.compactada.descomprimir(salida.documentos, salida.frecuencias)) {
+        return;  // solo con un indice guardado corrupto
+    }
+    VistaPostings agregada(postings.agregada.datos, postings.agregada.frecuencias, postings.agregada.size());
+    if (salida.empty()) {
+        salida.documentos.assign(agregada.begin(), agregada.end());
+        for (size_t i = 0; i < agregada.size(); ++i) {
+            salida.frecuencias.push_back(agregada.frecuencia(i));
+        }
+    } else if (!agregada.empty()) {
+        ListaFrecuencias combinada;
+        combinarPostings(salida, agregada, combinada);
+        salida = move(combinada);
+    }
+}
+
+// Mezcla dos listas ordenadas sumando las frecuencias de los documentos repetidos; devuelve cuantos escribio
+static size_t mezclarSumando(const uint32_t* documentosA, const uint32_t* frecuenciasA, size_t na, const uint32_t* documentosB,
+                             const uint32_t* frecuenciasB, size_t nb, uint32_t* documentos, uint32_t* frecuencias) {
+    size_t i = 0, j = 0, escritos = 0;
+    while (i < na && j < nb) {
+        uint32_t a = documentosA[i];
+        uint32_t b = documentosB[j];
+        documentos[escritos] = min(a, b);
+        frecuencias[escritos] = (a <= b ? frecuenciasA[i] : 0) + (b <= a ? frecuenciasB[j] : 0);
+        ++escritos;
+        i += a <= b;
+        j += b <= a;
+    }
+    copy(documentosA + i, documentosA + na, documentos + escritos);
+    copy(frecuenciasA + i, frecuenciasA + na, frecuencias + escritos);
+    escritos += na - i;
+    copy(documentosB + j, documentosB + nb, documentos + escritos);
+    copy(frecuenciasB + j, frecuenciasB + nb, frecuencias + escritos);
+    return escritos + nb - j;
+}
+
+VistaPostings juntarExpansion(const ExpansionPalabras& expansion, ListaFrecuencias& apoyo) {
+    // Las listas se decodifican una detras de otra en un solo bufer, que ya se sabe cuanto ocupa
+    vector<uint32_t> documentos, frecuencias;
+    documentos.reserve(expansion.documentos);
+    frecuencias.reserve(expansion.documentos);
+    vector<size_t> cortes = {0};  // la lista i ocupa [cortes[i], cortes[i + 1])
+    uint32_t menor = UINT32_MAX, mayor = 0;
+    ListaFrecuencias lista;
+    for (const PostingsPalabra& postings : expansion.postings) {
+        lista.documentos.clear();
+        lista.frecuencias.clear();
+        juntarSinPosiciones(postings, lista);
+        if (lista.empty()) {
+            continue;
+        }
+        documentos.insert(documentos.end(), lista.documentos.begin(), lista.documentos.end());
+        frecuencias.insert(frecuencias.end(), lista.frecuencias.begin(), lista.frecuencias.end());
+        cortes.push_back(documentos.size());
+        menor = min(menor, lista.documentos.front());
+        mayor = max(mayor, lista.documentos.back());
+    }
+
+    apoyo = ListaFrecuencias();
+    if (cortes.size() <= 2) {
+        apoyo.documentos = move(documentos);
+        apoyo.frecuencias = move(frecuencias);
+        return apoyo;
+    }
+    // Mezclar en rondas copia cada posting una vez por ronda; sumar en un arreglo por documento cuesta lo que
+    // el rango de IDs. Se elige lo que recorra menos.
+    size_t rondas = 0;
+    while ((static_cast<size_t>(1) << rondas) < cortes.size() - 1) {
+        ++rondas;
+    }
+    if (mayor - menor < documentos.size() * rondas) {
+        vector<uint32_t> suma(static_cast<size_t>(mayor - menor) + 1, 0);
+        for (size_t i = 0; i < documentos.size(); ++i) {
+            suma[documentos[i] - menor] += frecuencias[i];
+        }
+        // Sin saltos: se escribe siempre y solo se avanza si el documento esta (la union no pasa de la suma)
+        apoyo.documentos.resize(min(documentos.size(), suma.size()) + 1);
+        apoyo.frecuencias.resize(apoyo.documentos.size());
+        size_t escritos = 0;
+        for (size_t d = 0; d < suma.size(); ++d) {
+            apoyo.documentos[escritos] = menor + static_cast<uint32_t>(d);
+            apoyo.frecuencias[escritos] = suma[d];
+            escritos += suma[d] != 0;
+        }
+        apoyo.documentos.resize(escritos);
+        apoyo.frecuencias.resize(escritos);
+        return apoyo;
+    }
+    // Las rondas mezclan de a pares entre dos bufers, como en unirVarias; la lista que sobra pasa tal cual
+    vector<uint32_t> otrosDocumentos(documentos.size()), otrasFrecuencias(documentos.size());
+    vector<size_t> nuevosCortes;
+    while (cortes.size() > 2) {
+        nuevosCortes.assign(1, 0);
+        for (size_t i = 0; i + 1 < cortes.size(); i += 2) {
+            size_t inicio = nuevosCortes.back();
+            if (i + 2 < cortes.size()) {
+                inicio += mezclarSumando(documentos.data() + cortes[i], frecuencias.data() + cortes[i], cortes[i + 1] - cortes[i],
+                                         documentos.data() + cortes[i + 1], frecuencias.data() + cortes[i + 1], cortes[i + 2] - cortes[i + 1],
+                                         otrosDocumentos.data() + inicio, otrasFrecuencias.data() + inicio);
+            } else {
+                copy(documentos.begin() + cortes[i], documentos.begin() + cortes[i + 1], otrosDocumentos.begin() + inicio);
+                copy(frecuencias.begin() + cortes[i], frecuencias.begin() + cortes[i + 1], otrasFrecuencias.begin() + inicio);
+                inicio += cortes[i + 1] - cortes[i];
+            }
+            nuevosCortes.push_back(inicio);
+        }
+        documentos.swap(otrosDocumentos);
+        frecuencias.swap(otrasFrecuencias);
+        cortes.swap(nuevosCortes);
+    }
+    documentos.resize(cortes.back());
+    frecuencias.resize(cortes.back());
+    apoyo.documentos = move(documentos);
+    apoyo.frecuencias = move(frecuencias);
+    return apoyo;
+}
+
+ListaFrecuencias buscarFrase(const Trie& trie, const string& frase, uint32_t holgura) {
+    // Palabras de la frase con su posicion relativa; las vacias solo avanzan la posicion
+    struct PalabraFrase {
+        uint32_t desplazamiento;
+        ListaFrecuencias apoyo;
+        VistaPostings lista;
+        size_t cursor = 0;  // en 'lista' (documentos)
+        vector<uint32_t> posiciones;  // del documento actual
+        size_t siguiente = 0;  // en 'posiciones'
+    };
+    vector<string> palabras;
+    vector<uint32_t> desplazamientos;
+    Tokenizador tokenizador;
+    uint32_t posicion = 0;
+    tokenizador.tokenizar(frase, [&](string_view palabra) {
+        string texto(palabra);
+        if (!trie.esPalabraVacia(texto)) {
+            palabras.push_back(move(texto));
+            desplazamientos.push_back(posicion);
+        }
+        ++posicion;
+    });
+
+    ListaFrecuencias resultado;
+    if (palabras.empty()) {
+        return resultado;
+    }
+    vector<PalabraFrase> terminos(palabras.size());  // no cambia de tamaño: las vistas pueden apuntar a 'apoyo'
+    for (size_t t = 0; t < terminos.size(); ++t) {
+        terminos[t].desplazamiento = desplazamientos[t] - desplazamientos[0];
+        terminos[t].lista = juntarPostings(trie.buscar(palabras[t]), terminos[t].apoyo);
+        if (terminos[t].lista.empty()) {
+            return resultado;
+        }
+    }
+
+    // La palabra con menos documentos guia la interseccion; las demas avanzan con busqueda binaria
+    vector<size_t> orden(terminos.size());
+    iota(orden.begin(), orden.end(), 0);
+    sort(orden.begin(), orden.end(), [&](size_t a, size_t b) { return terminos[a].lista.size() < terminos[b].lista.size(); });
+    const VistaPostings& guia = terminos[orden[0]].lista;
+    vector<size_t> indices(terminos.size());
+    for (size_t g = 0; g < guia.size(); ++g) {
+        uint32_t documento = guia[g];
+        indices[orden[0]] = g;
+        bool enTodas = true;
+        for (size_t o = 1; o < orden.size() && enTodas; ++o) {
+            PalabraFrase& termino = terminos[orden[o]];
+            termino.cursor = static_cast<size_t>(lower_bound(termino.lista.begin() + termino.cursor, termino.lista.end(), documento) -
+                                                 termino.lista.begin());
+            if (termino.cursor == termino.lista.size()) {
+                return resultado;  // esta palabra ya no tiene documentos mayores
+            }
+            enTodas = termino.lista[termino.cursor] == documento;
+            indices[orden[o]] = termino.cursor;
+        }
+        if (!enTodas) {
+            continue;
+        }
+        if (!trie.tienePosiciones()) {
+            resultado.agregar(documento, 1);
+            continue;
+        }
+
+        // Solo en los documentos comunes se decodifican las posiciones
+        bool legibles = true;
+        for (size_t t = 0; t < terminos.size() && legibles; ++t) {
+            legibles = terminos[t].lista.leerPosiciones(indices[t], terminos[t].posiciones);
+        }
+        if (!legibles) {
+            continue;
+        }
+        // Mezcla lineal: el inicio de la frase solo avanza, asi que el cursor de cada palabra tampoco retrocede
+        uint32_t apariciones = 0;
+        for (PalabraFrase& termino : terminos) {
+            termino.siguiente = 0;
+        }
+        for (uint32_t inicio : terminos[0].posiciones) {
+            bool coincide = true;
+            for (size_t t = 1; t < terminos.size() && coincide; ++t) {
+                PalabraFrase& termino = terminos[t];
+                uint64_t minimo = static_cast<uint64_t>(inicio) + termino.desplazamiento;
+                while (termino.siguiente < termino.posiciones.size() && termino.posiciones[termino.siguiente] < minimo) {
+                    ++termino.siguiente;
+                }
+                coincide = termino.siguiente < termino.posiciones.size() && termino.posiciones[termino.siguiente] <= minimo + holgura;
+            }
+            if (coincide) {
+                ++apariciones;
+            }
+        }
+        if (apariciones > 0) {
+            resultado.agregar(documento, apariciones);
+        }
     }
+    return resultado;
 }
 
-void crearIndiceInvertido(const vector<string>& nombresArchivos, Trie& trie, unordered_set<string>& stopWords) {
-    unordered_map<string, string> archivosRecolectados = recolectarArchivos(nombresArchivos);
+ListaPostings procesarEntrada(const Trie& trie, const TablaDocumentos& documentos, const string& entrada) {
+    NodoConsulta consulta;
+    string error;
+    if (!analizarConsulta(entrada, consulta, error)) {
+        cerr << "Consulta invalida (" << error << "): " << entrada << endl;
+        return ListaPostings();
+    }
+    NodoPlan plan = planificarConsulta(trie, documentos, consulta);
+    return ejecutarPlan(plan, trie, documentos);
+}
+
+// Contribucion BM25 de una palabra en un documento
+static double puntajeBM25(uint32_t frecuencia, uint32_t longitud, double idf, double longitudPromedio, const ParametrosBM25& parametros) {
+    double tf = frecuencia;
+    double normalizacion = 1.0 - parametros.b + parametros.b * (longitudPromedio > 0 ? longitud / longitudPromedio : 1.0);
+    return idf * tf * (parametros.k1 + 1.0) / (tf + parametros.k1 * normalizacion);
+}
+
+vector<ResultadoBusqueda> buscarRanking(const Trie& trie, const TablaDocumentos& documentos, const string& entrada,
+                                        size_t k, const ParametrosBM25& parametros) {
+    NodoConsulta consulta;
+    string error;
+    if (!analizarConsulta(entrada, consulta, error)) {
+        cerr << "Consulta invalida (" << error << "): " << entrada << endl;
+        return vector<ResultadoBusqueda>();
+    }
+    return buscarRanking(trie, documentos, consulta, k, parametros);
+}
 
-    unordered_map<string, vector<string>> archivosProcesados;
-    for (auto& [nombre, texto] : archivosRecolectados) {
-        texto = eliminarSignos(texto);
-        vector<string> listaPalabras = tokenizarTexto(texto);
-        vector<string> palabrasFiltradas = eliminarStopWords(listaPalabras, stopWords);
-        archivosProcesados[nombre] = palabrasFiltradas;
+vector<ResultadoBusqueda> buscarRanking(const Trie& trie, const TablaDocumentos& documentos, const NodoConsulta& consulta,
+                                        size_t k, const ParametrosBM25& parametros) {
+    NodoPlan plan = planificarConsulta(trie, documentos, consulta);
+    ListaPostings coincidencias = ejecutarPlan(plan, trie, documentos);
+    if (coincidencias.empty() || k == 0) {
+        return vector<ResultadoBusqueda>();  // las hojas que el plan no evaluo ya no se leen
     }
 
-    vector<PalabraArchivo> datosMapeados = mapearArchivos(archivosProcesados);
+    // Cada palabra o frase que no esta negada suma su puntaje; una frase cuenta como una palabra cuya
+    // frecuencia es el numero de veces que aparece. Las palabras que el plan no decodifico no se decodifican
+    // aqui: se busca cada documento que cumple la consulta en la parte comprimida (leyendo solo sus bloques)
+    // y en el delta, y su numero de documentos sale de los tamaños. Un prefijo, una busqueda difusa o una
+    // frase necesita su lista entera para saber en cuantos documentos aparece.
+    struct Aporte {
+        VistaPostings lista;  // la lista evaluada o el delta de una palabra sin decodificar
+        double idf;
+        const uint32_t* cursor;
+        bool comprimida;
+        LectorPostings lector;
+    };
+    vector<NodoPlan*> hojas;
+    hojasPositivas(plan, hojas);
+    vector<Aporte> aportes;
+    aportes.reserve(hojas.size());
+    double total = static_cast<double>(documentos.vigentes());
+    double promedio = documentos.longitudPromedio();
+    for (NodoPlan* hoja : hojas) {
+        bool comprimida = hoja->tipo == NODO_PALABRA && !hoja->evaluada;
+        const VistaPostings& lista = comprimida ? hoja->postings.agregada : listaHoja(*hoja, trie);
+        double df = static_cast<double>(comprimida ? hoja->postings.size() : lista.size());
+        aportes.push_back({lista, log(1.0 + (total - df + 0.5) / (df + 0.5)), lista.begin(), comprimida,
+                           comprimida ? LectorPostings(hoja->postings.compactada) : LectorPostings()});
+    }
 
-    unordered_map<string, vector<string>> datosAgrupados = shuffle(datosMapeados);
+    // Monticulo de minimos con los k mejores: la raiz es el peor de ellos y es el que se reemplaza
+    auto peor = [](const ResultadoBusqueda& a, const ResultadoBusqueda& b) {
+        return a.puntaje != b.puntaje ? a.puntaje > b.puntaje : a.documento < b.documento;
+    };
+    priority_queue<ResultadoBusqueda, vector<ResultadoBusqueda>, decltype(peor)> mejores(peor);
+    auto ofrecer = [&](uint32_t documento, double puntaje) {
+        if (mejores.size() < k) {
+            mejores.push({documento, puntaje});
+        } else if (peor({documento, puntaje}, mejores.top())) {
+            mejores.pop();
+            mejores.push({documento, puntaje});
+        }
+    };
 
-    reducirDatos(datosAgrupados, trie);
+    // Los documentos salen en orden: el cursor de cada lista solo avanza
+    for (uint32_t documento : coincidencias) {
+        double puntaje = 0.0;
+        for (Aporte& aporte : aportes) {
+            if (aporte.comprimida && aporte.lector.avanzarHasta(documento) && aporte.lector.documento() == documento) {
+                puntaje += puntajeBM25(aporte.lector.frecuencia(), documentos.obtener(documento).longitud, aporte.idf, promedio,
+                                       parametros);
+                continue;
+            }
+            aporte.cursor = lower_bound(aporte.cursor, aporte.lista.end(), documento);
+            if (aporte.cursor != aporte.lista.end() && *aporte.cursor == documento) {
+                size_t i = static_cast<size_t>(aporte.cursor - aporte.lista.begin());
+                puntaje += puntajeBM25(aporte.lista.frecuencia(i), documentos.obtener(documento).longitud, aporte.idf, promedio, parametros);
+            }
+        }
+        ofrecer(documento, puntaje);
+    }
+
+    vector<ResultadoBusqueda> resultados(mejores.size());
+    for (size_t r = resultados.size(); r > 0; --r) {
+        resultados[r - 1] = mejores.top();
+        mejores.pop();
+    }
+    return resultados;
+}
+
+void crearIndiceInvertido(const vector<string>& nombresArchivos, Trie& trie, TablaDocumentos& documentos, unordered_set<string>& stopWords,
+                          const OpcionesIndexado& opciones) {
+    vector<uint32_t> idsDocumentos;
+    for (const string& nombre : nombresArchivos) {
+        idsDocumentos.push_back(documentos.agregar(nombre));
+    }
+
+    stopWords = normalizarPalabras(stopWords);
+    unordered_set<string_view> vistaStop = vistaStopWords(stopWords);
+    PoolHilos pool(opciones.hilos);
+    auto inicio = chrono::steady_clock::now();
+    vector<Invertidor> parciales = mapearDocumentos(idsDocumentos, documentos, vistaStop, opciones, pool);
+    registrarLongitudes(parciales, documentos);
+    auto finMapeo = chrono::steady_clock::now();
+    trie.configurar(opciones.posiciones, stopWords);
+    reducirDatos(parciales, trie, pool);
+
+    if (MetricasIndexado* metricas = opciones.metricas) {
+        metricas->construido = true;
+        metricas->archivos = idsDocumentos.size();
+        metricas->bytesLeidos = 0;
+        uint64_t indexadas = 0;
+        for (uint32_t id : idsDocumentos) {
+            metricas->bytesLeidos += documentos.obtener(id).bytes;
+            indexadas += documentos.obtener(id).longitud;
+        }
+        metricas->palabrasVacias = metricas->palabras - min(metricas->palabras, indexadas);
+        metricas->segundosMapeo = chrono::duration<double>(finMapeo - inicio).count();
+        metricas->segundosReduccion = chrono::duration<double>(chrono::steady_clock::now() - finMapeo).count();
+    }
+}
+
+// Indexa un archivo ya abierto con un ID nuevo; desde aqui nada puede fallar
+static uint32_t indexarArchivo(const string& ruta, const ArchivoMapeado& archivo, Trie& trie, TablaDocumentos& documentos,
+                               const unordered_set<string>& stopWords) {
+    uint32_t documento = documentos.agregar(ruta);
+
+    // Se agrupan las palabras del documento y cada palabra distinta entra una sola vez al delta del trie
+    Tokenizador tokenizador;
+    Invertidor invertidor;
+    procesarDocumento(archivo.contenido(), documento, vistaStopWords(stopWords), tokenizador, invertidor, trie.tienePosiciones());
+    invertidor.recorrer([&](const string& palabra, const ListaFrecuencias& lista) {
+        trie.insertarLista(palabra, lista);
+    });
+    documentos.asignarLongitud(documento, invertidor.longitudesDocumentos().empty() ? 0 : invertidor.longitudesDocumentos()[documento]);
+    return documento;
+}
+
+bool borrarDocumento(const string& ruta, TablaDocumentos& documentos) {
+    uint32_t documento = documentos.buscarRuta(ruta);
+    if (documento == DOCUMENTO_INVALIDO) {
+        cerr << "El documento no esta en el indice: " << ruta << endl;
+        return false;
+    }
+    return documentos.borrar(documento);
+}
+
+uint32_t agregarDocumento(const string& ruta, Trie& trie, TablaDocumentos& documentos, const unordered_set<string>& stopWords) {
+    if (documentos.buscarRuta(ruta) != DOCUMENTO_INVALIDO) {
+        cerr << "El documento ya esta en el indice: " << ruta << endl;
+        return DOCUMENTO_INVALIDO;
+    }
+    ArchivoMapeado archivo;
+    if (!archivo.abrir(ruta)) {
+        cerr << "Error al abrir el archivo: " << ruta << endl;
+        return DOCUMENTO_INVALIDO;
+    }
+    return indexarArchivo(ruta, archivo, trie, documentos, stopWords);
+}
+
+uint32_t reemplazarDocumento(const string& ruta, Trie& trie, TablaDocumentos& documentos, const unordered_set<string>& stopWords) {
+    // El archivo se abre antes de borrar la version anterior: si no se puede, el indice queda como estaba
+    ArchivoMapeado archivo;
+    if (!archivo.abrir(ruta)) {
+        cerr << "Error al abrir el archivo: " << ruta << endl;
+        return DOCUMENTO_INVALIDO;
+    }
+    uint32_t anterior = documentos.buscarRuta(ruta);
+    if (anterior != DOCUMENTO_INVALIDO) {
+        documentos.borrar(anterior);
+    }
+    return indexarArchivo(ruta, archivo, trie, documentos, stopWords);
+}
+
+void compactarIndice(Trie& trie, const TablaDocumentos& documentos) {
+    trie.compactar(documentos);
+}
+
+bool esComandoAdministracion(const string& entrada) {
+    istringstream stream(entrada);
+    string prefijo;
+    stream >> prefijo;
+    return prefijo == "ADMIN";
+}
+
+// Un nombre de archivo dentro de la carpeta: sin rutas absolutas, sin subir con ".." y sin separadores (la
+// carpeta de textos es plana), para que un cliente no pueda indexar ni borrar archivos de fuera
+static bool nombreEnCarpeta(const string& archivo) {
+    return archivo != "." && archivo != ".." && archivo.find_first_of(string("/\\:\0", 4)) == string::npos;
+}
+
+ComandoAdministracion ejecutarComandoAdministracion(const string& entrada, const string& carpeta, Trie& trie, TablaDocumentos& documentos,
+                                                    const unordered_set<string>& stopWords, string& respuesta) {
+    istringstream stream(entrada);
+    string prefijo, comando, archivo;
+    stream >> prefijo >> comando;
+    if (prefijo != "ADMIN") {
+        return NO_ES_COMANDO;
+    }
+    getline(stream >> ws, archivo);  // el nombre del archivo puede tener espacios
+    while (!archivo.empty() && (archivo.back() == '\r' || archivo.back() == ' ')) {
+        archivo.pop_back();
+    }
+    string ruta = carpeta + "/" + archivo;
+
+    if (comando == "COMPACTAR") {
+        size_t borrados = documentos.borrados();
+        size_t palabras = trie.palabrasAgregadas();
+        compactarIndice(trie, documentos);
+        respuesta = "Indice compactado (" + to_string(palabras) + " palabras en el delta, " + to_string(borrados) + " documentos borrados).";
+        return COMANDO_COMPACTAR;
+    }
+    if (archivo.empty()) {
+        respuesta = "Uso: ADMIN AGREGAR|BORRAR|REEMPLAZAR <archivo> o ADMIN COMPACTAR";
+        return COMANDO_FALLIDO;
+    }
+    if (!nombreEnCarpeta(archivo)) {
+        respuesta = "El archivo debe estar en la carpeta de textos: " + archivo;
+        return COMANDO_FALLIDO;
+    }
+    if (comando == "AGREGAR" || comando == "REEMPLAZAR") {
+        uint32_t id = comando == "AGREGAR" ? agregarDocumento(ruta, trie, documentos, stopWords)
+                                           : reemplazarDocumento(ruta, trie, documentos, stopWords);
+        if (id == DOCUMENTO_INVALIDO) {
+            respuesta = "No se pudo indexar " + archivo + ".";
+            return COMANDO_FALLIDO;
+        }
+        respuesta = "Documento " + archivo + " indexado con ID " + to_string(id) + ".";
+        return comando == "AGREGAR" ? COMANDO_AGREGAR : COMANDO_REEMPLAZAR;
+    }
+    if (comando == "BORRAR") {
+        if (!borrarDocumento(ruta, documentos)) {
+            respuesta = "El documento " + archivo + " no esta en el indice.";
+            return COMANDO_FALLIDO;
+        }
+        respuesta = "Documento " + archivo + " borrado.";
+        return COMANDO_BORRAR;
+    }
+    respuesta = "Comando desconocido: " + comando;
+    return COMANDO_FALLIDO;
 }
@@ -6,58 +6,423 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <fstream>
+#include <cstdint>
+#include <string_view>
+#include <deque>
+#include <array>
+#include <memory>
+#include <functional>
+#include "DobleArreglo.h"
+#include "Tokenizador.h"
+#include "ArchivoMapeado.h"
+#include "PoolHilos.h"
+#include "PostingsComprimidos.h"
+#include "Compartido.h"
 
 using namespace std;
 
-// Nodo del Trie
-struct Node {
-    unordered_map<char, Node*> children;
-    unordered_set<string> nombresArchivos;
+// IDs de documento ordenados de menor a mayor y sin repetir
+using ListaPostings = vector<uint32_t>;
+
+// Postings con la frecuencia de la palabra en cada documento (arreglos paralelos)
+struct ListaFrecuencias {
+    ListaPostings documentos;
+    vector<uint32_t> frecuencias;
+    // Solo en indices con posiciones: las del documento i ocupan posiciones[inicioPosiciones[i], inicioPosiciones[i + 1]),
+    // en orden creciente y codificadas como diferencias en varint (la primera es la posicion absoluta)
+    vector<uint32_t> inicioPosiciones;
+    vector<uint8_t> posiciones;
+    uint32_t ultimaPosicion = 0;  // ultima posicion agregada, para codificar la diferencia de la siguiente
+
+    // Suma 'frecuencia' apariciones en el documento; casi siempre llega el mayor ID y se agrega al final
+    void agregar(uint32_t documento, uint32_t frecuencia = 1);
+    // Suma una aparicion con su posicion. Las de un documento llegan seguidas y en orden creciente,
+    // pero los documentos pueden llegar en desorden: ordenar() los acomoda al final
+    void agregarPosicion(uint32_t documento, uint32_t posicion);
+    void ordenar();
+    size_t size() const { return documentos.size(); }
+    bool empty() const { return documentos.empty(); }
+    bool tienePosiciones() const { return inicioPosiciones.size() == documentos.size() + 1; }
+};
+
+const uint32_t SIN_POSICION = UINT32_MAX;
+
+// Vista de solo lectura de una lista de postings (no copia los IDs)
+// Sin arreglo de frecuencias (una ListaPostings) se considera una aparicion por documento.
+struct VistaPostings {
+    const uint32_t* datos = nullptr;
+    const uint32_t* frecuencias = nullptr;
+    size_t n = 0;
+
+    VistaPostings() = default;
+    VistaPostings(const uint32_t* ids, const uint32_t* frecs, size_t cantidad) : datos(ids), frecuencias(frecs), n(cantidad) {}
+    VistaPostings(const ListaPostings& lista) : datos(lista.data()), n(lista.size()) {}
+    VistaPostings(const ListaFrecuencias& lista) : datos(lista.documentos.data()), frecuencias(lista.frecuencias.data()), n(lista.size()) {
+        if (lista.tienePosiciones()) {
+            inicioPosiciones = lista.inicioPosiciones.data();
+            posiciones = lista.posiciones.data();
+            bytesPosiciones = lista.posiciones.size();
+        }
+    }
+
+    const uint32_t* begin() const { return datos; }
+    const uint32_t* end() const { return datos + n; }
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    uint32_t operator[](size_t i) const { return datos[i]; }
+    uint32_t frecuencia(size_t i) const { return frecuencias ? frecuencias[i] : 1; }
+
+    // Posiciones (como en ListaFrecuencias): n + 1 inicios que apuntan a un arreglo de 'bytesPosiciones' bytes
+    const uint32_t* inicioPosiciones = nullptr;
+    const uint8_t* posiciones = nullptr;
+    size_t bytesPosiciones = 0;
+    bool tienePosiciones() const { return inicioPosiciones != nullptr; }
+    // Decodifica las posiciones del documento i; devuelve false si no hay posiciones o estan dañadas
+    bool leerPosiciones(size_t i, vector<uint32_t>& salida) const;
+};
+
+class TablaDocumentos;
+
+// Mezcla dos listas ordenadas al final de 'salida'; si un documento esta en las dos se suman sus frecuencias
+// (y se juntan sus posiciones). Con 'filtro' se omiten los documentos borrados.
+void combinarPostings(VistaPostings a, VistaPostings b, ListaFrecuencias& salida, const TablaDocumentos* filtro = nullptr);
+
+// Documentos de una palabra en el trie: la parte compactada (comprimida) y la agregada despues de compactar
+// (documentos nuevos, con IDs mayores). Puede incluir documentos borrados que aun no se compactan.
+struct PostingsPalabra {
+    PostingsComprimidos compactada;
+    VistaPostings agregada;
+
+    size_t size() const { return compactada.size() + agregada.size(); }
+    bool empty() const { return compactada.empty() && agregada.empty(); }
+};
+
+// Palabras del trie que salen de un prefijo o de una busqueda difusa, cada una con sus postings sin juntar
+struct ExpansionPalabras {
+    vector<PostingsPalabra> postings;
+    vector<string> palabras;      // solo en la busqueda difusa (el prefijo no necesita armar las palabras)
+    vector<uint32_t> distancias;  // de edicion, de cada palabra a la buscada (busqueda difusa)
+    size_t documentos = 0;   // suma de los tamaños de las listas: la union tiene a lo mas estos documentos
+    size_t descartadas = 0;  // palabras que quedaron fuera por el limite
 };
 
+// Un prefijo o una busqueda difusa se expande a lo mas a estas palabras; "a*" no deberia leer medio indice
+const size_t MAXIMO_PALABRAS_EXPANDIDAS = 256;
+
+// Distancia de edicion mas grande que acepta una busqueda difusa
+const uint32_t DISTANCIA_MAXIMA_DIFUSA = 2;
+
+// Datos de un documento indexado
+struct Documento {
+    string ruta;    // ruta con la que se abre el archivo
+    string nombre;  // nombre del archivo, sin carpetas
+    uint64_t bytes; // tamaño del archivo
+    int64_t modificado; // ultima modificacion al indexar (para saber si un indice guardado sigue vigente)
+    bool borrado = false; // lapida: el ID no se reutiliza y sus postings se descartan al compactar
+    uint32_t longitud = 0; // palabras indexadas del documento (sin las vacias), para BM25
+};
+
+const uint32_t DOCUMENTO_INVALIDO = UINT32_MAX;
+
+// Tabla de documentos: el ID de un documento es su posicion en la tabla
+// Las copias comparten los documentos y las rutas (Compartido.h): agregar o borrar un documento en una copia
+// cuesta lo mismo con cien que con un millon de documentos.
+class TablaDocumentos {
+private:
+    VectorCompartido<Documento> documentos;
+    MapaCompartido<uint32_t> porRuta;  // ruta -> ID del documento vigente con esa ruta
+    size_t numeroBorrados = 0;
+    uint64_t longitudVigentes = 0;  // suma de las longitudes de los documentos no borrados
+    uint64_t numeroGeneracion;
+
+public:
+    TablaDocumentos();
+    uint32_t agregar(const string& ruta);  // Registra el documento y devuelve su ID
+    uint32_t agregar(const Documento& documento);  // Registra un documento ya descrito (al cargar un indice)
+    bool borrar(uint32_t id);  // Marca el documento como borrado; devuelve false si ya lo estaba
+    const Documento& obtener(uint32_t id) const { return documentos[id]; }
+    bool vigente(uint32_t id) const { return !documentos[id].borrado; }
+    uint32_t buscarRuta(const string& ruta) const;  // ID vigente con esa ruta o DOCUMENTO_INVALIDO
+    void quitarBorrados(ListaPostings& lista) const;  // Elimina de la lista los documentos borrados (y los IDs que no existen)
+    void asignarLongitud(uint32_t id, uint32_t longitud);
+    size_t size() const { return documentos.size(); }
+    size_t borrados() const { return numeroBorrados; }
+    size_t vigentes() const { return documentos.size() - numeroBorrados; }
+    double longitudPromedio() const;  // Longitud media de los documentos vigentes
+    // Cambia con cada documento agregado o borrado. Los numeros salen de un contador del proceso que solo
+    // crece, asi que una tabla nueva (un indice recargado) tampoco repite el de la que reemplaza.
+    uint64_t generacion() const { return numeroGeneracion; }
+};
+
+class Invertidor;
+class Trie;
+
+bool guardarIndice(const string& ruta, const Trie& trie, const TablaDocumentos& documentos, const unordered_set<string>& stopWords);
+bool cargarIndice(const string& ruta, const vector<string>& nombresArchivos, const unordered_set<string>& stopWords,
+                  Trie& trie, TablaDocumentos& documentos);
+
 // Clase Trie
+// La raiz compartida tiene una rama por cada primer byte de la palabra y cada rama es un subtrie de
+// doble arreglo con el resto de la palabra. Las ramas no comparten datos, asi que se construyen en
+// paralelo sin bloqueos. Cada rama compactada es un bloque de arreglos planos, por lo que se puede
+// guardar y mapear tal cual (ArchivoIndice.h).
+// Los documentos insertados despues de construir van a un delta por palabra (solo los IDs nuevos) que
+// se consulta junto con la parte compactada; construir o compactar los funde en los arreglos planos.
 class Trie {
 private:
-    Node* root;
+    struct Particion {
+        DobleArreglo diccionario;    // resto de la palabra -> numero de termino (orden lexicografico)
+        Arreglo<uint32_t> inicios;   // los postings del termino i son los numeros [inicios[i], inicios[i + 1])
+        Arreglo<uint32_t> iniciosBytes;  // y su lista comprimida ocupa postings[iniciosBytes[i], iniciosBytes[i + 1])
+        Arreglo<uint8_t> postings;   // listas comprimidas con sus frecuencias (PostingsComprimidos.h)
+        Arreglo<uint32_t> inicioPosiciones;  // con posiciones: un inicio en 'posiciones' por numero de posting, mas uno
+        Arreglo<uint8_t> posiciones;
+        MapaCompartido<ListaFrecuencias> agregados;  // delta: documentos insertados despues de compactar
+
+        ListaFrecuencias& lista(string_view resto) { return agregados.modificar(resto); }
+        void agregarLista(string_view resto, const ListaFrecuencias& nuevos);
+        PostingsComprimidos compactada(string_view resto) const;
+        PostingsComprimidos compactada(uint32_t termino) const;
+        PostingsPalabra buscar(string_view resto) const;
+        ExpansionPalabras expandir(string_view resto, size_t maximo) const;
+        // Agrega a 'expansion' las palabras de la rama que acepta el automata ('fila': tras leer la inicial)
+        void parecidas(char inicial, const AutomataLevenshtein& automata, const uint8_t* fila, ExpansionPalabras& expansion) const;
+        // Funde el delta en los arreglos planos; con 'tabla' tambien descarta los documentos borrados
+        void construir(const TablaDocumentos* tabla = nullptr);
+        // Funde las listas de 'nuevas' (resto -> lista) con la parte compactada; 'nuevas' queda ordenada
+        void fundir(vector<pair<string_view, const ListaFrecuencias*>>& nuevas, const TablaDocumentos* tabla);
+    };
+    array<Particion, 256> particiones;
+    shared_ptr<ArchivoMapeado> mapeo;  // indice cargado de disco al que apuntan las particiones
+    bool conPosiciones = false;
+    shared_ptr<const unordered_set<string>> palabrasVacias;  // las que se saltan al indexar; las frases dejan su hueco
+    uint64_t numeroGeneracion;  // como en TablaDocumentos
+
+    friend bool guardarIndice(const string& ruta, const Trie& trie, const TablaDocumentos& documentos, const unordered_set<string>& stopWords);
+    friend bool cargarIndice(const string& ruta, const vector<string>& nombresArchivos, const unordered_set<string>& stopWords,
+                             Trie& trie, TablaDocumentos& documentos);
 
 public:
     Trie();
-    void insertar(const string& palabra, const string& nombreArchivo);
-    unordered_set<string> buscar(const string& palabra) const;
+    void insertar(const string& palabra, uint32_t documento, uint32_t frecuencia = 1);
+    void insertarLista(const string& palabra, const ListaFrecuencias& lista);  // Junta la lista (con sus posiciones) al delta
+    PostingsPalabra buscar(const string& palabra) const;
+    // Palabras que empiezan con 'prefijo' (de al menos una letra). Las del doble arreglo estan numeradas en orden
+    // lexicografico, asi que las del prefijo son un rango de numeros de termino y sus tamaños salen de 'inicios'
+    // sin recorrer el subarbol; solo se revisa el delta. Si pasan de 'maximo' se quedan las de mas documentos.
+    ExpansionPalabras expandirPrefijo(const string& prefijo, size_t maximo = MAXIMO_PALABRAS_EXPANDIDAS) const;
+    // Palabras a distancia de edicion (Levenshtein, contando bytes) de a lo mas 'distancia' de 'palabra', con esa
+    // distancia: de la mas cercana a la mas lejana y, a igual distancia, de la de mas documentos a la de menos.
+    // La primera letra del automata elige las ramas que siguen vivas y cada rama se recorre solo por donde el
+    // automata puede aceptar, sin revisar el vocabulario entero. Se quedan las primeras 'maximo'.
+    ExpansionPalabras buscarParecidas(const string& palabra, uint32_t distancia, size_t maximo = MAXIMO_PALABRAS_EXPANDIDAS) const;
+    void construir();  // Funde el delta en el doble arreglo y los arreglos planos
+    void compactar(const TablaDocumentos& tabla);  // Como construir, y ademas descarta los documentos borrados
+    size_t palabrasAgregadas() const;  // Tamaño del delta (palabras con documentos sin compactar)
+    // Junta las palabras de los invertidores que empiezan con 'inicial' y construye esa rama
+    // (se puede llamar en paralelo para iniciales distintas)
+    void reducirParticion(unsigned char inicial, const vector<Invertidor>& parciales);
+    size_t bytesDiccionario() const;
+    size_t bytesPostings() const;  // Listas comprimidas, sus inicios y las posiciones
+    size_t bytesPosiciones() const;
+    size_t terminos() const;  // Palabras de la parte compactada (las del delta se cuentan en palabrasAgregadas)
+    uint64_t numeroPostings() const;  // Pares palabra-documento, compactados y en el delta
+    size_t estados() const;  // Estados (nodos) de los doble arreglos
+
+    // Opciones con que se indexo: si se guardan posiciones y que palabras vacias se saltaron
+    void configurar(bool posiciones, const unordered_set<string>& stopWords);
+    bool tienePosiciones() const { return conPosiciones; }
+    bool esPalabraVacia(const string& palabra) const { return palabrasVacias && palabrasVacias->count(palabra) > 0; }
+
+    // Cambia con cada insercion, construccion o compactacion (compactar cambia el puntaje: las listas dejan de
+    // contar los documentos borrados). reducirParticion no la cambia, porque se llama en paralelo: lo hace
+    // reducirDatos al terminar.
+    uint64_t generacion() const { return numeroGeneracion; }
+    void marcarCambio();  // Le da una generacion nueva (despues de cambiar el trie sin sus metodos)
 };
 
+// Numero que cambia cada vez que cambia el indice (el trie o la tabla) y nunca vuelve a un valor anterior:
+// un resultado calculado con una generacion sigue valido mientras el indice tenga la misma
+uint64_t generacionIndice(const Trie& trie, const TablaDocumentos& documentos);
+
+
+// Función para recolectar un archivo de texto: deja en 'archivo' la vista de su contenido
+bool recolectarArchivo(uint32_t documento, const TablaDocumentos& tabla, ArchivoMapeado& archivo, ModoLectura modo);
 
-// Función para recolectar los archivos de texto
-unordered_map<string, string> recolectarArchivos(const vector<string>& nombresArchivos);
+// Conjunto de palabras vacias que se consulta con string_view (las vistas apuntan al conjunto original)
+unordered_set<string_view> vistaStopWords(const unordered_set<string>& stopWords);
 
-// Función para eliminar signos de puntuación y saltos de linea
-string eliminarSignos(const string& texto);
+// Invertidor: agrupa cada palabra con los documentos donde aparece y cuantas veces (combinador de frecuencias)
+// Las palabras llegan como string_view; solo se copia una vez cada palabra distinta.
+class Invertidor {
+private:
+    unordered_map<string_view, uint32_t> terminos;  // palabra -> posicion en 'listas'
+    deque<string> palabras;  // copia estable de cada palabra distinta (las claves apuntan aqui)
+    vector<ListaFrecuencias> listas;
+    array<vector<uint32_t>, 256> porInicial;  // posiciones de las palabras agrupadas por su primer byte
+    vector<uint32_t> longitudes;  // palabras vistas de cada documento (por ID)
 
-// Función para tokenizar un texto
-vector<string> tokenizarTexto(const string& texto);
+public:
+    Invertidor() = default;
+    Invertidor(Invertidor&&) = default;  // mover no cambia de lugar las palabras del deque, las claves siguen validas
+    Invertidor(const Invertidor&) = delete;
+    Invertidor& operator=(const Invertidor&) = delete;
 
-// Función para eliminar palabras que no brindan información
-vector<string> eliminarStopWords(const vector<string>& listaPalabras, const unordered_set<string>& stopWords);
+    void agregar(string_view palabra, uint32_t documento, uint32_t posicion = SIN_POSICION);
+    void ordenarListas();  // Ordena por documento las listas con posiciones (ver ListaFrecuencias::agregarPosicion)
+    size_t size() const { return listas.size(); }
+    const string& palabra(uint32_t termino) const { return palabras[termino]; }
+    const ListaFrecuencias& lista(uint32_t termino) const { return listas[termino]; }
+    const vector<uint32_t>& terminosConInicial(unsigned char inicial) const { return porInicial[inicial]; }
+    const vector<uint32_t>& longitudesDocumentos() const { return longitudes; }
 
-// Estructura auxiliar para almacenar la palabra y el nombre del archivo
-struct PalabraArchivo {
-    string palabra;
-    string nombreArchivo;
+    template <typename Visitar>
+    void recorrer(Visitar&& visitar) const {
+        for (size_t i = 0; i < listas.size(); ++i) {
+            visitar(palabras[i], listas[i]);
+        }
+    }
 };
 
-// Función para mapear los archivos procesados
-vector<PalabraArchivo> mapearArchivos(const unordered_map<string, vector<string>>& archivosProcesados);
+// Tokeniza el texto de un documento y envia sus palabras (sin las vacias) al invertidor, en una sola pasada.
+// Con posiciones el texto debe ser el documento entero: la posicion es el numero de palabra, contando las vacias.
+// Devuelve cuantas palabras tenia el texto (con las vacias).
+size_t procesarDocumento(string_view texto, uint32_t documento, const unordered_set<string_view>& stopWords,
+                       Tokenizador& tokenizador, Invertidor& invertidor, bool conPosiciones = false);
+
+// Avance de la construccion del indice, para mostrarlo mientras se construye
+struct ProgresoIndexado {
+    size_t archivosTerminados = 0;
+    size_t archivosTotales = 0;
+    uint64_t bytesLeidos = 0;   // de los archivos terminados
+    uint64_t bytesTotales = 0;  // de todos los archivos (para estimar cuanto falta)
+    uint64_t palabras = 0;      // tokenizadas hasta ahora, con las vacias
+    double segundos = 0;        // desde que empezo la lectura
+};
+
+// Lo que midio una construccion completa del indice, por etapa (sin costo por palabra: sale de los contadores
+// que la construccion ya lleva)
+struct MetricasIndexado {
+    bool construido = false;      // false si el indice se cargo de disco sin construirlo
+    size_t archivos = 0;
+    uint64_t bytesLeidos = 0;
+    uint64_t palabras = 0;        // tokens de los textos, con las vacias
+    uint64_t palabrasVacias = 0;  // tokens descartados por ser palabras vacias
+    double segundosMapeo = 0;     // leer, tokenizar y agrupar (mapearDocumentos)
+    double segundosReduccion = 0; // juntar las listas y construir el trie (reducirDatos)
+};
+
+// Opciones de construccion del indice
+struct OpcionesIndexado {
+    ModoLectura modo = LECTURA_MAPEADA;
+    size_t hilos = 0;                     // hilos del pool (0: uno por nucleo)
+    size_t tamanoFragmento = 256 * 1024;  // los archivos mas grandes se reparten en fragmentos de este tamaño
+    bool posiciones = false;  // guarda la posicion de cada palabra para buscar frases; cada documento se tokeniza
+                              // entero en un hilo, porque la posicion inicial de un fragmento no se conoce de antemano
+    // Si se indica, se llama cada vez que termina de tokenizarse un archivo. La llaman los hilos del pool, de a
+    // uno a la vez; despues del ultimo archivo falta juntar las listas en el trie.
+    function<void(const ProgresoIndexado&)> progreso;
+    MetricasIndexado* metricas = nullptr;  // si se indica, crearIndiceInvertido deja aqui lo que midio
+};
+
+// Fase de mapeo en paralelo: cada documento se lee y se divide en fragmentos que los hilos del pool
+// tokenizan por separado. Devuelve un invertidor por hilo (cada hilo solo escribe en el suyo).
+vector<Invertidor> mapearDocumentos(const vector<uint32_t>& documentos, const TablaDocumentos& tabla,
+                                    const unordered_set<string_view>& stopWords, const OpcionesIndexado& opciones, PoolHilos& pool);
+
+// Reducir combinando listas de documentos para cada palabra usando un Trie
+// Cada rama del trie (primer byte de la palabra) se reduce y se construye en una tarea del pool.
+void reducirDatos(const vector<Invertidor>& parciales, Trie& trie, PoolHilos& pool);
+
+// Suma las longitudes que vio cada invertidor y las guarda en la tabla (un documento puede estar repartido en fragmentos)
+void registrarLongitudes(const vector<Invertidor>& parciales, TablaDocumentos& tabla);
 
-// Organización de los datos intermedios
-unordered_map<string, vector<string>> shuffle(const vector<PalabraArchivo>& datosMapeados);
+// Interseccion y union de listas ordenadas (mezcla lineal)
+ListaPostings intersectar(VistaPostings a, VistaPostings b);
+ListaPostings unir(VistaPostings a, VistaPostings b);
 
-// Reducir combinando listas de nombre de los archivos para cada palabra usando un Trie
-void reducirDatos(const unordered_map<string, vector<string>>& datosAgrupados, Trie& trie);
+// Decodifica una lista comprimida en 'apoyo'; la vista conserva las posiciones de la lista
+VistaPostings descomprimirPostings(const PostingsComprimidos& lista, ListaFrecuencias& apoyo);
 
-// Procesar entrada
-unordered_set<string> procesarEntrada(const Trie& trie, const string& entrada);
+// Lista contigua de los documentos de una palabra, decodificada y juntada con el delta en 'apoyo'
+// (sin parte compactada es una vista del delta, sin copia)
+VistaPostings juntarPostings(const PostingsPalabra& postings, ListaFrecuencias& apoyo);
+
+// Union de las listas de las palabras expandidas en 'apoyo', sumando las frecuencias de un documento (sin
+// posiciones). Segun cuantos postings y que rango de IDs haya, se suman en un arreglo por documento o se mezclan
+// de a pares en rondas como en unirVarias.
+VistaPostings juntarExpansion(const ExpansionPalabras& expansion, ListaFrecuencias& apoyo);
+
+// Documentos donde aparecen las palabras de la frase en orden: cada palabra puede caer hasta 'holgura' posiciones
+// despues de donde la pone la frase (contando desde la primera). Las palabras vacias de la frase no se buscan pero
+// conservan su hueco. Primero se intersectan los IDs empezando por la palabra mas rara y solo en los documentos
+// comunes se decodifican y mezclan las posiciones. La frecuencia de cada documento es el numero de apariciones
+// de la frase. En un indice sin posiciones se devuelven los documentos que tienen todas las palabras.
+// Puede incluir documentos borrados.
+ListaFrecuencias buscarFrase(const Trie& trie, const string& frase, uint32_t holgura = 0);
+
+// Procesar entrada: devuelve los IDs de los documentos vigentes que cumplen la consulta, escrita en el
+// lenguaje de Consulta.h (palabras y frases entre comillas con AND, OR, NOT y parentesis).
+// Una consulta mal escrita se informa en cerr y no devuelve documentos.
+ListaPostings procesarEntrada(const Trie& trie, const TablaDocumentos& documentos, const string& entrada);
+
+// Documento de una busqueda ordenada por relevancia
+struct ResultadoBusqueda {
+    uint32_t documento;
+    double puntaje;
+};
+
+// Parametros de BM25: k1 satura la frecuencia de la palabra y b pesa la longitud del documento
+struct ParametrosBM25 {
+    double k1 = 1.2;
+    double b = 0.75;
+};
+
+const size_t RESULTADOS_POR_CONSULTA = 10;
+
+// Misma consulta que procesarEntrada, pero devuelve solo los 'k' documentos con mayor puntaje BM25
+// (de mayor a menor). El puntaje de un documento es la suma del de cada palabra o frase de la consulta que
+// contiene (las que estan bajo un NOT no suman); los mejores se eligen con un monticulo de tamaño k, sin
+// ordenar todos los resultados.
+vector<ResultadoBusqueda> buscarRanking(const Trie& trie, const TablaDocumentos& documentos, const string& entrada,
+                                        size_t k = RESULTADOS_POR_CONSULTA, const ParametrosBM25& parametros = ParametrosBM25());
+// La misma, con la consulta ya analizada (Consulta.h)
+struct NodoConsulta;
+vector<ResultadoBusqueda> buscarRanking(const Trie& trie, const TablaDocumentos& documentos, const NodoConsulta& consulta,
+                                        size_t k = RESULTADOS_POR_CONSULTA, const ParametrosBM25& parametros = ParametrosBM25());
 
 // Función para crear índice invertido
-void crearIndiceInvertido(const vector<string>& nombresArchivos, Trie& trie, unordered_set<string>& stopWords);
+// Cada archivo se libera en cuanto terminan de tokenizarse todos sus fragmentos. Las palabras vacias quedan
+// normalizadas como las del texto (normalizarPalabras), y asi las usan despues agregar y las consultas.
+void crearIndiceInvertido(const vector<string>& nombresArchivos, Trie& trie, TablaDocumentos& documentos, unordered_set<string>& stopWords,
+                          const OpcionesIndexado& opciones = OpcionesIndexado());
+
+// Cambios sobre un indice ya construido; cada uno cuesta lo proporcional al documento y no al corpus.
+// Agregar lee y tokeniza el archivo y deja sus palabras en el delta del trie; devuelve su ID o DOCUMENTO_INVALIDO.
+uint32_t agregarDocumento(const string& ruta, Trie& trie, TablaDocumentos& documentos, const unordered_set<string>& stopWords);
+// Borrar solo marca la lapida del documento (sus IDs se filtran al consultar hasta la siguiente compactacion)
+bool borrarDocumento(const string& ruta, TablaDocumentos& documentos);
+// Reemplazar borra la version indexada del archivo y agrega la actual con un ID nuevo
+uint32_t reemplazarDocumento(const string& ruta, Trie& trie, TablaDocumentos& documentos, const unordered_set<string>& stopWords);
+// Compactar recorre todo el indice: funde el delta y libera el espacio de los documentos borrados
+void compactarIndice(Trie& trie, const TablaDocumentos& documentos);
+
+// Comandos de administracion que aceptan los servidores (el archivo es un nombre dentro de 'carpeta', sin rutas):
+//   ADMIN AGREGAR <archivo> | ADMIN BORRAR <archivo> | ADMIN REEMPLAZAR <archivo> | ADMIN COMPACTAR
+enum ComandoAdministracion {
+    NO_ES_COMANDO,
+    COMANDO_AGREGAR,
+    COMANDO_BORRAR,
+    COMANDO_REEMPLAZAR,
+    COMANDO_COMPACTAR,
+    COMANDO_FALLIDO  // comando desconocido o que no se pudo aplicar
+};
+
+// Si la primera palabra de la entrada es ADMIN (una consulta como "ADMINISTRACION AND equipo" no lo es)
+bool esComandoAdministracion(const string& entrada);
+
+// Ejecuta la entrada si es un comando de administracion y deja en 'respuesta' el mensaje para el cliente
+ComandoAdministracion ejecutarComandoAdministracion(const string& entrada, const string& carpeta, Trie& trie, TablaDocumentos& documentos,
+                                                    const unordered_set<string>& stopWords, string& respuesta);
 
 #endif // INDICEINVERTIDO_H
@@ -0,0 +1,65 @@
+#include "IndicePublicado.h"
+#include "ArchivoIndice.h"
+
+using namespace std;
+
+IndicePublicado::IndicePublicado() : actual(make_shared<const VersionIndice>()) {}
+
+shared_ptr<const VersionIndice> IndicePublicado::fijar() const {
+    return atomic_load(&actual);
+}
+
+void IndicePublicado::publicar(shared_ptr<const VersionIndice> version) {
+    shared_ptr<const VersionIndice> anterior;  // si no tiene lectores se libera despues de soltar el candado
+    lock_guard<mutex> lock(candadoEscritores);
+    anterior = atomic_exchange(&actual, shared_ptr<const VersionIndice>(move(version)));
+}
+
+bool IndicePublicado::modificar(const function<bool(VersionIndice&)>& cambio) {
+    Pendiente propio{&cambio};
+    {
+        lock_guard<mutex> lock(candadoCola);
+        cola.push_back(&propio);
+    }
+    shared_ptr<const VersionIndice> anterior;
+    lock_guard<mutex> lock(candadoEscritores);
+    if (propio.aplicado) {
+        return propio.resultado;  // entro en la tanda del escritor anterior
+    }
+    vector<Pendiente*> tanda;
+    {
+        lock_guard<mutex> lockCola(candadoCola);
+        tanda.swap(cola);
+    }
+    auto copia = make_shared<VersionIndice>(*atomic_load(&actual));
+    bool cambiado = false;
+    for (Pendiente* pendiente : tanda) {
+        pendiente->resultado = (*pendiente->cambio)(*copia);
+        pendiente->aplicado = true;
+        cambiado = cambiado || pendiente->resultado;
+    }
+    if (cambiado) {
+        anterior = atomic_exchange(&actual, shared_ptr<const VersionIndice>(move(copia)));
+    }
+    return propio.resultado;
+}
+
+ComandoAdministracion ejecutarComandoAdministracion(const string& entrada, const string& carpeta, IndicePublicado& indice,
+                                                    string& respuesta, const string& rutaIndice) {
+    ComandoAdministracion comando = NO_ES_COMANDO;
+    if (!esComandoAdministracion(entrada)) {
+        return comando;  // una consulta: no copia el indice
+    }
+    indice.modificar([&](VersionIndice& version) {
+        comando = ejecutarComandoAdministracion(entrada, carpeta, version.trie, version.documentos, *version.stopWords, respuesta);
+        if (comando == NO_ES_COMANDO || comando == COMANDO_FALLIDO) {
+            return false;
+        }
+        if (comando == COMANDO_COMPACTAR && !rutaIndice.empty()) {
+            // Con el candado de los escritores: otro comando no puede guardar al mismo tiempo
+            guardarIndice(rutaIndice, version.trie, version.documentos, *version.stopWords);
+        }
+        return true;
+    });
+    return comando;
+}
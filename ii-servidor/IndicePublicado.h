@@ -0,0 +1,65 @@
+#ifndef INDICEPUBLICADO_H
+#define INDICEPUBLICADO_H
+
+#include <string>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <vector>
+#include "IndiceInvertido.h"
+
+using namespace std;
+
+// Una version completa del indice: el trie, su tabla de documentos y las palabras vacias con que se indexo
+struct VersionIndice {
+    Trie trie;
+    TablaDocumentos documentos;
+    shared_ptr<const unordered_set<string>> stopWords = make_shared<const unordered_set<string>>();  // las versiones las comparten
+    MetricasIndexado construccion;  // de la ultima construccion completa (las versiones siguientes la heredan)
+};
+
+// Indice que se sirve mientras se cambia (lectura, copia y actualizacion)
+// Una version publicada no cambia nunca. El lector fija la actual (un shared_ptr que se lee y se reemplaza de
+// forma atomica) y la usa hasta terminar, sin esperar a ningun escritor y sin ver un cambio a medias. Un cambio
+// se aplica a una copia de la version actual que despues se publica de una vez. La copia comparte las particiones
+// compactadas del trie (Arreglo), el delta, la tabla de documentos (Compartido.h) y las palabras vacias, asi que
+// copiar no depende del tamaño del indice y el cambio solo duplica lo que toca; los cambios que llegan mientras
+// otro escritor copia se juntan en la siguiente copia y se publican juntos. Una version vieja se
+// libera cuando la suelta su ultimo lector.
+class IndicePublicado {
+private:
+    struct Pendiente {
+        const function<bool(VersionIndice&)>* cambio;
+        bool aplicado = false;  // lo aplico otro escritor en su tanda
+        bool resultado = false;
+    };
+    shared_ptr<const VersionIndice> actual;  // solo con atomic_load, atomic_store y atomic_exchange
+    mutex candadoEscritores;  // una tanda de cambios a la vez, cada una sobre la version anterior
+    mutex candadoCola;
+    vector<Pendiente*> cola;  // cambios que esperan la siguiente tanda
+
+public:
+    IndicePublicado();  // empieza con un indice vacio
+    IndicePublicado(const IndicePublicado&) = delete;
+    IndicePublicado& operator=(const IndicePublicado&) = delete;
+
+    // La version actual; sigue valida y sin cambios mientras se conserve el puntero
+    shared_ptr<const VersionIndice> fijar() const;
+
+    // Reemplaza el indice entero (uno recargado o reconstruido aparte)
+    void publicar(shared_ptr<const VersionIndice> version);
+
+    // Aplica 'cambio' a una copia de la version actual, junto con los de otros escritores que esperan, y la
+    // publica si alguno devuelve true (que hizo algo). Devuelve lo que devolvio 'cambio'. Los escritores esperan
+    // su turno; los lectores no esperan. Como la tanda comparte la copia, un cambio que devuelve false no debe
+    // haber tocado la version.
+    bool modificar(const function<bool(VersionIndice&)>& cambio);
+};
+
+// Ejecuta un comando de administracion (ejecutarComandoAdministracion) en una version nueva del indice y la
+// publica si el comando lo cambio. Con 'rutaIndice', COMPACTAR tambien guarda en disco la version compactada.
+ComandoAdministracion ejecutarComandoAdministracion(const string& entrada, const string& carpeta, IndicePublicado& indice,
+                                                    string& respuesta, const string& rutaIndice = "");
+
+#endif // INDICEPUBLICADO_H
@@ -0,0 +1,286 @@
+#include "ListasOrdenadas.h"
+#include <algorithm>
+#include <array>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define LISTAS_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static size_t intersectarEscalar(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* salida) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            salida[k++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+// Cada ID de la lista corta se busca en la larga desde donde quedo el anterior: saltos de 1, 2, 4...
+// hasta pasarlo y luego busqueda binaria en el ultimo salto. Cuesta nc * log(nl / nc) en vez de nc + nl.
+static size_t intersectarGalope(const uint32_t* corta, size_t nc, const uint32_t* larga, size_t nl, uint32_t* salida) {
+    size_t k = 0;
+    size_t base = 0;  // todo lo anterior a 'base' es menor que el ID buscado
+    for (size_t i = 0; i < nc && base < nl; ++i) {
+        uint32_t id = corta[i];
+        size_t alto = base;
+        size_t salto = 1;
+        while (alto < nl && larga[alto] < id) {
+            base = alto + 1;
+            alto += salto;
+            salto <<= 1;
+        }
+        base = static_cast<size_t>(lower_bound(larga + base, larga + min(alto + 1, nl), id) - larga);
+        if (base < nl && larga[base] == id) {
+            salida[k++] = id;
+            ++base;
+        }
+    }
+    return k;
+}
+
+#ifdef LISTAS_SIMD
+
+// Para cada mascara de coincidencias, los indices que juntan al principio los elementos que coincidieron
+static array<array<uint8_t, 16>, 16> crearTablaSSE() {
+    array<array<uint8_t, 16>, 16> tabla;
+    for (int mascara = 0; mascara < 16; ++mascara) {
+        tabla[mascara].fill(0x80);  // 0x80 deja el byte en cero
+        int destino = 0;
+        for (int carril = 0; carril < 4; ++carril) {
+            if (mascara & (1 << carril)) {
+                for (int byte = 0; byte < 4; ++byte) {
+                    tabla[mascara][destino * 4 + byte] = static_cast<uint8_t>(carril * 4 + byte);
+                }
+                ++destino;
+            }
+        }
+    }
+    return tabla;
+}
+
+static array<array<uint32_t, 8>, 256> crearTablaAVX2() {
+    array<array<uint32_t, 8>, 256> tabla;
+    for (int mascara = 0; mascara < 256; ++mascara) {
+        tabla[mascara].fill(0);
+        int destino = 0;
+        for (int carril = 0; carril < 8; ++carril) {
+            if (mascara & (1 << carril)) {
+                tabla[mascara][destino++] = static_cast<uint32_t>(carril);
+            }
+        }
+    }
+    return tabla;
+}
+
+static const array<array<uint8_t, 16>, 16> tablaSSE = crearTablaSSE();
+static const array<array<uint32_t, 8>, 256> tablaAVX2 = crearTablaAVX2();
+
+// Compara un bloque de 4 IDs de 'a' con las 4 rotaciones del bloque de 'b'; avanza el bloque que termina
+// antes (o los dos). Como los IDs no se repiten, cada coincidencia se encuentra una sola vez.
+__attribute__((target("sse4.1")))
+static size_t intersectarSSE41(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* salida) {
+    size_t i = 0, j = 0, k = 0;
+    size_t finA = na & ~static_cast<size_t>(3);
+    size_t finB = nb & ~static_cast<size_t>(3);
+    while (i < finA && j < finB) {
+        __m128i bloqueA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i bloqueB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i iguales = _mm_cmpeq_epi32(bloqueA, bloqueB);
+        iguales = _mm_or_si128(iguales, _mm_cmpeq_epi32(bloqueA, _mm_shuffle_epi32(bloqueB, _MM_SHUFFLE(0, 3, 2, 1))));
+        iguales = _mm_or_si128(iguales, _mm_cmpeq_epi32(bloqueA, _mm_shuffle_epi32(bloqueB, _MM_SHUFFLE(1, 0, 3, 2))));
+        iguales = _mm_or_si128(iguales, _mm_cmpeq_epi32(bloqueA, _mm_shuffle_epi32(bloqueB, _MM_SHUFFLE(2, 1, 0, 3))));
+        int mascara = _mm_movemask_ps(_mm_castsi128_ps(iguales));
+        __m128i juntos = _mm_shuffle_epi8(bloqueA, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tablaSSE[mascara].data())));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(salida + k), juntos);
+        k += static_cast<size_t>(__builtin_popcount(mascara));
+        uint32_t ultimoA = a[i + 3];
+        uint32_t ultimoB = b[j + 3];
+        i += ultimoA <= ultimoB ? 4 : 0;
+        j += ultimoB <= ultimoA ? 4 : 0;
+    }
+    return k + intersectarEscalar(a + i, na - i, b + j, nb - j, salida + k);
+}
+
+// Igual con bloques de 8 IDs y 8 rotaciones
+__attribute__((target("avx2")))
+static size_t intersectarAVX2(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* salida) {
+    size_t i = 0, j = 0, k = 0;
+    size_t finA = na & ~static_cast<size_t>(7);
+    size_t finB = nb & ~static_cast<size_t>(7);
+    const __m256i rotaciones[7] = {
+        _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0), _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1),
+        _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2), _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3),
+        _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4), _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5),
+        _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6),
+    };
+    while (i < finA && j < finB) {
+        __m256i bloqueA = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i bloqueB = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        __m256i iguales = _mm256_cmpeq_epi32(bloqueA, bloqueB);
+        for (const __m256i& rotacion : rotaciones) {
+            iguales = _mm256_or_si256(iguales, _mm256_cmpeq_epi32(bloqueA, _mm256_permutevar8x32_epi32(bloqueB, rotacion)));
+        }
+        int mascara = _mm256_movemask_ps(_mm256_castsi256_ps(iguales));
+        __m256i orden = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tablaAVX2[mascara].data()));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(salida + k), _mm256_permutevar8x32_epi32(bloqueA, orden));
+        k += static_cast<size_t>(__builtin_popcount(mascara));
+        uint32_t ultimoA = a[i + 7];
+        uint32_t ultimoB = b[j + 7];
+        i += ultimoA <= ultimoB ? 8 : 0;
+        j += ultimoB <= ultimoA ? 8 : 0;
+    }
+    return k + intersectarEscalar(a + i, na - i, b + j, nb - j, salida + k);
+}
+
+#endif // LISTAS_SIMD
+
+bool nucleoDisponible(NucleoInterseccion nucleo) {
+#ifdef LISTAS_SIMD
+    static const bool sse41 = __builtin_cpu_supports("sse4.1");
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+#else
+    const bool sse41 = false;
+    const bool avx2 = false;
+#endif
+    switch (nucleo) {
+    case NUCLEO_SSE41:
+        return sse41;
+    case NUCLEO_AVX2:
+        return avx2;
+    default:
+        return true;
+    }
+}
+
+const char* nombreNucleo(NucleoInterseccion nucleo) {
+    switch (nucleo) {
+    case NUCLEO_AUTOMATICO:
+        return "automatico";
+    case NUCLEO_ESCALAR:
+        return "escalar";
+    case NUCLEO_GALOPE:
+        return "galope";
+    case NUCLEO_SSE41:
+        return "SSE4.1";
+    case NUCLEO_AVX2:
+        return "AVX2";
+    }
+    return "?";
+}
+
+size_t intersectarOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* salida, NucleoInterseccion nucleo) {
+    if (na == 0 || nb == 0) {
+        return 0;
+    }
+    if (nucleo == NUCLEO_AUTOMATICO) {
+        if (max(na, nb) / min(na, nb) >= PROPORCION_GALOPE) {
+            nucleo = NUCLEO_GALOPE;
+        } else if (nucleoDisponible(NUCLEO_AVX2)) {
+            nucleo = NUCLEO_AVX2;
+        } else if (nucleoDisponible(NUCLEO_SSE41)) {
+            nucleo = NUCLEO_SSE41;
+        } else {
+            nucleo = NUCLEO_ESCALAR;
+        }
+    }
+    if (!nucleoDisponible(nucleo)) {
+        nucleo = NUCLEO_ESCALAR;
+    }
+    switch (nucleo) {
+    case NUCLEO_GALOPE:
+        return na <= nb ? intersectarGalope(a, na, b, nb, salida) : intersectarGalope(b, nb, a, na, salida);
+#ifdef LISTAS_SIMD
+    case NUCLEO_SSE41:
+        return intersectarSSE41(a, na, b, nb, salida);
+    case NUCLEO_AVX2:
+        return intersectarAVX2(a, na, b, nb, salida);
+#endif
+    default:
+        return intersectarEscalar(a, na, b, nb, salida);
+    }
+}
+
+void intersectarOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, vector<uint32_t>& salida,
+                          NucleoInterseccion nucleo) {
+    salida.resize(min(na, nb) + 8);
+    salida.resize(intersectarOrdenadas(a, na, b, nb, salida.data(), nucleo));
+}
+
+// Mezcla sin saltos impredecibles: en cada paso sale el menor y avanza la lista (o las dos) que lo tenia
+static size_t mezclarOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* salida) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        uint32_t x = a[i];
+        uint32_t y = b[j];
+        salida[k++] = x < y ? x : y;
+        i += x <= y;
+        j += y <= x;
+    }
+    while (i < na) {
+        salida[k++] = a[i++];
+    }
+    while (j < nb) {
+        salida[k++] = b[j++];
+    }
+    return k;
+}
+
+void unirOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, vector<uint32_t>& salida) {
+    salida.resize(na + nb);
+    salida.resize(mezclarOrdenadas(a, na, b, nb, salida.data()));
+}
+
+void unirVarias(const vector<ListaOrdenada>& listas, vector<uint32_t>& salida) {
+    vector<ListaOrdenada> ronda;
+    size_t total = 0;
+    for (const ListaOrdenada& lista : listas) {
+        if (lista.n > 0) {
+            ronda.push_back(lista);
+            total += lista.n;
+        }
+    }
+    if (ronda.size() <= 2) {
+        if (ronda.empty()) {
+            salida.clear();
+        } else if (ronda.size() == 1) {
+            salida.assign(ronda[0].datos, ronda[0].datos + ronda[0].n);
+        } else {
+            unirOrdenadas(ronda[0].datos, ronda[0].n, ronda[1].datos, ronda[1].n, salida);
+        }
+        return;
+    }
+
+    // Rondas de mezclas de a pares alternando entre dos buferes; la ultima ronda escribe en 'salida'
+    vector<uint32_t> buferes[2];
+    buferes[0].resize(total);
+    buferes[1].resize(total);
+    int destino = 0;
+    while (ronda.size() > 2) {
+        vector<ListaOrdenada> siguiente;
+        siguiente.reserve((ronda.size() + 1) / 2);
+        uint32_t* escritura = buferes[destino].data();
+        for (size_t l = 0; l + 1 < ronda.size(); l += 2) {
+            size_t n = mezclarOrdenadas(ronda[l].datos, ronda[l].n, ronda[l + 1].datos, ronda[l + 1].n, escritura);
+            siguiente.push_back({escritura, n});
+            escritura += n;
+        }
+        if (ronda.size() % 2 == 1) {
+            const ListaOrdenada& sola = ronda.back();
+            copy(sola.datos, sola.datos + sola.n, escritura);
+            siguiente.push_back({escritura, sola.n});
+        }
+        ronda.swap(siguiente);
+        destino = 1 - destino;
+    }
+    unirOrdenadas(ronda[0].datos, ronda[0].n, ronda[1].datos, ronda[1].n, salida);
+}
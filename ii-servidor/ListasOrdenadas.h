@@ -0,0 +1,50 @@
+#ifndef LISTASORDENADAS_H
+#define LISTASORDENADAS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// Operaciones sobre listas de IDs estrictamente crecientes (postings)
+// La interseccion tiene varios nucleos: mezcla escalar, galope para listas de tamaños muy distintos
+// y versiones SSE4.1 y AVX2 que comparan bloques de 4 u 8 IDs contra todas las rotaciones del otro bloque.
+// Las versiones vectoriales solo se compilan con GCC o Clang en x86 y se eligen al ejecutar segun la CPU;
+// en otro compilador o arquitectura se usa la escalar.
+enum NucleoInterseccion {
+    NUCLEO_AUTOMATICO,  // galope si una lista es mucho mas larga; si no, el mejor que soporte la CPU
+    NUCLEO_ESCALAR,
+    NUCLEO_GALOPE,
+    NUCLEO_SSE41,
+    NUCLEO_AVX2
+};
+
+// Con listas mas desbalanceadas que esto conviene galopar sobre la larga
+const size_t PROPORCION_GALOPE = 32;
+
+bool nucleoDisponible(NucleoInterseccion nucleo);
+const char* nombreNucleo(NucleoInterseccion nucleo);
+
+// Escribe en 'salida' los IDs que estan en las dos listas. 'salida' necesita espacio para
+// min(na, nb) + 8 IDs (los nucleos vectoriales escriben bloques completos); devuelve cuantos escribio.
+// Un nucleo que la CPU no soporta cae en el escalar.
+size_t intersectarOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* salida,
+                            NucleoInterseccion nucleo = NUCLEO_AUTOMATICO);
+
+// Igual, dejando el resultado en un vector
+void intersectarOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, vector<uint32_t>& salida,
+                          NucleoInterseccion nucleo = NUCLEO_AUTOMATICO);
+
+// Union de dos listas
+void unirOrdenadas(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, vector<uint32_t>& salida);
+
+// Union de k listas mezclandolas de a pares en rondas, como un torneo: cada ID se copia log k veces
+// en vez de hasta k veces al ir acumulando sobre un resultado. Los IDs repetidos salen una vez.
+struct ListaOrdenada {
+    const uint32_t* datos;
+    size_t n;
+};
+void unirVarias(const vector<ListaOrdenada>& listas, vector<uint32_t>& salida);
+
+#endif // LISTASORDENADAS_H
@@ -0,0 +1,248 @@
+#include "Metricas.h"
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char* nombresOperador[TIPOS_NODO] = {"palabra", "frase", "prefijo", "difusa", "and", "or", "not"};
+static const char* nombresOperacion[2] = {"ranking", "todos"};
+static const double CUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+MetricasConsultas::MetricasConsultas() : fragmentos(new Fragmento[FRAGMENTOS_METRICAS]) {}
+
+MetricasConsultas::Fragmento& MetricasConsultas::propio() {
+    static atomic<size_t> siguiente{0};
+    thread_local size_t fragmento = siguiente.fetch_add(1, memory_order_relaxed) % FRAGMENTOS_METRICAS;
+    return fragmentos[fragmento];
+}
+
+// Las consultas medidas se eligen al azar y no cada MUESTREO_LATENCIA: una mezcla de consultas que se repite con
+// ese periodo haria que se midiera siempre el mismo tipo (xorshift32, sembrado con la direccion del estado del hilo)
+MetricasConsultas::Reloj::time_point MetricasConsultas::empezar() {
+    thread_local uint32_t estado = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&estado) >> 4) | 1;
+    estado ^= estado << 13;
+    estado ^= estado >> 17;
+    estado ^= estado << 5;
+    return estado % MUESTREO_LATENCIA == 0 ? Reloj::now() : Reloj::time_point();
+}
+
+// time() es mucho mas barato que el reloj monotono y basta para contar por ventanas de segundos
+static time_t ventanaActual() {
+    return time(nullptr) / SEGUNDOS_VENTANA_METRICAS;
+}
+
+void MetricasConsultas::registrarConsulta(TipoNodo tipo, bool todos, Reloj::time_point inicio, size_t documentos) {
+    uint64_t nanosegundos = 0;
+    bool medida = inicio != Reloj::time_point();
+    if (medida) {
+        nanosegundos = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(Reloj::now() - inicio).count());
+    }
+    time_t actual = ventanaActual();
+    Fragmento& fragmento = propio();
+    lock_guard<mutex> lock(fragmento.candado);
+    ++fragmento.consultas[tipo];
+    if (medida) {
+        fragmento.latencias[tipo].registrar(nanosegundos);
+    }
+    fragmento.resultados[todos].registrar(documentos);
+    if (actual != fragmento.ventana) {
+        fragmento.enVentanaAnterior = actual == fragmento.ventana + 1 ? fragmento.enVentana : 0;
+        fragmento.ventana = actual;
+        fragmento.enVentana = 0;
+    }
+    ++fragmento.enVentana;
+}
+
+void MetricasConsultas::registrarInvalida() {
+    Fragmento& fragmento = propio();
+    lock_guard<mutex> lock(fragmento.candado);
+    ++fragmento.invalidas;
+}
+
+void MetricasConsultas::registrarComando() {
+    Fragmento& fragmento = propio();
+    lock_guard<mutex> lock(fragmento.candado);
+    ++fragmento.comandos;
+}
+
+// Un resumen de Prometheus: los cuantiles, la suma y la cantidad ('escala' convierte las unidades del histograma)
+static void escribirResumen(ostringstream& texto, const string& nombre, const string& etiqueta, const HistogramaLatencias& histograma,
+                            double escala) {
+    if (histograma.cantidad() > 0) {
+        for (double cuantil : CUANTILES) {
+            texto << nombre << "{" << etiqueta << ",quantile=\"" << cuantil << "\"} " << histograma.percentil(cuantil * 100) * escala << "\n";
+        }
+    }
+    texto << nombre << "_sum{" << etiqueta << "} " << histograma.promedio() * static_cast<double>(histograma.cantidad()) * escala << "\n";
+    texto << nombre << "_count{" << etiqueta << "} " << histograma.cantidad() << "\n";
+}
+
+string MetricasConsultas::textoPrometheus() const {
+    array<uint64_t, TIPOS_NODO> consultas{};
+    array<HistogramaLatencias, TIPOS_NODO> latencias;
+    array<HistogramaLatencias, 2> resultados;
+    uint64_t invalidas = 0, comandos = 0, ultimaVentana = 0;
+    time_t anterior = ventanaActual() - 1;
+    for (size_t i = 0; i < FRAGMENTOS_METRICAS; ++i) {
+        const Fragmento& fragmento = fragmentos[i];
+        lock_guard<mutex> lock(fragmento.candado);
+        for (size_t tipo = 0; tipo < TIPOS_NODO; ++tipo) {
+            consultas[tipo] += fragmento.consultas[tipo];
+            latencias[tipo].sumar(fragmento.latencias[tipo]);
+        }
+        for (size_t operacion = 0; operacion < 2; ++operacion) {
+            resultados[operacion].sumar(fragmento.resultados[operacion]);
+        }
+        invalidas += fragmento.invalidas;
+        comandos += fragmento.comandos;
+        if (fragmento.ventana == anterior) {
+            ultimaVentana += fragmento.enVentana;
+        } else if (fragmento.ventana == anterior + 1) {
+            ultimaVentana += fragmento.enVentanaAnterior;
+        }
+    }
+
+    ostringstream texto;
+    texto << "# HELP ii_consultas_total Consultas respondidas, por operador de la raiz de la consulta\n"
+          << "# TYPE ii_consultas_total counter\n";
+    for (size_t tipo = 0; tipo < TIPOS_NODO; ++tipo) {
+        texto << "ii_consultas_total{operador=\"" << nombresOperador[tipo] << "\"} " << consultas[tipo] << "\n";
+    }
+    texto << "# HELP ii_consulta_latencia_segundos Tiempo de atender una consulta en el servidor (una de cada " << MUESTREO_LATENCIA
+          << " consultas)\n"
+          << "# TYPE ii_consulta_latencia_segundos summary\n";
+    for (size_t tipo = 0; tipo < TIPOS_NODO; ++tipo) {
+        escribirResumen(texto, "ii_consulta_latencia_segundos", string("operador=\"") + nombresOperador[tipo] + "\"", latencias[tipo], 1e-9);
+    }
+    texto << "# HELP ii_consulta_documentos Documentos devueltos por consulta\n"
+          << "# TYPE ii_consulta_documentos summary\n";
+    for (size_t operacion = 0; operacion < 2; ++operacion) {
+        escribirResumen(texto, "ii_consulta_documentos", string("operacion=\"") + nombresOperacion[operacion] + "\"", resultados[operacion], 1);
+    }
+    texto << "# HELP ii_consultas_invalidas_total Consultas rechazadas por su sintaxis\n"
+          << "# TYPE ii_consultas_invalidas_total counter\n"
+          << "ii_consultas_invalidas_total " << invalidas << "\n"
+          << "# HELP ii_comandos_total Comandos ADMIN, CACHE y STATS\n"
+          << "# TYPE ii_comandos_total counter\n"
+          << "ii_comandos_total " << comandos << "\n"
+          << "# HELP ii_consultas_por_segundo Consultas por segundo en la ultima ventana completa de " << SEGUNDOS_VENTANA_METRICAS << " s\n"
+          << "# TYPE ii_consultas_por_segundo gauge\n"
+          << "ii_consultas_por_segundo " << static_cast<double>(ultimaVentana) / SEGUNDOS_VENTANA_METRICAS << "\n"
+          << "# HELP ii_tiempo_activo_segundos Tiempo desde que se crearon los contadores\n"
+          << "# TYPE ii_tiempo_activo_segundos gauge\n"
+          << "ii_tiempo_activo_segundos " << chrono::duration<double>(Reloj::now() - inicio).count() << "\n";
+    return texto.str();
+}
+
+// Memoria residente del proceso en bytes (0 si el sistema no la informa)
+static uint64_t memoriaResidente() {
+#ifdef __linux__
+    ifstream statm("/proc/self/statm");
+    uint64_t paginas = 0, residentes = 0;
+    long tamanoPagina = sysconf(_SC_PAGESIZE);  // 4 KiB casi siempre, pero 16 o 64 KiB en algunos kernels ARM y POWER
+    if (statm >> paginas >> residentes && tamanoPagina > 0) {
+        return residentes * static_cast<uint64_t>(tamanoPagina);
+    }
+#endif
+    return 0;
+}
+
+string textoMetricas(const VersionIndice& version, const EstadisticasCache& cache, const MetricasConsultas& consultas) {
+    const MetricasIndexado& construccion = version.construccion;
+    const Trie& trie = version.trie;
+    ostringstream texto;
+    texto << "# HELP ii_indexado_archivos Archivos leidos en la ultima construccion del indice\n"
+          << "# TYPE ii_indexado_archivos gauge\n"
+          << "ii_indexado_archivos " << construccion.archivos << "\n"
+          << "# HELP ii_indexado_bytes Bytes leidos en la ultima construccion\n"
+          << "# TYPE ii_indexado_bytes gauge\n"
+          << "ii_indexado_bytes " << construccion.bytesLeidos << "\n"
+          << "# HELP ii_indexado_palabras Tokens de la ultima construccion, con las palabras vacias\n"
+          << "# TYPE ii_indexado_palabras gauge\n"
+          << "ii_indexado_palabras " << construccion.palabras << "\n"
+          << "# HELP ii_indexado_palabras_vacias Tokens descartados por ser palabras vacias\n"
+          << "# TYPE ii_indexado_palabras_vacias gauge\n"
+          << "ii_indexado_palabras_vacias " << construccion.palabrasVacias << "\n"
+          << "# HELP ii_indexado_segundos Duracion de cada etapa de la ultima construccion (0 si el indice se cargo de disco)\n"
+          << "# TYPE ii_indexado_segundos gauge\n"
+          << "ii_indexado_segundos{etapa=\"mapeo\"} " << construccion.segundosMapeo << "\n"
+          << "ii_indexado_segundos{etapa=\"reduccion\"} " << construccion.segundosReduccion << "\n"
+          << "# HELP ii_indice_documentos Documentos de la tabla\n"
+          << "# TYPE ii_indice_documentos gauge\n"
+          << "ii_indice_documentos{estado=\"vigente\"} " << version.documentos.vigentes() << "\n"
+          << "ii_indice_documentos{estado=\"borrado\"} " << version.documentos.borrados() << "\n"
+          << "# HELP ii_indice_terminos Palabras distintas compactadas y en el delta\n"
+          << "# TYPE ii_indice_terminos gauge\n"
+          << "ii_indice_terminos{parte=\"compactada\"} " << trie.terminos() << "\n"
+          << "ii_indice_terminos{parte=\"delta\"} " << trie.palabrasAgregadas() << "\n"
+          << "# HELP ii_indice_postings Pares palabra-documento\n"
+          << "# TYPE ii_indice_postings gauge\n"
+          << "ii_indice_postings " << trie.numeroPostings() << "\n"
+          << "# HELP ii_indice_estados_trie Estados (nodos) de los doble arreglos del trie\n"
+          << "# TYPE ii_indice_estados_trie gauge\n"
+          << "ii_indice_estados_trie " << trie.estados() << "\n"
+          << "# HELP ii_indice_bytes Memoria de la parte compactada del indice\n"
+          << "# TYPE ii_indice_bytes gauge\n"
+          << "ii_indice_bytes{parte=\"diccionario\"} " << trie.bytesDiccionario() << "\n"
+          << "ii_indice_bytes{parte=\"postings\"} " << trie.bytesPostings() - trie.bytesPosiciones() << "\n"
+          << "ii_indice_bytes{parte=\"posiciones\"} " << trie.bytesPosiciones() << "\n";
+    uint64_t residente = memoriaResidente();
+    if (residente > 0) {
+        texto << "# HELP ii_proceso_memoria_residente_bytes Memoria residente del proceso\n"
+              << "# TYPE ii_proceso_memoria_residente_bytes gauge\n"
+              << "ii_proceso_memoria_residente_bytes " << residente << "\n";
+    }
+    texto << "# HELP ii_cache_consultas_total Busquedas en la cache de consultas\n"
+          << "# TYPE ii_cache_consultas_total counter\n"
+          << "ii_cache_consultas_total{resultado=\"acierto\"} " << cache.aciertos << "\n"
+          << "ii_cache_consultas_total{resultado=\"fallo\"} " << cache.fallos << "\n"
+          << "# HELP ii_cache_bytes Memoria de la cache de consultas\n"
+          << "# TYPE ii_cache_bytes gauge\n"
+          << "ii_cache_bytes " << cache.bytes << "\n";
+    texto << consultas.textoPrometheus();
+    return texto.str();
+}
+
+bool escribirMetricas(const string& ruta, const string& texto) {
+    string temporal = ruta + ".tmp";
+    {
+        ofstream archivo(temporal, ios::binary | ios::trunc);
+        if (!archivo.write(texto.data(), static_cast<streamsize>(texto.size()))) {
+            cerr << "No se pudo escribir el archivo de metricas: " << temporal << endl;
+            return false;
+        }
+    }
+    if (rename(temporal.c_str(), ruta.c_str()) != 0) {
+        cerr << "No se pudo reemplazar el archivo de metricas: " << ruta << endl;
+        remove(temporal.c_str());
+        return false;
+    }
+    return true;
+}
+
+string resumenIndexado(const VersionIndice& version) {
+    const MetricasIndexado& construccion = version.construccion;
+    ostringstream texto;
+    if (construccion.construido) {
+        texto << "Indexados " << construccion.archivos << " archivos (" << (construccion.bytesLeidos + 1023) / 1024 << " KiB, "
+              << construccion.palabras << " palabras, " << construccion.palabrasVacias << " vacias) en "
+              << construccion.segundosMapeo + construccion.segundosReduccion << " s (mapeo " << construccion.segundosMapeo
+              << " s, reduccion " << construccion.segundosReduccion << " s); ";
+    }
+    texto << version.trie.terminos() << " terminos, " << version.trie.numeroPostings() << " postings, " << version.trie.estados()
+          << " estados del trie, " << (version.trie.bytesDiccionario() + version.trie.bytesPostings() + 1023) / 1024 << " KiB.";
+    return texto.str();
+}
+
+bool esComandoMetricas(const string& entrada) {
+    istringstream stream(entrada);
+    string primera, segunda, resto;
+    stream >> primera >> segunda >> resto;
+    return (primera == "STATS" && segunda.empty()) || (primera == "ADMIN" && segunda == "STATS" && resto.empty());
+}
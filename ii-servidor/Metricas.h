@@ -0,0 +1,81 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <string>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include "IndicePublicado.h"
+#include "CacheConsultas.h"
+#include "Consulta.h"
+#include "HistogramaLatencias.h"
+
+using namespace std;
+
+const size_t TIPOS_NODO = NODO_NO + 1;
+const size_t FRAGMENTOS_METRICAS = 8;
+const int SEGUNDOS_VENTANA_METRICAS = 10;  // las consultas por segundo se informan sobre la ultima ventana completa
+const uint32_t MUESTREO_LATENCIA = 8;  // se mide la latencia de una de cada tantas consultas, elegidas al azar
+
+// Contadores de las consultas que responde un servidor
+// Cada consulta se cuenta por el operador de la raiz de su arbol (palabra, frase, prefijo, difusa, and, or, not)
+// y suma su numero de documentos al histograma de su operacion (los mas relevantes o todos). Leer el reloj
+// cuesta mas que todo lo demas junto, asi que la latencia se mide en una de cada MUESTREO_LATENCIA consultas
+// (al azar): los percentiles salen de esa muestra y los contadores son exactos. Para que registrar no sea
+// un punto de espera, los contadores se reparten en fragmentos con su propio candado y cada hilo usa siempre
+// el mismo, que casi nunca esta ocupado. Leerlos (texto de Prometheus) suma los fragmentos.
+class MetricasConsultas {
+public:
+    using Reloj = chrono::steady_clock;
+
+private:
+    struct Fragmento {
+        mutable mutex candado;
+        array<uint64_t, TIPOS_NODO> consultas{};           // por operador de la raiz
+        array<HistogramaLatencias, TIPOS_NODO> latencias;  // nanosegundos, de las consultas medidas
+        array<HistogramaLatencias, 2> resultados;          // documentos devueltos: los mas relevantes y todos
+        uint64_t invalidas = 0;
+        uint64_t comandos = 0;
+        time_t ventana = 0;            // numero de la ventana de SEGUNDOS_VENTANA_METRICAS que se esta contando
+        uint64_t enVentana = 0;
+        uint64_t enVentanaAnterior = 0;
+    };
+    unique_ptr<Fragmento[]> fragmentos;
+    Reloj::time_point inicio = Reloj::now();
+
+    Fragmento& propio();  // el fragmento del hilo que llama
+
+public:
+    MetricasConsultas();
+    MetricasConsultas(const MetricasConsultas&) = delete;
+    MetricasConsultas& operator=(const MetricasConsultas&) = delete;
+
+    // Se llama al empezar a atender una consulta: el instante actual si a la consulta le toca medir su latencia
+    // o un instante vacio (sin leer el reloj) si no
+    static Reloj::time_point empezar();
+    // Una consulta respondida: 'inicio' es lo que devolvio empezar y 'todos' si pidio todos los documentos
+    void registrarConsulta(TipoNodo tipo, bool todos, Reloj::time_point inicio, size_t documentos);
+    void registrarInvalida();
+    void registrarComando();  // ADMIN, CACHE o STATS
+
+    // Contadores en el formato de texto de Prometheus
+    string textoPrometheus() const;
+};
+
+// Todas las metricas del servidor en el formato de texto de Prometheus: las de la construccion y el tamaño del
+// indice publicado, las de la cache y las de las consultas
+string textoMetricas(const VersionIndice& version, const EstadisticasCache& cache, const MetricasConsultas& consultas);
+
+// Escribe el texto en 'ruta' de una vez (un archivo temporal que se renombra), para que quien lo lea (por
+// ejemplo el recolector de archivos de texto de node_exporter) nunca vea uno a medias
+bool escribirMetricas(const string& ruta, const string& texto);
+
+// Una linea con lo que midio la construccion del indice, para el log
+string resumenIndexado(const VersionIndice& version);
+
+// Comando con el que los servidores devuelven las metricas: STATS (o ADMIN STATS)
+bool esComandoMetricas(const string& entrada);
+
+#endif // METRICAS_H
@@ -0,0 +1,100 @@
+#include "PoolHilos.h"
+#include <algorithm>
+
+using namespace std;
+
+static thread_local PoolHilos* poolDelHilo = nullptr;
+static thread_local size_t indiceDelHilo = 0;
+
+PoolHilos::PoolHilos(size_t numeroHilos) : encoladas(0), sinTerminar(0), detener(false), siguienteCola(0) {
+    if (numeroHilos == 0) {
+        numeroHilos = max(1u, thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < numeroHilos; ++i) {
+        colas.push_back(make_unique<Cola>());
+    }
+    for (size_t i = 0; i < numeroHilos; ++i) {
+        hilos.emplace_back(&PoolHilos::trabajar, this, i);
+    }
+}
+
+PoolHilos::~PoolHilos() {
+    {
+        lock_guard<mutex> lock(mxEstado);
+        detener = true;
+    }
+    hayTrabajo.notify_all();
+    for (thread& hilo : hilos) {
+        hilo.join();
+    }
+}
+
+void PoolHilos::agregar(function<void()> tarea) {
+    size_t destino = poolDelHilo == this ? indiceDelHilo : siguienteCola++ % colas.size();
+    {
+        lock_guard<mutex> lock(colas[destino]->mx);
+        colas[destino]->tareas.push_back(move(tarea));
+    }
+    {
+        lock_guard<mutex> lock(mxEstado);
+        ++encoladas;
+        ++sinTerminar;
+    }
+    hayTrabajo.notify_one();
+}
+
+void PoolHilos::esperar() {
+    unique_lock<mutex> lock(mxEstado);
+    terminado.wait(lock, [this] { return sinTerminar == 0; });
+}
+
+size_t PoolHilos::hiloActual() {
+    return indiceDelHilo;
+}
+
+function<void()> PoolHilos::tomarTarea(size_t hilo) {
+    // La tarea ya esta reservada, asi que existe en alguna cola: se busca primero en la propia
+    while (true) {
+        for (size_t i = 0; i < colas.size(); ++i) {
+            Cola& cola = *colas[(hilo + i) % colas.size()];
+            lock_guard<mutex> lock(cola.mx);
+            if (cola.tareas.empty()) {
+                continue;
+            }
+            function<void()> tarea;
+            if (i == 0) {
+                tarea = move(cola.tareas.back());
+                cola.tareas.pop_back();
+            } else {
+                tarea = move(cola.tareas.front());  // robo: la tarea mas antigua de otro hilo
+                cola.tareas.pop_front();
+            }
+            return tarea;
+        }
+    }
+}
+
+void PoolHilos::trabajar(size_t hilo) {
+    poolDelHilo = this;
+    indiceDelHilo = hilo;
+    while (true) {
+        {
+            unique_lock<mutex> lock(mxEstado);
+            hayTrabajo.wait(lock, [this] { return encoladas > 0 || detener; });
+            if (encoladas == 0) {
+                return;  // detener y sin tareas pendientes
+            }
+            --encoladas;
+        }
+        function<void()> tarea = tomarTarea(hilo);
+        tarea();
+        bool ultima;
+        {
+            lock_guard<mutex> lock(mxEstado);
+            ultima = --sinTerminar == 0;
+        }
+        if (ultima) {
+            terminado.notify_all();
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef POOLHILOS_H
+#define POOLHILOS_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+using namespace std;
+
+// Pool de hilos con robo de tareas
+// Cada hilo tiene su propia cola: saca tareas del final de la suya (las mas recientes, que suelen
+// compartir datos en cache) y, cuando se queda sin trabajo, roba del inicio de las colas de los demas.
+// Las tareas que se agregan desde un hilo del pool van a la cola de ese hilo.
+class PoolHilos {
+private:
+    struct Cola {
+        mutex mx;
+        deque<function<void()>> tareas;
+    };
+
+    vector<unique_ptr<Cola>> colas;
+    vector<thread> hilos;
+    mutex mxEstado;
+    condition_variable hayTrabajo;
+    condition_variable terminado;
+    size_t encoladas;    // tareas en las colas que ningun hilo ha reservado
+    size_t sinTerminar;  // tareas agregadas que aun no terminan
+    bool detener;
+    atomic<size_t> siguienteCola;
+
+    void trabajar(size_t hilo);
+    function<void()> tomarTarea(size_t hilo);
+
+public:
+    explicit PoolHilos(size_t numeroHilos = 0);  // 0: un hilo por nucleo (hardware_concurrency)
+    ~PoolHilos();
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    void agregar(function<void()> tarea);
+    void esperar();  // Espera a que terminen todas las tareas (no llamar desde una tarea)
+    size_t size() const { return hilos.size(); }
+
+    // Posicion (0..size()-1) del hilo del pool que ejecuta la tarea actual
+    static size_t hiloActual();
+};
+
+#endif // POOLHILOS_H
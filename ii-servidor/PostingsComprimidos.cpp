@@ -0,0 +1,527 @@
+#include "PostingsComprimidos.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// Primer byte de cada lista
+static const uint8_t FORMATO_BLOQUES = 1;
+static const uint8_t FORMATO_MAPA = 2;
+
+// Formato por bloques:
+//   formato | por bloque: ultimo ID (u32), inicio del bloque (u32) | bloques
+//   bloque: bits de las diferencias (u8), diferencias | bits de las frecuencias (u8), frecuencias - 1
+// La diferencia de un ID es la distancia al anterior menos 1 (el primero se mide desde -1).
+// Formato de mapa:
+//   formato | grupos (u32) | por grupo: 16 bits altos (u32), IDs (u32), inicio (u32) | por bloque: inicio de sus frecuencias (u32)
+//   | datos de los grupos | bloques de frecuencias
+// Los inicios se miden desde el principio de la lista.
+static const size_t BYTES_SALTO = 8;
+static const size_t BYTES_GRUPO = 12;
+static const size_t PALABRAS_MAPA = 65536 / 64;
+
+static uint16_t leerU16(const uint8_t* datos) {
+    uint16_t valor;
+    memcpy(&valor, datos, sizeof(valor));
+    return valor;
+}
+
+static uint32_t leerU32(const uint8_t* datos) {
+    uint32_t valor;
+    memcpy(&valor, datos, sizeof(valor));
+    return valor;
+}
+
+static uint64_t leerU64(const uint8_t* datos) {
+    uint64_t valor;
+    memcpy(&valor, datos, sizeof(valor));
+    return valor;
+}
+
+template <typename T>
+static void escribirEntero(vector<uint8_t>& salida, T valor) {
+    size_t final = salida.size();
+    salida.resize(final + sizeof(valor));
+    memcpy(salida.data() + final, &valor, sizeof(valor));
+}
+
+static void escribirU32En(vector<uint8_t>& salida, size_t posicion, uint32_t valor) {
+    memcpy(salida.data() + posicion, &valor, sizeof(valor));
+}
+
+static unsigned contarBits(uint64_t palabra) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_popcountll(palabra));
+#else
+    unsigned bits = 0;
+    for (; palabra != 0; palabra &= palabra - 1) {
+        ++bits;
+    }
+    return bits;
+#endif
+}
+
+// Posicion del bit encendido mas bajo (la palabra no es 0)
+static unsigned bitMasBajo(uint64_t palabra) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(palabra));
+#else
+    unsigned bit = 0;
+    while ((palabra & 1) == 0) {
+        palabra >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+static unsigned bitsNecesarios(uint32_t valor) {
+    unsigned bits = 0;
+    for (; valor != 0; valor >>= 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+static size_t bytesEmpaquetados(size_t n, unsigned bits) {
+    return (n * bits + 7) / 8;
+}
+
+// Escribe 'bits' y luego los valores seguidos con esa cantidad de bits cada uno (el menos significativo primero)
+static void empaquetar(const uint32_t* valores, size_t n, vector<uint8_t>& salida) {
+    uint32_t mayor = 0;
+    for (size_t i = 0; i < n; ++i) {
+        mayor = max(mayor, valores[i]);
+    }
+    unsigned bits = bitsNecesarios(mayor);
+    salida.push_back(static_cast<uint8_t>(bits));
+    if (bits == 0) {
+        return;
+    }
+    uint64_t acumulado = 0;
+    unsigned ocupados = 0;
+    for (size_t i = 0; i < n; ++i) {
+        acumulado |= static_cast<uint64_t>(valores[i]) << ocupados;
+        ocupados += bits;
+        while (ocupados >= 8) {
+            salida.push_back(static_cast<uint8_t>(acumulado));
+            acumulado >>= 8;
+            ocupados -= 8;
+        }
+    }
+    if (ocupados > 0) {
+        salida.push_back(static_cast<uint8_t>(acumulado));
+    }
+}
+
+// Lee n valores empaquetados desde 'inicio' (el byte de los bits); devuelve donde terminan o 0 si no caben en 'bytes'
+static size_t desempaquetar(const uint8_t* datos, size_t bytes, size_t inicio, size_t n, uint32_t* salida) {
+    if (inicio >= bytes) {
+        return 0;
+    }
+    unsigned bits = datos[inicio];
+    size_t ocupan = bytesEmpaquetados(n, bits);
+    if (bits > 32 || ocupan > bytes - inicio - 1) {
+        return 0;
+    }
+    const uint8_t* byte = datos + inicio + 1;
+    if (bits == 0) {
+        fill(salida, salida + n, 0);
+        return inicio + 1;
+    }
+    uint64_t mascara = (static_cast<uint64_t>(1) << bits) - 1;
+    // Cada valor se saca de una lectura de 8 bytes (le bastan 32 + 7 bits) mientras esos 8 bytes esten dentro
+    // de la lista; los ultimos se leen byte a byte
+    size_t rapidos = 0;
+    size_t quedan = bytes - inicio - 1;
+    if (quedan >= sizeof(uint64_t)) {
+        rapidos = min(n, ((quedan - sizeof(uint64_t)) * 8) / bits + 1);
+    }
+    size_t posicionBit = 0;
+    for (size_t i = 0; i < rapidos; ++i, posicionBit += bits) {
+        salida[i] = static_cast<uint32_t>((leerU64(byte + posicionBit / 8) >> (posicionBit % 8)) & mascara);
+    }
+    for (size_t i = rapidos; i < n; ++i, posicionBit += bits) {
+        uint64_t valor = 0;
+        size_t primero = posicionBit / 8;
+        size_t ultimo = (posicionBit + bits - 1) / 8;
+        for (size_t b = primero; b <= ultimo; ++b) {
+            valor |= static_cast<uint64_t>(byte[b]) << ((b - primero) * 8);
+        }
+        salida[i] = static_cast<uint32_t>((valor >> (posicionBit % 8)) & mascara);
+    }
+    return inicio + 1 + ocupan;
+}
+
+static void empaquetarFrecuencias(const uint32_t* frecuencias, size_t n, vector<uint8_t>& salida) {
+    uint32_t valores[POSTINGS_POR_BLOQUE];
+    for (size_t i = 0; i < n; ++i) {
+        valores[i] = frecuencias ? max(frecuencias[i], 1u) - 1 : 0;
+    }
+    empaquetar(valores, n, salida);
+}
+
+static void comprimirBloques(const uint32_t* documentos, const uint32_t* frecuencias, size_t n, vector<uint8_t>& salida) {
+    size_t base = salida.size();
+    size_t bloques = (n + POSTINGS_POR_BLOQUE - 1) / POSTINGS_POR_BLOQUE;
+    salida.push_back(FORMATO_BLOQUES);
+    salida.resize(salida.size() + bloques * BYTES_SALTO);
+    uint32_t anterior = UINT32_MAX;  // el primer ID se guarda como diferencia con -1
+    uint32_t diferencias[POSTINGS_POR_BLOQUE];
+    for (size_t bloque = 0; bloque < bloques; ++bloque) {
+        size_t inicio = bloque * POSTINGS_POR_BLOQUE;
+        size_t cantidad = min(POSTINGS_POR_BLOQUE, n - inicio);
+        for (size_t i = 0; i < cantidad; ++i) {
+            diferencias[i] = documentos[inicio + i] - anterior - 1;
+            anterior = documentos[inicio + i];
+        }
+        size_t salto = base + 1 + bloque * BYTES_SALTO;
+        escribirU32En(salida, salto, anterior);
+        escribirU32En(salida, salto + 4, static_cast<uint32_t>(salida.size() - base));
+        empaquetar(diferencias, cantidad, salida);
+        empaquetarFrecuencias(frecuencias ? frecuencias + inicio : nullptr, cantidad, salida);
+    }
+}
+
+static void comprimirMapa(const uint32_t* documentos, const uint32_t* frecuencias, size_t n, vector<uint8_t>& salida) {
+    struct Grupo {
+        uint32_t clave;
+        size_t inicio, cantidad;
+    };
+    vector<Grupo> grupos;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t clave = documentos[i] >> 16;
+        if (grupos.empty() || grupos.back().clave != clave) {
+            grupos.push_back({clave, i, 0});
+        }
+        ++grupos.back().cantidad;
+    }
+    size_t base = salida.size();
+    size_t bloques = (n + POSTINGS_POR_BLOQUE - 1) / POSTINGS_POR_BLOQUE;
+    salida.push_back(FORMATO_MAPA);
+    escribirEntero(salida, static_cast<uint32_t>(grupos.size()));
+    size_t tablaGrupos = salida.size();
+    size_t tablaFrecuencias = tablaGrupos + grupos.size() * BYTES_GRUPO;
+    salida.resize(tablaFrecuencias + bloques * sizeof(uint32_t));
+
+    for (size_t g = 0; g < grupos.size(); ++g) {
+        const Grupo& grupo = grupos[g];
+        size_t entrada = tablaGrupos + g * BYTES_GRUPO;
+        escribirU32En(salida, entrada, grupo.clave);
+        escribirU32En(salida, entrada + 4, static_cast<uint32_t>(grupo.cantidad));
+        escribirU32En(salida, entrada + 8, static_cast<uint32_t>(salida.size() - base));
+        if (grupo.cantidad > MAXIMO_ARREGLO_MAPA) {
+            uint64_t palabras[PALABRAS_MAPA] = {};
+            for (size_t i = grupo.inicio; i < grupo.inicio + grupo.cantidad; ++i) {
+                uint32_t bajo = documentos[i] & 0xFFFF;
+                palabras[bajo / 64] |= static_cast<uint64_t>(1) << (bajo % 64);
+            }
+            for (uint64_t palabra : palabras) {
+                escribirEntero(salida, palabra);
+            }
+        } else {
+            for (size_t i = grupo.inicio; i < grupo.inicio + grupo.cantidad; ++i) {
+                escribirEntero(salida, static_cast<uint16_t>(documentos[i] & 0xFFFF));
+            }
+        }
+    }
+    for (size_t bloque = 0; bloque < bloques; ++bloque) {
+        size_t inicio = bloque * POSTINGS_POR_BLOQUE;
+        escribirU32En(salida, tablaFrecuencias + bloque * sizeof(uint32_t), static_cast<uint32_t>(salida.size() - base));
+        empaquetarFrecuencias(frecuencias ? frecuencias + inicio : nullptr, min(POSTINGS_POR_BLOQUE, n - inicio), salida);
+    }
+}
+
+void comprimirPostings(const uint32_t* documentos, const uint32_t* frecuencias, size_t n, vector<uint8_t>& salida) {
+    if (n == 0) {
+        return;
+    }
+    // Postings que caerian en grupos con mapa de bits
+    size_t enMapas = 0;
+    size_t inicioGrupo = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        if (i == n || (documentos[i] >> 16) != (documentos[inicioGrupo] >> 16)) {
+            if (i - inicioGrupo > MAXIMO_ARREGLO_MAPA) {
+                enMapas += i - inicioGrupo;
+            }
+            inicioGrupo = i;
+        }
+    }
+    if (enMapas * 2 >= n) {
+        comprimirMapa(documentos, frecuencias, n, salida);
+    } else {
+        comprimirBloques(documentos, frecuencias, n, salida);
+    }
+}
+
+bool PostingsComprimidos::esMapa() const {
+    return n > 0 && datos[0] == FORMATO_MAPA;
+}
+
+bool PostingsComprimidos::abrir(const uint8_t* lista, size_t tamano, size_t cantidad) {
+    *this = PostingsComprimidos();
+    if (cantidad == 0) {
+        return tamano == 0;
+    }
+    size_t numeroBloques = (cantidad + POSTINGS_POR_BLOQUE - 1) / POSTINGS_POR_BLOQUE;
+    if (tamano == 0) {
+        return false;
+    }
+    if (lista[0] == FORMATO_BLOQUES) {
+        if (numeroBloques > (tamano - 1) / BYTES_SALTO) {
+            return false;
+        }
+    } else if (lista[0] == FORMATO_MAPA) {
+        if (tamano < 5) {
+            return false;
+        }
+        size_t grupos = leerU32(lista + 1);
+        if (grupos > (tamano - 5) / BYTES_GRUPO || numeroBloques > (tamano - 5 - grupos * BYTES_GRUPO) / sizeof(uint32_t)) {
+            return false;
+        }
+        // Los grupos se recorren sin mas comprobaciones: se validan aqui una vez
+        size_t suma = 0;
+        for (size_t g = 0; g < grupos; ++g) {
+            const uint8_t* entrada = lista + 5 + g * BYTES_GRUPO;
+            uint32_t clave = leerU32(entrada);
+            size_t enGrupo = leerU32(entrada + 4);
+            size_t inicio = leerU32(entrada + 8);
+            size_t ocupa = enGrupo > MAXIMO_ARREGLO_MAPA ? PALABRAS_MAPA * sizeof(uint64_t) : enGrupo * sizeof(uint16_t);
+            if (clave > 0xFFFF || (g > 0 && clave <= leerU32(entrada - BYTES_GRUPO)) || enGrupo == 0 || enGrupo > 65536 ||
+                inicio > tamano || ocupa > tamano - inicio) {
+                return false;
+            }
+            suma += enGrupo;
+        }
+        if (suma != cantidad) {
+            return false;
+        }
+        contenedores = grupos;
+    } else {
+        return false;
+    }
+    datos = lista;
+    bytes = tamano;
+    n = cantidad;
+    return true;
+}
+
+size_t PostingsComprimidos::leerDocumentos(size_t bloque, uint32_t* salida) const {
+    size_t cantidad = min(POSTINGS_POR_BLOQUE, n - bloque * POSTINGS_POR_BLOQUE);
+    const uint8_t* salto = datos + 1 + bloque * BYTES_SALTO;
+    if (desempaquetar(datos, bytes, leerU32(salto + 4), cantidad, salida) == 0) {
+        return 0;
+    }
+    uint32_t anterior = bloque == 0 ? UINT32_MAX : leerU32(salto - BYTES_SALTO);
+    for (size_t i = 0; i < cantidad; ++i) {
+        anterior += salida[i] + 1;
+        salida[i] = anterior;
+    }
+    return anterior == leerU32(salto) ? cantidad : 0;
+}
+
+size_t PostingsComprimidos::leerFrecuencias(size_t bloque, uint32_t* salida) const {
+    if (bloque >= bloques()) {
+        return 0;
+    }
+    size_t cantidad = min(POSTINGS_POR_BLOQUE, n - bloque * POSTINGS_POR_BLOQUE);
+    size_t inicio;
+    if (esMapa()) {
+        inicio = leerU32(datos + 5 + contenedores * BYTES_GRUPO + bloque * sizeof(uint32_t));
+    } else {
+        // Las frecuencias van despues de las diferencias del mismo bloque
+        size_t bloqueInicio = leerU32(datos + 1 + bloque * BYTES_SALTO + 4);
+        if (bloqueInicio >= bytes) {
+            return 0;
+        }
+        inicio = bloqueInicio + 1 + bytesEmpaquetados(cantidad, datos[bloqueInicio]);
+    }
+    if (desempaquetar(datos, bytes, inicio, cantidad, salida) == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < cantidad; ++i) {
+        ++salida[i];
+    }
+    return cantidad;
+}
+
+bool PostingsComprimidos::leerMapa(uint32_t* salida) const {
+    size_t escritos = 0;
+    for (size_t g = 0; g < contenedores; ++g) {
+        const uint8_t* entrada = datos + 5 + g * BYTES_GRUPO;
+        uint32_t alto = leerU32(entrada) << 16;
+        size_t enGrupo = leerU32(entrada + 4);
+        const uint8_t* grupo = datos + leerU32(entrada + 8);
+        if (enGrupo > MAXIMO_ARREGLO_MAPA) {
+            for (size_t p = 0; p < PALABRAS_MAPA; ++p) {
+                for (uint64_t palabra = leerU64(grupo + p * sizeof(uint64_t)); palabra != 0; palabra &= palabra - 1) {
+                    if (escritos == n) {
+                        return false;
+                    }
+                    salida[escritos++] = alto | static_cast<uint32_t>(p * 64 + bitMasBajo(palabra));
+                }
+            }
+        } else {
+            for (size_t i = 0; i < enGrupo; ++i) {
+                salida[escritos++] = alto | leerU16(grupo + i * sizeof(uint16_t));
+            }
+        }
+    }
+    return escritos == n;
+}
+
+bool PostingsComprimidos::descomprimir(vector<uint32_t>& documentos, vector<uint32_t>& frecuencias) const {
+    documentos.resize(n);
+    frecuencias.resize(n);
+    bool valida = true;
+    if (esMapa()) {
+        valida = leerMapa(documentos.data());
+    } else {
+        for (size_t bloque = 0; bloque < bloques() && valida; ++bloque) {
+            valida = leerDocumentos(bloque, documentos.data() + bloque * POSTINGS_POR_BLOQUE) > 0;
+        }
+    }
+    for (size_t bloque = 0; bloque < bloques() && valida; ++bloque) {
+        valida = leerFrecuencias(bloque, frecuencias.data() + bloque * POSTINGS_POR_BLOQUE) > 0;
+    }
+    if (!valida) {
+        documentos.clear();
+        frecuencias.clear();
+    }
+    return valida;
+}
+
+LectorPostings::LectorPostings(const PostingsComprimidos& postings) : lista(&postings), terminado(postings.empty()) {}
+
+bool LectorPostings::avanzarHasta(uint32_t documento) {
+    if (terminado) {
+        return false;
+    }
+    if (iniciado && actual >= documento) {
+        return true;
+    }
+    iniciado = true;
+    bool encontrado = lista->esMapa() ? avanzarMapa(documento) : avanzarBloques(documento);
+    terminado = !encontrado;
+    return encontrado;
+}
+
+bool LectorPostings::avanzarBloques(uint32_t documento) {
+    const uint8_t* saltos = lista->datos + 1;
+    auto ultimo = [&](size_t b) { return leerU32(saltos + b * BYTES_SALTO); };
+    if (bloque == SIZE_MAX || ultimo(bloque) < documento) {
+        // Busqueda binaria en la tabla de saltos: los bloques intermedios no se decodifican
+        size_t bajo = bloque == SIZE_MAX ? 0 : bloque + 1;
+        size_t alto = lista->bloques();
+        while (bajo < alto) {
+            size_t medio = bajo + (alto - bajo) / 2;
+            if (ultimo(medio) < documento) {
+                bajo = medio + 1;
+            } else {
+                alto = medio;
+            }
+        }
+        if (bajo == lista->bloques()) {
+            return false;
+        }
+        bloque = bajo;
+        enBloque = 0;
+        tamanoBloque = lista->leerDocumentos(bloque, documentos);
+        if (tamanoBloque == 0) {
+            return false;
+        }
+    }
+    enBloque = static_cast<size_t>(lower_bound(documentos + enBloque, documentos + tamanoBloque, documento) - documentos);
+    if (enBloque == tamanoBloque) {
+        return false;
+    }
+    actual = documentos[enBloque];
+    rango = bloque * POSTINGS_POR_BLOQUE + enBloque;
+    return true;
+}
+
+bool LectorPostings::avanzarMapa(uint32_t documento) {
+    const uint8_t* tabla = lista->datos + 5;
+    uint32_t claveBuscada = documento >> 16;
+    while (contenedor < lista->contenedores) {
+        const uint8_t* entrada = tabla + contenedor * BYTES_GRUPO;
+        uint32_t clave = leerU32(entrada);
+        size_t enGrupo = leerU32(entrada + 4);
+        if (clave >= claveBuscada) {
+            size_t desde = clave > claveBuscada ? 0 : (documento & 0xFFFF);
+            const uint8_t* grupo = lista->datos + leerU32(entrada + 8);
+            if (enGrupo > MAXIMO_ARREGLO_MAPA) {
+                enContenedor = max(enContenedor, desde / 64);
+                for (; enContenedor < PALABRAS_MAPA; ++enContenedor) {
+                    uint64_t palabra = leerU64(grupo + enContenedor * sizeof(uint64_t));
+                    if (enContenedor == desde / 64) {
+                        palabra &= ~static_cast<uint64_t>(0) << (desde % 64);
+                    }
+                    if (palabra != 0) {
+                        bitActual = bitMasBajo(palabra);
+                        actual = (clave << 16) | static_cast<uint32_t>(enContenedor * 64 + bitActual);
+                        rangoPendiente = true;
+                        return true;
+                    }
+                }
+            } else {
+                size_t bajo = enContenedor;
+                size_t alto = enGrupo;
+                while (bajo < alto) {
+                    size_t medio = bajo + (alto - bajo) / 2;
+                    if (leerU16(grupo + medio * sizeof(uint16_t)) < desde) {
+                        bajo = medio + 1;
+                    } else {
+                        alto = medio;
+                    }
+                }
+                enContenedor = bajo;
+                if (enContenedor < enGrupo) {
+                    actual = (clave << 16) | leerU16(grupo + enContenedor * sizeof(uint16_t));
+                    rango = rangoContenedor + enContenedor;
+                    rangoPendiente = false;
+                    return true;
+                }
+            }
+        }
+        rangoContenedor += enGrupo;
+        ++contenedor;
+        enContenedor = 0;
+        contadas = 0;
+        rangoPalabra = 0;
+    }
+    return false;
+}
+
+void LectorPostings::contarRango() {
+    if (!rangoPendiente) {
+        return;
+    }
+    const uint8_t* grupo = lista->datos + leerU32(lista->datos + 5 + contenedor * BYTES_GRUPO + 8);
+    for (; contadas < enContenedor; ++contadas) {
+        rangoPalabra += contarBits(leerU64(grupo + contadas * sizeof(uint64_t)));
+    }
+    uint64_t anteriores = leerU64(grupo + enContenedor * sizeof(uint64_t)) & ((static_cast<uint64_t>(1) << bitActual) - 1);
+    rango = rangoContenedor + rangoPalabra + contarBits(anteriores);
+    rangoPendiente = false;
+}
+
+size_t LectorPostings::indice() {
+    contarRango();
+    return rango;
+}
+
+uint32_t LectorPostings::frecuencia() {
+    contarRango();
+    if (rango >= lista->n) {  // solo con un mapa dañado
+        return 1;
+    }
+    size_t bloqueActual = rango / POSTINGS_POR_BLOQUE;
+    if (bloqueActual != bloqueFrecuencias) {
+        if (lista->leerFrecuencias(bloqueActual, frecuencias) == 0) {
+            return 1;
+        }
+        bloqueFrecuencias = bloqueActual;
+    }
+    return frecuencias[rango % POSTINGS_POR_BLOQUE];
+}
@@ -0,0 +1,105 @@
+#ifndef POSTINGSCOMPRIMIDOS_H
+#define POSTINGSCOMPRIMIDOS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// Listas de postings comprimidas (IDs crecientes con su frecuencia)
+// Formato por bloques: cada bloque de 128 postings guarda las diferencias entre IDs seguidos y las
+// frecuencias empaquetadas con los bits justos para el valor mas grande del bloque. Una tabla de saltos
+// con el ultimo ID de cada bloque permite ir al bloque de un documento sin decodificar los anteriores.
+// Formato de mapa (roaring) para las palabras muy densas: los IDs se agrupan por sus 16 bits altos y cada
+// grupo es un arreglo de los 16 bits bajos o, con mas de 4096 IDs, un mapa de bits de 8 KiB; ver si un
+// documento esta cuesta lo mismo que leer un bit. Las frecuencias van en bloques de 128 como en el otro formato.
+// Los enteros se guardan en el orden de bytes de la maquina y se leen sin suponer alineacion.
+const size_t POSTINGS_POR_BLOQUE = 128;
+
+// Un grupo del mapa con mas IDs que esto es un mapa de bits (ocupa menos que el arreglo de 16 bits).
+// Una lista usa el formato de mapa si al menos la mitad de sus postings caen en grupos asi de densos.
+const size_t MAXIMO_ARREGLO_MAPA = 4096;
+
+// Agrega al final de 'salida' la lista comprimida. Sin 'frecuencias' se toma una aparicion por documento.
+void comprimirPostings(const uint32_t* documentos, const uint32_t* frecuencias, size_t n, vector<uint8_t>& salida);
+
+// Vista de solo lectura de una lista comprimida (no copia los bytes)
+class PostingsComprimidos {
+private:
+    const uint8_t* datos = nullptr;
+    size_t bytes = 0;
+    size_t n = 0;
+    size_t contenedores = 0;  // grupos del formato de mapa (0 en el formato por bloques)
+
+    friend class LectorPostings;
+    bool esMapa() const;
+    size_t bloques() const { return (n + POSTINGS_POR_BLOQUE - 1) / POSTINGS_POR_BLOQUE; }
+    // Cada una devuelve cuantos postings tiene el bloque o 0 si los bytes estan dañados
+    size_t leerDocumentos(size_t bloque, uint32_t* salida) const;   // formato por bloques
+    size_t leerFrecuencias(size_t bloque, uint32_t* salida) const;  // los dos formatos
+    bool leerMapa(uint32_t* salida) const;
+
+public:
+    PostingsComprimidos() = default;
+
+    // Usa los 'tamano' bytes de la lista de 'cantidad' postings; si la cabecera no cuadra devuelve false y queda vacia
+    bool abrir(const uint8_t* lista, size_t tamano, size_t cantidad);
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    size_t bytesUsados() const { return bytes; }
+
+    // Decodifica la lista entera; devuelve false (y vectores vacios) si esta dañada
+    bool descomprimir(vector<uint32_t>& documentos, vector<uint32_t>& frecuencias) const;
+
+    // Posiciones de la lista, sin comprimir mas que el varint (ver ListaFrecuencias): las asigna el trie
+    const uint32_t* inicioPosiciones = nullptr;
+    const uint8_t* posiciones = nullptr;
+    size_t bytesPosiciones = 0;
+};
+
+// Recorre una lista comprimida hacia adelante. avanzarHasta salta con la tabla de saltos (o los grupos del mapa)
+// y solo decodifica los bloques donde cae, asi que cruzar una lista corta con una larga no lee toda la larga.
+// Las frecuencias de un bloque se decodifican la primera vez que se piden.
+class LectorPostings {
+private:
+    const PostingsComprimidos* lista = nullptr;
+    bool terminado = true;
+    bool iniciado = false;
+    uint32_t actual = 0;
+    size_t rango = 0;  // numero de posting de 'actual'
+    // Formato por bloques
+    size_t bloque = SIZE_MAX;
+    size_t enBloque = 0;
+    size_t tamanoBloque = 0;
+    uint32_t documentos[POSTINGS_POR_BLOQUE];
+    // Formato de mapa. En un mapa de bits el numero de posting cuesta contar los bits anteriores, asi que
+    // se cuenta solo cuando se pide (al filtrar no hace falta)
+    size_t contenedor = 0;
+    size_t rangoContenedor = 0;  // postings de los grupos anteriores
+    size_t enContenedor = 0;     // indice en el arreglo o palabra de 64 bits del mapa
+    size_t contadas = 0;         // palabras del mapa ya sumadas en 'rangoPalabra'
+    size_t rangoPalabra = 0;
+    unsigned bitActual = 0;
+    bool rangoPendiente = false;
+    // Frecuencias del bloque 'bloqueFrecuencias'
+    size_t bloqueFrecuencias = SIZE_MAX;
+    uint32_t frecuencias[POSTINGS_POR_BLOQUE];
+
+    bool avanzarBloques(uint32_t documento);
+    bool avanzarMapa(uint32_t documento);
+    void contarRango();
+
+public:
+    LectorPostings() = default;
+    explicit LectorPostings(const PostingsComprimidos& postings);
+
+    // Deja el lector en el primer documento >= 'documento' (nunca retrocede); false si la lista se acabo
+    bool avanzarHasta(uint32_t documento);
+    uint32_t documento() const { return actual; }
+    size_t indice();
+    uint32_t frecuencia();
+};
+
+#endif // POSTINGSCOMPRIMIDOS_H
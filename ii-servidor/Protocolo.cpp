@@ -0,0 +1,51 @@
+#include "Protocolo.h"
+
+using namespace std;
+
+static uint32_t leerEntero(const char* datos) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(datos);
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+static void escribirEntero(char* destino, uint32_t valor) {
+    destino[0] = static_cast<char>(valor >> 24);
+    destino[1] = static_cast<char>(valor >> 16);
+    destino[2] = static_cast<char>(valor >> 8);
+    destino[3] = static_cast<char>(valor);
+}
+
+size_t leerTrama(const char* datos, size_t n, Trama& trama, uint32_t maximoCuerpo) {
+    if (n < BYTES_CABECERA) {
+        return TRAMA_INCOMPLETA;
+    }
+    uint32_t longitud = leerEntero(datos);
+    if (longitud > maximoCuerpo) {
+        return TRAMA_INVALIDA;
+    }
+    if (n - BYTES_CABECERA < longitud) {
+        return TRAMA_INCOMPLETA;
+    }
+    trama.id = leerEntero(datos + 4);
+    trama.codigo = static_cast<uint8_t>(datos[8]);
+    trama.cuerpo = string_view(datos + BYTES_CABECERA, longitud);
+    return BYTES_CABECERA + longitud;
+}
+
+size_t abrirTrama(string& salida, uint32_t id, uint8_t codigo) {
+    size_t inicio = salida.size();
+    salida.resize(inicio + BYTES_CABECERA);
+    escribirEntero(&salida[inicio + 4], id);
+    salida[inicio + 8] = static_cast<char>(codigo);
+    return inicio;
+}
+
+void cerrarTrama(string& salida, size_t inicio) {
+    escribirEntero(&salida[inicio], static_cast<uint32_t>(salida.size() - inicio - BYTES_CABECERA));
+}
+
+void escribirTrama(string& salida, uint32_t id, uint8_t codigo, string_view cuerpo) {
+    size_t inicio = abrirTrama(salida, id, codigo);
+    salida.append(cuerpo.data(), cuerpo.size());
+    cerrarTrama(salida, inicio);
+}
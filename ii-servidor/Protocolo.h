@@ -0,0 +1,61 @@
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Protocolo binario entre el servidor de consola y sus clientes
+// Todo mensaje es una trama: una cabecera de 9 bytes y un cuerpo de 'longitud' bytes.
+//   longitud (4 bytes) | id (4 bytes) | codigo (1 byte) | cuerpo
+// Los enteros van en orden de red (el byte mas significativo primero).
+// En una peticion el codigo es la operacion y el cuerpo es la consulta (o un comando ADMIN); el id lo elige el
+// cliente y el servidor lo repite en las tramas de la respuesta. Un cliente puede enviar muchas peticiones sin
+// esperar: el servidor las ejecuta en paralelo y responde cada una cuando termina, en cualquier orden.
+// Una respuesta son una o mas tramas con el mismo id: las intermedias llevan ESTADO_PARCIAL y la ultima su
+// estado final. El cuerpo de una respuesta son lineas de texto (un documento por linea o un mensaje); sin
+// documentos el cuerpo va vacio.
+const size_t BYTES_CABECERA = 9;
+const uint32_t MAXIMO_CUERPO_PETICION = 64 * 1024;  // una peticion mas grande se rechaza y se cierra la conexion
+const size_t TAMANO_TROZO = 16 * 1024;  // los resultados largos se envian en tramas de mas o menos este tamaño
+const uint32_t MAXIMO_CUERPO_RESPUESTA = 1024 * 1024;  // un trozo mas una linea: lo que acepta un cliente
+
+enum OperacionProtocolo : uint8_t {
+    OPERACION_CONSULTA = 1,  // los documentos mas relevantes (RESULTADOS_POR_CONSULTA) o un comando ADMIN
+    OPERACION_TODOS = 2      // todos los documentos que cumplen la consulta, por ID
+};
+
+enum EstadoProtocolo : uint8_t {
+    ESTADO_OK = 0,
+    ESTADO_PARCIAL = 1,            // siguen mas tramas de la misma respuesta
+    ESTADO_CONSULTA_INVALIDA = 2,  // el cuerpo es el motivo
+    ESTADO_COMANDO_FALLIDO = 3,    // comando ADMIN desconocido o que no se pudo aplicar; el cuerpo es el mensaje
+    ESTADO_OPERACION_DESCONOCIDA = 4,
+    ESTADO_TRAMA_INVALIDA = 5      // cuerpo demasiado grande: el servidor cierra la conexion despues de enviarla
+};
+
+struct Trama {
+    uint32_t id = 0;
+    uint8_t codigo = 0;
+    string_view cuerpo;  // apunta a los datos que se leyeron
+};
+
+const size_t TRAMA_INCOMPLETA = 0;
+const size_t TRAMA_INVALIDA = SIZE_MAX;
+
+// Lee la trama del inicio de 'datos'. Devuelve los bytes que ocupa, TRAMA_INCOMPLETA si aun no llego entera o
+// TRAMA_INVALIDA si su cuerpo pasa de 'maximoCuerpo'.
+size_t leerTrama(const char* datos, size_t n, Trama& trama, uint32_t maximoCuerpo);
+
+// Agrega una trama completa al final de 'salida'
+void escribirTrama(string& salida, uint32_t id, uint8_t codigo, string_view cuerpo);
+
+// Para armar el cuerpo directamente en 'salida': abrirTrama deja la cabecera (sin la longitud) y devuelve donde
+// empieza; despues de agregar el cuerpo, cerrarTrama escribe la longitud
+size_t abrirTrama(string& salida, uint32_t id, uint8_t codigo);
+void cerrarTrama(string& salida, size_t inicio);
+
+#endif // PROTOCOLO_H
@@ -0,0 +1,257 @@
+#include "Tokenizador.h"
+
+using namespace std;
+
+static array<uint8_t, 256> crearTablaCaracteres() {
+    array<uint8_t, 256> tabla;
+    for (int c = 0; c < 256; ++c) {
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')) {
+            tabla[c] = LETRA;
+        } else if (c >= 'A' && c <= 'Z') {
+            tabla[c] = MAYUSCULA;
+        } else if (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f') {
+            tabla[c] = SEPARADOR;
+        } else if (c >= 0x80) {
+            tabla[c] = NO_ASCII;
+        } else {
+            tabla[c] = DESCARTAR;
+        }
+    }
+    return tabla;
+}
+
+const array<uint8_t, 256> tablaCaracteres = crearTablaCaracteres();
+
+// Lo que queda de un caracter al normalizarlo: una letra se escribe como 'texto' (o tal cual en UTF-8 si
+// 'largo' es 0); un separador o un signo no escriben nada
+struct Plegado {
+    uint8_t clase;
+    uint8_t largo;
+    char texto[2];
+};
+
+struct RangoPlegado {
+    uint16_t desde, hasta;
+    const char* texto;
+};
+
+// Letras latinas con tilde, dieresis u otra marca y ligaduras (Latin-1 y Latin Extended-A), en minuscula
+// ASCII. Los demas caracteres de Latin-1 son signos, salvo los ordinales y los superindices.
+static const RangoPlegado rangosLatinos[] = {
+    {0x00AA, 0x00AA, "a"},  {0x00B2, 0x00B2, "2"},  {0x00B3, 0x00B3, "3"},  {0x00B9, 0x00B9, "1"},  {0x00BA, 0x00BA, "o"},
+    {0x00C0, 0x00C5, "a"},  {0x00C6, 0x00C6, "ae"}, {0x00C7, 0x00C7, "c"},  {0x00C8, 0x00CB, "e"},  {0x00CC, 0x00CF, "i"},
+    {0x00D0, 0x00D0, "d"},  {0x00D1, 0x00D1, "n"},  {0x00D2, 0x00D6, "o"},  {0x00D8, 0x00D8, "o"},  {0x00D9, 0x00DC, "u"},
+    {0x00DD, 0x00DD, "y"},  {0x00DE, 0x00DE, "th"}, {0x00DF, 0x00DF, "ss"}, {0x00E0, 0x00E5, "a"},  {0x00E6, 0x00E6, "ae"},
+    {0x00E7, 0x00E7, "c"},  {0x00E8, 0x00EB, "e"},  {0x00EC, 0x00EF, "i"},  {0x00F0, 0x00F0, "d"},  {0x00F1, 0x00F1, "n"},
+    {0x00F2, 0x00F6, "o"},  {0x00F8, 0x00F8, "o"},  {0x00F9, 0x00FC, "u"},  {0x00FD, 0x00FD, "y"},  {0x00FE, 0x00FE, "th"},
+    {0x00FF, 0x00FF, "y"},  {0x0100, 0x0105, "a"},  {0x0106, 0x010D, "c"},  {0x010E, 0x0111, "d"},  {0x0112, 0x011B, "e"},
+    {0x011C, 0x0123, "g"},  {0x0124, 0x0127, "h"},  {0x0128, 0x0131, "i"},  {0x0132, 0x0133, "ij"}, {0x0134, 0x0135, "j"},
+    {0x0136, 0x0138, "k"},  {0x0139, 0x0142, "l"},  {0x0143, 0x014B, "n"},  {0x014C, 0x0151, "o"},  {0x0152, 0x0153, "oe"},
+    {0x0154, 0x0159, "r"},  {0x015A, 0x0161, "s"},  {0x0162, 0x0167, "t"},  {0x0168, 0x0173, "u"},  {0x0174, 0x0175, "w"},
+    {0x0176, 0x0178, "y"},  {0x0179, 0x017E, "z"},  {0x017F, 0x017F, "s"},
+};
+
+// Hasta Latin Extended-B; las letras de ese bloque que no estan en los rangos se dejan como estan
+static const uint32_t FIN_TABLA_LATINA = 0x250;
+
+static array<Plegado, FIN_TABLA_LATINA> crearTablaLatina() {
+    array<Plegado, FIN_TABLA_LATINA> tabla{};
+    for (uint32_t codigo = 0; codigo < FIN_TABLA_LATINA; ++codigo) {
+        Plegado& plegado = tabla[codigo];
+        if (codigo < 0x80) {
+            uint8_t clase = tablaCaracteres[codigo];
+            plegado.clase = clase == MAYUSCULA ? static_cast<uint8_t>(LETRA) : clase;
+            plegado.largo = clase == LETRA || clase == MAYUSCULA ? 1 : 0;
+            plegado.texto[0] = static_cast<char>(clase == MAYUSCULA ? codigo + ('a' - 'A') : codigo);
+        } else if (codigo == 0x85 || codigo == 0xA0) {
+            plegado.clase = SEPARADOR;  // siguiente linea y espacio duro
+        } else if (codigo < 0x180) {
+            plegado.clase = DESCARTAR;
+        } else {
+            plegado.clase = LETRA;
+        }
+    }
+    for (const RangoPlegado& rango : rangosLatinos) {
+        for (uint32_t codigo = rango.desde; codigo <= rango.hasta; ++codigo) {
+            Plegado& plegado = tabla[codigo];
+            plegado.clase = LETRA;
+            plegado.largo = static_cast<uint8_t>(rango.texto[1] == '\0' ? 1 : 2);
+            plegado.texto[0] = rango.texto[0];
+            plegado.texto[1] = rango.texto[1];
+        }
+    }
+    return tabla;
+}
+
+static const array<Plegado, FIN_TABLA_LATINA> tablaLatina = crearTablaLatina();
+
+// Caracteres de los bytes 0x80 a 0x9F en Windows-1252 (los que no tiene quedan como control, que se descarta);
+// de 0xA0 a 0xFF coincide con Latin-1
+static const uint16_t windows1252[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+static bool esContinuacion(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+// Decodifica el caracter UTF-8 que empieza en 'p' y devuelve su largo, o 0 si la secuencia no es valida
+// (incompleta, demasiado larga para el valor o un sustituto)
+static size_t decodificarUtf8(const unsigned char* p, size_t n, uint32_t& codigo) {
+    unsigned char c = p[0];
+    if (c >= 0xC2 && c <= 0xDF) {
+        if (n >= 2 && esContinuacion(p[1])) {
+            codigo = (uint32_t(c & 0x1F) << 6) | (p[1] & 0x3F);
+            return 2;
+        }
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        if (n >= 3 && esContinuacion(p[1]) && esContinuacion(p[2])) {
+            codigo = (uint32_t(c & 0x0F) << 12) | (uint32_t(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+            return codigo >= 0x800 && (codigo < 0xD800 || codigo > 0xDFFF) ? 3 : 0;
+        }
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        if (n >= 4 && esContinuacion(p[1]) && esContinuacion(p[2]) && esContinuacion(p[3])) {
+            codigo = (uint32_t(c & 0x07) << 18) | (uint32_t(p[1] & 0x3F) << 12) | (uint32_t(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+            return codigo >= 0x10000 && codigo <= 0x10FFFF ? 4 : 0;
+        }
+    }
+    return 0;
+}
+
+static void escribirUtf8(char*& salida, uint32_t codigo) {
+    if (codigo < 0x800) {
+        *salida++ = static_cast<char>(0xC0 | (codigo >> 6));
+    } else if (codigo < 0x10000) {
+        *salida++ = static_cast<char>(0xE0 | (codigo >> 12));
+        *salida++ = static_cast<char>(0x80 | ((codigo >> 6) & 0x3F));
+    } else {
+        *salida++ = static_cast<char>(0xF0 | (codigo >> 18));
+        *salida++ = static_cast<char>(0x80 | ((codigo >> 12) & 0x3F));
+        *salida++ = static_cast<char>(0x80 | ((codigo >> 6) & 0x3F));
+    }
+    *salida++ = static_cast<char>(0x80 | (codigo & 0x3F));
+}
+
+// Puntuacion general (U+2000 a U+206F): los espacios, las rayas y los puntos suspensivos separan palabras
+static uint8_t clasePuntuacion(uint32_t codigo) {
+    if (codigo <= 0x200A || (codigo >= 0x2013 && codigo <= 0x2015) || codigo == 0x2026 || codigo == 0x2028 || codigo == 0x2029 ||
+        codigo == 0x202F || codigo == 0x205F) {
+        return SEPARADOR;
+    }
+    return DESCARTAR;
+}
+
+// Simbolos, flechas, emojis, uso privado, selectores de variante y marcas de orden: se descartan como los signos
+static bool esSimbolo(uint32_t codigo) {
+    return (codigo >= 0x2070 && codigo <= 0x2BFF) || (codigo >= 0x3001 && codigo <= 0x303F) || (codigo >= 0xE000 && codigo <= 0xF8FF) ||
+           (codigo >= 0xFE00 && codigo <= 0xFE0F) || codigo == 0xFEFF || codigo == 0xFFFD || (codigo >= 0x1F000 && codigo <= 0x1FAFF);
+}
+
+// Escribe en 'salida' el caracter normalizado (a lo mas el doble de los bytes que ocupaba en el texto) y
+// devuelve su clase (LETRA, DESCARTAR o SEPARADOR)
+static uint8_t plegarCodigo(uint32_t codigo, char*& salida) {
+    if (codigo < FIN_TABLA_LATINA) {
+        const Plegado& plegado = tablaLatina[codigo];
+        if (plegado.clase != LETRA) {
+            return plegado.clase;
+        }
+        if (plegado.largo > 0) {
+            salida[0] = plegado.texto[0];
+            salida[1] = plegado.texto[1];
+            salida += plegado.largo;
+            return LETRA;
+        }
+    } else if (codigo >= 0x300 && codigo <= 0x36F) {
+        return DESCARTAR;  // marcas combinables: una "a" seguida de un acento suelto queda como "a"
+    } else if (codigo >= 0x391 && codigo <= 0x3AB) {
+        codigo += 0x20;  // mayusculas griegas
+    } else if (codigo >= 0x400 && codigo <= 0x40F) {
+        codigo += 0x50;  // mayusculas cirilicas
+    } else if (codigo >= 0x410 && codigo <= 0x42F) {
+        codigo += 0x20;
+    } else if (codigo >= 0x2000 && codigo <= 0x206F) {
+        return clasePuntuacion(codigo);
+    } else if (codigo == 0x3000) {
+        return SEPARADOR;  // espacio ideografico
+    } else if (codigo >= 0xFF01 && codigo <= 0xFF5E) {
+        return plegarCodigo(codigo - 0xFEE0, salida);  // ASCII de ancho completo
+    } else if (esSimbolo(codigo)) {
+        return DESCARTAR;
+    }
+    escribirUtf8(salida, codigo);
+    return LETRA;
+}
+
+// Cada byte ASCII en minuscula, o 0 si es un signo
+static array<char, 128> crearTablaMinusculas() {
+    array<char, 128> tabla{};
+    for (int c = 0; c < 128; ++c) {
+        if (tablaCaracteres[c] == LETRA) {
+            tabla[c] = static_cast<char>(c);
+        } else if (tablaCaracteres[c] == MAYUSCULA) {
+            tabla[c] = static_cast<char>(c + ('a' - 'A'));
+        }
+    }
+    return tabla;
+}
+
+static const array<char, 128> tablaMinusculas = crearTablaMinusculas();
+
+size_t Tokenizador::armarPalabra(const unsigned char* datos, size_t i, size_t fin) {
+    if (buffer.size() < 2 * (fin - i)) {
+        buffer.resize(2 * (fin - i));
+    }
+    char* salida = &buffer[0];
+    while (i < fin) {
+        unsigned char c = datos[i];
+        if (c < 0x80) {
+            char minuscula = tablaMinusculas[c];
+            *salida = minuscula;
+            salida += minuscula != 0;
+            ++i;
+            continue;
+        }
+        uint32_t codigo;
+        size_t largo = decodificarUtf8(datos + i, fin - i, codigo);
+        if (largo == 0) {
+            codigo = c < 0xA0 ? windows1252[c - 0x80] : c;
+            largo = 1;
+        }
+        i += largo;
+        if (plegarCodigo(codigo, salida) == SEPARADOR) {
+            break;
+        }
+    }
+    largoPalabra = static_cast<size_t>(salida - buffer.data());
+    return i;
+}
+
+unordered_set<string> normalizarPalabras(const unordered_set<string>& palabras) {
+    unordered_set<string> normalizadas;
+    Tokenizador tokenizador;
+    for (const string& palabra : palabras) {
+        tokenizador.tokenizar(palabra, [&](string_view normalizada) {
+            normalizadas.emplace(normalizada);
+        });
+    }
+    return normalizadas;
+}
+
+vector<string_view> dividirEnFragmentos(string_view texto, size_t tamano) {
+    vector<string_view> fragmentos;
+    size_t inicio = 0;
+    while (inicio < texto.size()) {
+        size_t fin = inicio + tamano;
+        if (fin >= texto.size()) {
+            fin = texto.size();
+        } else {
+            while (fin < texto.size() && tablaCaracteres[static_cast<unsigned char>(texto[fin])] != SEPARADOR) {
+                ++fin;
+            }
+        }
+        fragmentos.push_back(texto.substr(inicio, fin - inicio));
+        inicio = fin;
+    }
+    return fragmentos;
+}
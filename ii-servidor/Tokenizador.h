@@ -0,0 +1,195 @@
+#ifndef TOKENIZADOR_H
+#define TOKENIZADOR_H
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define TOKENIZADOR_SIMD 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Clase de cada byte del texto
+enum ClaseCaracter : uint8_t {
+    SEPARADOR,  // espacio, tabulador o salto de linea: termina la palabra
+    LETRA,      // minuscula o digito ASCII: forma parte de la palabra tal cual
+    DESCARTAR,  // signo de puntuacion u otro byte: se elimina sin separar la palabra
+    MAYUSCULA,  // mayuscula ASCII: forma parte de la palabra en minuscula
+    NO_ASCII    // inicio de un caracter UTF-8 (o un byte de Windows-1252): se decodifica y se pliega
+};
+
+// Tabla de clasificacion de los 256 valores de un byte
+extern const array<uint8_t, 256> tablaCaracteres;
+
+// Tokenizador de una sola pasada
+// Recorre el texto original y entrega cada palabra como string_view, sin copiar el texto ni
+// reservar memoria por palabra. Las palabras se normalizan igual al indexar y al consultar:
+// en minusculas y sin tildes ("Líder" y "LIDER" son "lider"), con la ñ como n y las ligaduras
+// separadas (æ, œ, ß). El texto puede estar en UTF-8 o en Windows-1252: un byte que no inicia
+// una secuencia UTF-8 valida se lee como Windows-1252. Las rayas, los puntos suspensivos y los
+// espacios de Unicode separan palabras; los demas signos (¿, ¡, «, », comillas) se eliminan.
+// Solo cuando hay que cambiar algo ("Dónde", "do-nde") la palabra se arma en un buffer que se
+// reutiliza. La vista es valida durante la llamada a 'emitir'.
+class Tokenizador {
+private:
+    string buffer;
+    size_t largoPalabra = 0;  // bytes de la palabra armada en 'buffer'
+
+    // Arma en 'buffer' la palabra normalizada que empieza en 'i' y termina en 'fin' (donde hay un separador
+    // ASCII) o antes, en un separador de Unicode; devuelve la posicion despues de la palabra
+    size_t armarPalabra(const unsigned char* datos, size_t i, size_t fin);
+
+    // Entrega las palabras de texto[i, fin), un tramo sin separadores ASCII
+    template <typename Emitir>
+    void armarTramo(string_view texto, size_t i, size_t fin, Emitir& emitir) {
+        const unsigned char* datos = reinterpret_cast<const unsigned char*>(texto.data());
+        while (i < fin) {
+            i = armarPalabra(datos, i, fin);
+            if (largoPalabra > 0) {
+                emitir(string_view(buffer.data(), largoPalabra));
+            }
+        }
+    }
+
+    // Primera posicion desde 'i' que no es una minuscula o un digito ASCII
+    static size_t finLetras(const unsigned char* datos, size_t i, size_t n) {
+        while (i < n && tablaCaracteres[datos[i]] == LETRA) {
+            ++i;
+        }
+        return i;
+    }
+
+    // Entrega las palabras de texto[i, n) de a un byte por vez
+    template <typename Emitir>
+    void tokenizarEscalar(string_view texto, size_t i, size_t n, Emitir& emitir) {
+        const unsigned char* datos = reinterpret_cast<const unsigned char*>(texto.data());
+        while (i < n) {
+            while (i < n && (tablaCaracteres[datos[i]] == SEPARADOR || tablaCaracteres[datos[i]] == DESCARTAR)) {
+                ++i;
+            }
+            if (i == n) {
+                break;
+            }
+            size_t inicio = i;
+            i = finLetras(datos, i, n);
+            if (i > inicio && (i == n || tablaCaracteres[datos[i]] == SEPARADOR)) {
+                emitir(texto.substr(inicio, i - inicio));
+                continue;
+            }
+            // Hay mayusculas, letras fuera de ASCII o signos dentro de la palabra: se arma normalizada
+            while (i < n && tablaCaracteres[datos[i]] != SEPARADOR) {
+                ++i;
+            }
+            armarTramo(texto, inicio, i, emitir);
+        }
+    }
+
+#ifdef TOKENIZADOR_SIMD
+    // Un bit por byte de un bloque de 64: letras y digitos ASCII, separadores ASCII y bytes >= 0x80; los demas
+    // son signos ASCII. 'minusculas' es el bloque con las mayusculas ASCII ya en minuscula.
+    struct MascarasBloque {
+        uint64_t letras, separadores, noAscii;
+        alignas(16) char minusculas[64];
+    };
+
+    static void clasificarBloque(const unsigned char* datos, MascarasBloque& mascaras) {
+        // Comparaciones con signo: los bytes >= 0x80 son negativos y nunca quedan dentro de los rangos
+        const __m128i antesA = _mm_set1_epi8('a' - 1), despuesZ = _mm_set1_epi8('z' + 1);
+        const __m128i antes0 = _mm_set1_epi8('0' - 1), despues9 = _mm_set1_epi8('9' + 1);
+        const __m128i antesMayuscula = _mm_set1_epi8('A' - 1), despuesMayuscula = _mm_set1_epi8('Z' + 1);
+        const __m128i antesTab = _mm_set1_epi8('\t' - 1), despuesCr = _mm_set1_epi8('\r' + 1), espacio = _mm_set1_epi8(' ');
+        const __m128i diferencia = _mm_set1_epi8('a' - 'A');
+        mascaras.letras = mascaras.separadores = mascaras.noAscii = 0;
+        for (int parte = 0; parte < 4; ++parte) {
+            __m128i bloque = _mm_loadu_si128(reinterpret_cast<const __m128i*>(datos + 16 * parte));
+            __m128i minusculas = _mm_and_si128(_mm_cmpgt_epi8(bloque, antesA), _mm_cmplt_epi8(bloque, despuesZ));
+            __m128i digitos = _mm_and_si128(_mm_cmpgt_epi8(bloque, antes0), _mm_cmplt_epi8(bloque, despues9));
+            __m128i mayusculas = _mm_and_si128(_mm_cmpgt_epi8(bloque, antesMayuscula), _mm_cmplt_epi8(bloque, despuesMayuscula));
+            __m128i separadores = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(bloque, antesTab), _mm_cmplt_epi8(bloque, despuesCr)),
+                                               _mm_cmpeq_epi8(bloque, espacio));
+            _mm_store_si128(reinterpret_cast<__m128i*>(mascaras.minusculas + 16 * parte),
+                            _mm_add_epi8(bloque, _mm_and_si128(mayusculas, diferencia)));
+            __m128i letras = _mm_or_si128(_mm_or_si128(minusculas, mayusculas), digitos);
+            int desplazamiento = 16 * parte;
+            mascaras.letras |= uint64_t(static_cast<unsigned>(_mm_movemask_epi8(letras))) << desplazamiento;
+            mascaras.separadores |= uint64_t(static_cast<unsigned>(_mm_movemask_epi8(separadores))) << desplazamiento;
+            mascaras.noAscii |= uint64_t(static_cast<unsigned>(_mm_movemask_epi8(bloque))) << desplazamiento;
+        }
+    }
+#endif
+
+public:
+    template <typename Emitir>
+    void tokenizar(string_view texto, Emitir&& emitir) {
+        size_t i = 0;
+#ifdef TOKENIZADOR_SIMD
+        // De a 64 bytes: cada tramo entre separadores ASCII que tiene una sola corrida de letras y digitos
+        // ASCII, rodeada a lo mas de signos ASCII ("hola", "(Hola),"), se entrega con operaciones de bits y
+        // desde la copia del bloque en minusculas, sin mirar byte por byte. Los demas tramos (tildes, "do-nde")
+        // se resuelven uno por uno. El tramo que sigue en el bloque siguiente se vuelve a leer desde su inicio.
+        const unsigned char* datos = reinterpret_cast<const unsigned char*>(texto.data());
+        size_t n = texto.size();
+        MascarasBloque mascaras;
+        while (i + 64 <= n) {
+            clasificarBloque(datos + i, mascaras);
+            uint64_t palabras = ~mascaras.separadores;
+            uint64_t inicios = palabras & ~(palabras << 1);
+            uint64_t finales = palabras & ~(palabras >> 1);
+            if (palabras >> 63) {
+                finales &= ~(uint64_t(1) << 63);  // el ultimo tramo puede seguir en el bloque siguiente
+            }
+            size_t siguiente = i + 64;
+            while (inicios != 0) {
+                unsigned desde = static_cast<unsigned>(__builtin_ctzll(inicios));
+                uint64_t finesDesde = finales >> desde << desde;
+                if (finesDesde == 0) {
+                    siguiente = i + desde;  // tramo incompleto
+                    break;
+                }
+                unsigned hasta = static_cast<unsigned>(__builtin_ctzll(finesDesde)) + 1;
+                uint64_t tramo = ((uint64_t(1) << hasta) - 1) & ~((uint64_t(1) << desde) - 1);
+                inicios &= inicios - 1;
+                if ((mascaras.noAscii & tramo) == 0) {
+                    uint64_t letras = mascaras.letras & tramo;
+                    if (letras == 0) {
+                        continue;  // solo signos
+                    }
+                    unsigned primera = static_cast<unsigned>(__builtin_ctzll(letras));
+                    uint64_t corrida = letras >> primera;
+                    if ((corrida & (corrida + 1)) == 0) {
+                        emitir(string_view(mascaras.minusculas + primera, 64 - static_cast<unsigned>(__builtin_clzll(letras)) - primera));
+                        continue;
+                    }
+                }
+                armarTramo(texto, i + desde, i + hasta, emitir);
+            }
+            if (siguiente == i) {
+                // Un tramo de 64 bytes o mas: se resuelve entero hasta su separador
+                size_t fin = i + 64;
+                while (fin < n && tablaCaracteres[datos[fin]] != SEPARADOR) {
+                    ++fin;
+                }
+                tokenizarEscalar(texto, i, fin, emitir);
+                siguiente = fin;
+            }
+            i = siguiente;
+        }
+#endif
+        tokenizarEscalar(texto, i, texto.size(), emitir);
+    }
+};
+
+// Las palabras de 'palabras' normalizadas como las del texto (para las palabras vacias, que vienen de un archivo)
+unordered_set<string> normalizarPalabras(const unordered_set<string>& palabras);
+
+// Divide el texto en fragmentos de al menos 'tamano' bytes; cada corte se hace en un separador
+// para que ninguna palabra quede partida entre dos fragmentos
+vector<string_view> dividirEnFragmentos(string_view texto, size_t tamano);
+
+#endif // TOKENIZADOR_H
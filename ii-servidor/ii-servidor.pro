@@ -10,12 +10,39 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    AutomataLevenshtein.cpp \
+    ArchivoIndice.cpp \
+    ArchivoMapeado.cpp \
+    CacheConsultas.cpp \
+    Consulta.cpp \
+    DobleArreglo.cpp \
+    HistogramaLatencias.cpp \
     IndiceInvertido.cpp \
+    IndicePublicado.cpp \
+    ListasOrdenadas.cpp \
+    Metricas.cpp \
+    PoolHilos.cpp \
+    PostingsComprimidos.cpp \
+    Tokenizador.cpp \
     main.cpp \
     widget.cpp
 
 HEADERS += \
+    AutomataLevenshtein.h \
+    ArchivoIndice.h \
+    ArchivoMapeado.h \
+    CacheConsultas.h \
+    Compartido.h \
+    Consulta.h \
+    DobleArreglo.h \
+    HistogramaLatencias.h \
     IndiceInvertido.h \
+    IndicePublicado.h \
+    ListasOrdenadas.h \
+    Metricas.h \
+    PoolHilos.h \
+    PostingsComprimidos.h \
+    Tokenizador.h \
     widget.h
 
 FORMS += \
@@ -1,5 +1,6 @@
 #include "widget.h"
 #include "ui_widget.h"
+#include "ArchivoIndice.h"
 #include <QHostAddress>
 #include <QNetworkInterface>
 #include <QMessageBox>
@@ -7,13 +8,41 @@
 #include <QStringList>
 #include <QMetaObject>
 #include <QMetaMethod>
+#include <QTextCursor>
+#include <QScrollBar>
+#include <chrono>
+
+const int MILISEGUNDOS_REGISTRO = 100;  // cada cuánto se escriben en el log las líneas acumuladas
+const int MAXIMO_LINEAS_TANDA = 200;  // las demás se cuentan pero no se muestran
+const int MAXIMO_LINEAS_LOG = 5000;  // el log descarta las líneas más viejas
+const int MILISEGUNDOS_AVANCE = 500;  // cada cuánto se informa el avance de la construcción del índice
+const int MILISEGUNDOS_METRICAS = 15000;  // cada cuánto se escriben las métricas en 'metricas.prom'
 
 Widget::Widget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
     , server(new QTcpServer(this))  // Se crea un nuevo servidor TCP
+    , temporizadorRegistro(new QTimer(this))
+    , temporizadorMetricas(new QTimer(this))
 {
     ui->setupUi(this);
+    ui->log->document()->setMaximumBlockCount(MAXIMO_LINEAS_LOG);
+
+    // Las respuestas llegan desde los hilos del pool y se envían en el hilo de la interfaz, dueño de los sockets
+    connect(this, &Widget::consultaTerminada, this, &Widget::terminarConsulta, Qt::QueuedConnection);
+    temporizadorRegistro->setSingleShot(true);
+    temporizadorRegistro->setInterval(MILISEGUNDOS_REGISTRO);
+    connect(temporizadorRegistro, &QTimer::timeout, this, &Widget::vaciarRegistro);
+    connect(this, &Widget::avanceIndexado, this, &Widget::mostrarAvance, Qt::QueuedConnection);
+    connect(this, &Widget::indiceTerminado, this, &Widget::terminarIndice, Qt::QueuedConnection);
+
+    // Los comandos de administración las leen desde el pool, así que se fijan aquí y no cambian
+    carpetaTextos = QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("textos").toStdString();
+    rutaIndice = carpetaTextos + "/indice.iidx";
+    rutaMetricas = QDir(QCoreApplication::applicationDirPath()).absoluteFilePath("metricas.prom").toStdString();
+    temporizadorMetricas->setInterval(MILISEGUNDOS_METRICAS);
+    connect(temporizadorMetricas, &QTimer::timeout, this, &Widget::guardarMetricas);
+    temporizadorMetricas->start();
 
     QString ip = obtenerDireccionIP();  // Obtiene la IP local
     ui->ip->setText(ip);  // Muestra la IP en el campo correspondiente
@@ -22,6 +51,8 @@ Widget::Widget(QWidget *parent)
 
 
 Widget::~Widget() {
+    pool.waitForDone();  // Ninguna consulta puede seguir usando el índice ni emitir señales después de esto
+    guardarMetricas();  // Las últimas, con las consultas que terminaron recién
     if (server && server->isListening()) {
         detenerServidor();  // Detiene el servidor si está en ejecución antes de destruirlo
     }
@@ -52,7 +83,7 @@ void Widget::on_limpiarlog_clicked() {
 
 void Widget::iniciarServidor(quint16 puerto) {
     if (server->isListening()) {
-        ui->log->append("El servidor ya está en ejecución.");  // Mensaje si el servidor ya está en ejecución
+        registrar("El servidor ya está en ejecución.");  // Mensaje si el servidor ya está en ejecución
         return;
     }
 
@@ -60,9 +91,9 @@ void Widget::iniciarServidor(quint16 puerto) {
 
     // Intenta iniciar el servidor en la IP y puerto especificados
     if (!server->listen(QHostAddress(ip), puerto)) {
-        ui->log->append("No se pudo iniciar el servidor: " + server->errorString());  // Mensaje de error si no se pudo iniciar el servidor
+        registrar("No se pudo iniciar el servidor: " + server->errorString());  // Mensaje de error si no se pudo iniciar el servidor
     } else {
-        ui->log->append("Servidor iniciado en " + ip + ":" + QString::number(puerto));  // Mensaje indicando que el servidor está en ejecución
+        registrar("Servidor iniciado en " + ip + ":" + QString::number(puerto));  // Mensaje indicando que el servidor está en ejecución
         connect(server, &QTcpServer::newConnection, this, &Widget::manejarConexion);  // Conecta la señal de nueva conexión a la función correspondiente
 
         // Obtener la ruta del directorio del ejecutable
@@ -75,15 +106,20 @@ void Widget::iniciarServidor(quint16 puerto) {
             return;
         }
 
-        // Cargamos la lista de palabras vacías
+        if (indexando) {
+            registrar("El índice se sigue construyendo.");  // Lo deja listo la construcción que está en curso
+            return;
+        }
+
+        // Cargamos la lista de palabras vacías (pasa a 'stopWords' junto con el índice)
         string nombreStopWord = "stop_words_spanish.txt";
         string pathStopWords = textosPath.toStdString() + "/"+nombreStopWord;
         std::ifstream archivoEntrada(pathStopWords);
-        std::unordered_set<std::string> stopWords;
+        std::unordered_set<std::string> palabrasVacias;
         if (archivoEntrada.is_open()) {
             std::string palabra;
             while (std::getline(archivoEntrada, palabra)) {
-                stopWords.insert(palabra);
+                palabrasVacias.insert(palabra);
             }
         } else {
             QString mensajeError = "El archivo '"+QString::fromStdString(nombreStopWord)+"' no se encuentra en la carpeta 'textos'.";
@@ -110,73 +146,246 @@ void Widget::iniciarServidor(quint16 puerto) {
             nombreArchivo = textosPath.toStdString() + "/" + nombreArchivo;
         }
 
-        crearIndiceInvertido(nombresArchivos, trie, stopWords);  // Carga los archivos en el índice invertido
-        ui->log->append("Índice invertido cargado correctamente.");  // Mensaje indicando que el índice invertido se ha cargado
+        // Usa el índice guardado en 'textos' si sigue vigente; si no, lo construye (con un hilo por núcleo) y lo
+        // guarda para el próximo arranque. Se arma aparte en el pool y se publica solo cuando está completo;
+        // mientras tanto los clientes reciben "Índice cargando".
+        indiceListo = false;
+        indexando = true;
+        archivosIndexados = 0;
+        archivosPorIndexar = nombresArchivos.size();
+        registrar("Cargando el índice invertido...");
+        pool.start([this, nombresArchivos, palabrasVacias]() mutable {
+            OpcionesIndexado opciones;
+            opciones.posiciones = true;  // Permite consultas de frase ("trabajo en equipo")
+            opciones.progreso = [this, ultimoAviso = std::chrono::steady_clock::time_point()](const ProgresoIndexado& progreso) mutable {
+                archivosIndexados = progreso.archivosTerminados;
+                auto ahora = std::chrono::steady_clock::now();
+                bool ultimo = progreso.archivosTerminados == progreso.archivosTotales;
+                if (!ultimo && ahora - ultimoAviso < std::chrono::milliseconds(MILISEGUNDOS_AVANCE)) {
+                    return;
+                }
+                ultimoAviso = ahora;
+                double palabrasPorSegundo = progreso.segundos > 0 ? progreso.palabras / progreso.segundos : 0;
+                double segundosRestantes = -1;  // se estima por los bytes que faltan leer al ritmo que se llevan
+                if (progreso.bytesLeidos > 0 && progreso.bytesTotales >= progreso.bytesLeidos) {
+                    segundosRestantes = progreso.segundos * (progreso.bytesTotales - progreso.bytesLeidos) / progreso.bytesLeidos;
+                }
+                emit avanceIndexado(static_cast<int>(progreso.archivosTerminados), static_cast<int>(progreso.archivosTotales),
+                                    palabrasPorSegundo, segundosRestantes);
+            };
+
+            auto version = std::make_shared<VersionIndice>();
+            opciones.metricas = &version->construccion;  // Se publican con el índice (STATS)
+            bool cargado = cargarOCrearIndice(rutaIndice, nombresArchivos, version->trie, version->documentos, palabrasVacias, opciones);
+            version->stopWords = std::make_shared<const std::unordered_set<std::string>>(std::move(palabrasVacias));  // ya normalizadas
+            indice.publicar(std::move(version));  // Las consultas que ya fijaron la versión anterior terminan con ella
+            cache.vaciar();
+            indiceListo = true;
+            emit indiceTerminado(cargado, QString::fromStdString(rutaIndice));
+        });
     }
 }
 
 void Widget::detenerServidor() {
     if (!server->isListening()) {
-        ui->log->append("No hay servidor en ejecución.");  // Mensaje si no hay servidor en ejecución
+        registrar("No hay servidor en ejecución.");  // Mensaje si no hay servidor en ejecución
         return;
     }
 
     // Cerrar todas las conexiones activas de los clientes
-    for (QTcpSocket* socket : clientesSockets) {
+    const QList<QTcpSocket*> sockets = clientes.keys();  // manejarDesconexion los va sacando de 'clientes'
+    for (QTcpSocket* socket : sockets) {
         socket->disconnectFromHost();  // Desconecta el socket del host
         socket->waitForDisconnected();  // Espera a que la desconexión se complete
     }
 
     server->close();  // Cierra el servidor
-    ui->log->append("Servidor detenido.");  // Mensaje indicando que el servidor se ha detenido
+    registrar("Servidor detenido.");  // Mensaje indicando que el servidor se ha detenido
 }
 
 void Widget::manejarConexion() {
     QTcpSocket *nuevoClienteSocket = server->nextPendingConnection();  // Obtiene el siguiente cliente que se conecta
     connect(nuevoClienteSocket, &QTcpSocket::readyRead, this, &Widget::manejarDatos);  // Conecta la señal de datos listos a la función correspondiente
     connect(nuevoClienteSocket, &QTcpSocket::disconnected, this, &Widget::manejarDesconexion);  // Conecta la señal de desconexión a la función correspondiente
-    clientesSockets.append(nuevoClienteSocket);  // Añade el nuevo socket a la lista de clientes
-    ui->log->append("Nuevo cliente conectado.");  // Mensaje indicando que un nuevo cliente se ha conectado
+    clientes[nuevoClienteSocket].id = ++siguienteCliente;  // Añade el nuevo socket a los clientes activos
+    registrar("Nuevo cliente conectado.");  // Mensaje indicando que un nuevo cliente se ha conectado
 }
 
 void Widget::manejarDatos() {
     QTcpSocket* clienteSocket = qobject_cast<QTcpSocket*>(sender());  // Obtiene el socket del cliente que envía los datos
-    if (!clienteSocket) {
+    if (!clienteSocket || !clientes.contains(clienteSocket)) {
         return;  // Si el socket es nulo, no hace nada
     }
 
     QByteArray datos = clienteSocket->readAll();  // Lee todos los datos del socket
     QString consulta = QString(datos).trimmed();  // Convierte los datos a QString y elimina espacios en blanco
 
-    ui->log->append("Datos recibidos: " + consulta);  // Muestra los datos recibidos en el log
+    registrar("Datos recibidos: " + consulta);  // Muestra los datos recibidos en el log
+
+    // La consulta se ejecuta en el pool; si el cliente ya tiene una en curso espera su turno para responder en orden
+    clientes[clienteSocket].pendientes.push_back(consulta.toStdString());
+    despachar(clienteSocket);
+}
+
+void Widget::despachar(QTcpSocket* socket) {
+    auto cliente = clientes.find(socket);
+    if (cliente == clientes.end() || cliente->ocupado || cliente->pendientes.empty()) {
+        return;
+    }
+    std::string consulta = std::move(cliente->pendientes.front());
+    cliente->pendientes.pop_front();
+    cliente->ocupado = true;
+    quint64 conexion = cliente->id;
+    pool.start([this, socket, conexion, consulta]() {
+        QStringList registro;
+        QByteArray respuesta = ejecutarConsulta(consulta, registro);
+        emit consultaTerminada(socket, conexion, respuesta, registro);  // En cola: el socket solo se toca en su hilo
+    });
+}
+
+QByteArray Widget::ejecutarConsulta(const std::string& consulta, QStringList& registro) {
+    auto inicio = MetricasConsultas::empezar();
+    std::string mensaje;
+    if (esComandoCache(consulta)) {
+        metricas.registrarComando();
+        mensaje = describirEstadisticas(cache.estadisticas());  // Aciertos y fallos, para ajustar el tamaño de la caché
+        registro.append(QString::fromStdString(mensaje));
+        return QByteArray::fromStdString(mensaje);
+    }
+    if (esComandoMetricas(consulta)) {
+        metricas.registrarComando();
+        return QByteArray::fromStdString(textoMetricas(*indice.fijar(), cache.estadisticas(), metricas));
+    }
+
+    // Mientras se construye el índice no se consulta ni se modifica: el cliente recibe el estado y reintenta
+    if (!indiceListo) {
+        QString estado = "Índice cargando (" + QString::number(static_cast<qulonglong>(archivosIndexados.load())) + " de " +
+                         QString::number(static_cast<qulonglong>(archivosPorIndexar.load())) +
+                         " archivos). Intente de nuevo en unos segundos.";
+        return estado.toUtf8();
+    }
+
+    // Comandos de administración: agregan, borran o reemplazan un archivo de 'textos' sin reconstruir el índice.
+    // Cada uno publica una versión nueva; las consultas en curso siguen con la que fijaron.
+    if (esComandoAdministracion(consulta)) {
+        // El índice compactado se guarda para usarlo en el próximo arranque
+        ComandoAdministracion comando = ejecutarComandoAdministracion(consulta, carpetaTextos, indice, mensaje, rutaIndice);
+        if (comando != NO_ES_COMANDO) {
+            metricas.registrarComando();
+            registro.append(QString::fromStdString(mensaje));
+            return QByteArray::fromStdString(mensaje);
+        }
+    }
 
-    // Procesar la consulta utilizando el índice invertido
-    std::string consultaStr = consulta.toStdString();
-    std::unordered_set<std::string> resultado = procesarEntrada(trie, consultaStr);  // Procesa la consulta
+    // Procesar la consulta utilizando el índice invertido (la versión publicada al empezar, hasta el final)
+    std::shared_ptr<const VersionIndice> version = indice.fijar();
+    const TablaDocumentos& documentos = version->documentos;
+    std::vector<ResultadoBusqueda> resultado;
+    NodoConsulta arbol;
+    std::string error;
+    if (analizarConsulta(consulta, arbol, error)) {
+        resultado = buscarRankingConCache(cache, version->trie, documentos, arbol);  // Los documentos más relevantes (BM25), de mayor a menor
+        metricas.registrarConsulta(arbol.tipo, false, inicio, resultado.size());
+    } else {
+        metricas.registrarInvalida();
+        registro.append("Consulta inválida (" + QString::fromStdString(error) + ")");
+    }
 
     QString respuesta;
     if (resultado.empty()) {
-        respuesta = "No se encontraron resultados para: " + consulta;  // Mensaje si no se encontraron resultados
+        respuesta = "No se encontraron resultados para: " + QString::fromStdString(consulta);  // Mensaje si no se encontraron resultados
     } else {
         respuesta = "Archivos encontrados:\n";
-        for (const std::string& archivo : resultado) {
-            QFileInfo fileInfo(QString::fromStdString(archivo));
-            respuesta += QString("   - ") +  fileInfo.fileName() + "\n";  // Añade el nombre del archivo a la respuesta
-            ui->log->append("Archivo encontrado: " + QString::fromStdString(archivo));  // Muestra el archivo encontrado en el log
+        for (const ResultadoBusqueda& encontrado : resultado) {
+            const Documento& documento = documentos.obtener(encontrado.documento);  // Solo aqui se convierte el ID en nombre de archivo
+            respuesta += QString("   - ") + QString::fromStdString(documento.nombre) + "\n";  // Añade el nombre del archivo a la respuesta
+            registro.append("Archivo encontrado: " + QString::fromStdString(documento.ruta));  // Se muestra en el log con la próxima tanda
         }
     }
+    return respuesta.toUtf8();
+}
 
-    clienteSocket->write(respuesta.toUtf8());  // Envía la respuesta al cliente
-    clienteSocket->flush();  // Asegura que todos los datos se envíen
+void Widget::terminarConsulta(QTcpSocket* socket, quint64 conexion, QByteArray respuesta, QStringList registro) {
+    for (const QString& linea : registro) {
+        registrar(linea);
+    }
+    auto cliente = clientes.find(socket);
+    if (cliente == clientes.end() || cliente->id != conexion) {
+        return;  // El cliente se desconectó mientras se ejecutaba su consulta
+    }
+    cliente->ocupado = false;
+    socket->write(respuesta);  // Envía la respuesta al cliente
+    socket->flush();  // Asegura que todos los datos se envíen
+    despachar(socket);  // Siguiente consulta del mismo cliente
 }
 
 void Widget::manejarDesconexion() {
     QTcpSocket* clienteSocket = qobject_cast<QTcpSocket*>(sender());  // Obtiene el socket del cliente que se ha desconectado
     if (clienteSocket) {
-        clientesSockets.removeAll(clienteSocket);  // Elimina el socket de la lista de clientes
+        clientes.remove(clienteSocket);  // Elimina el socket de los clientes activos (una consulta en curso se descarta al terminar)
         clienteSocket->deleteLater();  // Marca el socket para su eliminación
-        ui->log->append("Cliente desconectado.");  // Mensaje indicando que un cliente se ha desconectado
+        registrar("Cliente desconectado.");  // Mensaje indicando que un cliente se ha desconectado
+    }
+}
+
+void Widget::mostrarAvance(int archivos, int total, double palabrasPorSegundo, double segundosRestantes) {
+    QString linea = "Indexando: " + QString::number(archivos) + " de " + QString::number(total) + " archivos, " +
+                    QString::number(qRound64(palabrasPorSegundo)) + " palabras/s";
+    if (archivos < total && segundosRestantes >= 0) {
+        linea += ", faltan " + QString::number(qRound64(segundosRestantes)) + " s";
+    } else if (archivos == total) {
+        linea += ", juntando las listas en el trie";
+    }
+    registrar(linea);
+}
+
+void Widget::terminarIndice(bool cargado, QString ruta) {
+    indexando = false;
+    if (cargado) {
+        registrar("Índice invertido cargado desde " + ruta + ".");
+    } else {
+        registrar("Índice invertido construido y guardado en " + ruta + ".");
+    }
+    registrar(QString::fromStdString(resumenIndexado(*indice.fijar())));  // Lo que midió la construcción y el tamaño del índice
+}
+
+void Widget::guardarMetricas() {
+    escribirMetricas(rutaMetricas, textoMetricas(*indice.fijar(), cache.estadisticas(), metricas));
+}
+
+void Widget::registrar(const QString& linea) {
+    if (registroPendiente.size() < MAXIMO_LINEAS_TANDA) {
+        registroPendiente.append(linea);
+    } else {
+        lineasOmitidas++;
+    }
+    if (!temporizadorRegistro->isActive()) {
+        temporizadorRegistro->start();  // Una sola escritura en el log por intervalo, aunque lleguen miles de líneas
+    }
+}
+
+void Widget::vaciarRegistro() {
+    if (lineasOmitidas > 0) {
+        registroPendiente.append("(" + QString::number(lineasOmitidas) + " líneas omitidas)");
+        lineasOmitidas = 0;
+    }
+    if (registroPendiente.isEmpty()) {
+        return;
+    }
+
+    // Todas las líneas en una sola edición del documento: se redibuja una vez por tanda y no una por línea
+    QTextCursor cursor(ui->log->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    for (const QString& linea : registroPendiente) {
+        if (!ui->log->document()->isEmpty()) {
+            cursor.insertBlock();
+        }
+        cursor.insertText(linea);
     }
+    cursor.endEditBlock();
+    registroPendiente.clear();
+    ui->log->verticalScrollBar()->setValue(ui->log->verticalScrollBar()->maximum());
 }
 
 QString Widget::obtenerDireccionIP() {
@@ -4,12 +4,27 @@
 #include <QWidget>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThreadPool>
+#include <QTimer>
+#include <QHash>
+#include <QStringList>
+#include <deque>
+#include <atomic>
 #include "IndiceInvertido.h"
+#include "IndicePublicado.h"
+#include "CacheConsultas.h"
+#include "Metricas.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Widget; }
 QT_END_NAMESPACE
 
+// Las consultas se ejecutan en un pool de hilos y no en el hilo de la interfaz: su resultado vuelve con la
+// señal consultaTerminada (en cola), así que una consulta lenta no congela la ventana ni a los demás clientes.
+// El log se escribe por tandas cada cierto tiempo y con un tope de líneas por tanda.
+// El índice se carga o se construye en segundo plano: hasta que está listo, las consultas reciben "Índice cargando".
+// Cada consulta fija la versión publicada del índice; los comandos publican una nueva sin detener a las consultas.
+// Las métricas (comando STATS) se escriben también en formato de Prometheus en 'metricas.prom' cada cierto tiempo.
 class Widget : public QWidget
 {
     Q_OBJECT
@@ -18,6 +33,13 @@ public:
     Widget(QWidget *parent = nullptr);  // Constructor del widget
     ~Widget();  // Destructor del widget
 
+signals:
+    // La emite el hilo del pool al terminar una consulta; 'registro' son las líneas para el log
+    void consultaTerminada(QTcpSocket* socket, quint64 conexion, QByteArray respuesta, QStringList registro);
+    // Avance de la construcción del índice (segundosRestantes < 0 si aún no se puede estimar)
+    void avanceIndexado(int archivos, int total, double palabrasPorSegundo, double segundosRestantes);
+    void indiceTerminado(bool cargado, QString ruta);
+
 private slots:
     void on_iniciar_clicked();  // Slot para iniciar el servidor
     void on_detener_clicked();  // Slot para detener el servidor
@@ -25,16 +47,46 @@ private slots:
     void manejarConexion();  // Slot para manejar nuevas conexiones de clientes
     void manejarDatos();  // Slot para manejar los datos recibidos de los clientes
     void manejarDesconexion();  // Slot para manejar la desconexion de clientes
+    void terminarConsulta(QTcpSocket* socket, quint64 conexion, QByteArray respuesta, QStringList registro);  // Envía la respuesta (hilo de la interfaz)
+    void vaciarRegistro();  // Escribe en el log las líneas acumuladas
+    void guardarMetricas();  // Escribe las métricas en 'rutaMetricas'
+    void mostrarAvance(int archivos, int total, double palabrasPorSegundo, double segundosRestantes);
+    void terminarIndice(bool cargado, QString ruta);
 
 private:
+    // Estado de un cliente conectado: sus consultas se ejecutan de a una para responder en orden
+    struct Cliente {
+        quint64 id = 0;  // distingue al cliente de otro que reciba después la misma dirección de socket
+        bool ocupado = false;  // tiene una consulta en el pool
+        std::deque<std::string> pendientes;  // consultas que esperan su turno
+    };
+
     void iniciarServidor(quint16 puerto);  // Metodo para iniciar el servidor en el puerto especificado
     void detenerServidor();  // Metodo para detener el servidor
     QString obtenerDireccionIP();  // Metodo para obtener la direccion IP local
+    void despachar(QTcpSocket* socket);  // Envía al pool la siguiente consulta del cliente si no tiene otra en curso
+    QByteArray ejecutarConsulta(const std::string& consulta, QStringList& registro);  // Se ejecuta en el pool
+    void registrar(const QString& linea);  // Agrega una línea al log en la próxima tanda
 
     Ui::Widget *ui;  // Puntero a la interfaz de usuario
     QTcpServer *server;  // Puntero al servidor TCP
-    QList<QTcpSocket*> clientesSockets;  // Lista para gestionar múltiples conexiones de clientes
-    Trie trie;  // Estructura de datos para el índice invertido
+    QHash<QTcpSocket*, Cliente> clientes;  // Conexiones de clientes activas
+    quint64 siguienteCliente = 0;
+    QThreadPool pool;  // Hilos que ejecutan las consultas y los comandos de administración
+    std::atomic<bool> indiceListo{false};  // las consultas solo usan el índice cuando está completo
+    std::atomic<size_t> archivosIndexados{0};  // avance de la construcción, para la respuesta "Índice cargando"
+    std::atomic<size_t> archivosPorIndexar{0};
+    bool indexando = false;  // hay una construcción en el pool
+    QStringList registroPendiente;  // Líneas del log que esperan la siguiente tanda
+    int lineasOmitidas = 0;  // Líneas descartadas por el tope de la tanda
+    QTimer *temporizadorRegistro;
+    QTimer *temporizadorMetricas;
+    IndicePublicado indice;  // Trie, tabla de documentos (ID -> ruta y datos del archivo) y palabras vacías
+    std::string carpetaTextos;  // Carpeta 'textos' junto al ejecutable (no cambia después del constructor)
+    std::string rutaIndice;  // Índice guardado en disco
+    CacheConsultas cache;  // Resultados de las consultas repetidas (se invalida cuando cambia el índice)
+    MetricasConsultas metricas;  // Consultas por operador, latencias y tamaños de los resultados
+    std::string rutaMetricas;  // Archivo con las métricas en formato de Prometheus
 };
 
 #endif // WIDGET_H